@@ -653,3 +653,42 @@ standardProject("slang-llvm", "source/slang-llvm")
         libdirs { libPath }
         links(findLLVMLibraries(targetInfo, libPath, "Release"))
 
+-- Out of process compilations are performed by this executable. It loads the slang-llvm shared library
+-- (the path is passed on the command line) and runs the compile loop it exports.
+standardProject("slang-llvm-worker", "source/slang-llvm-worker")
+    uuid "6136CD91-4242-4579-B8D5-F93C012B1EB4"
+    kind "ConsoleApp"
+    warnings "Extra"
+    flags { "FatalWarnings" }
+
+    includedirs 
+    {
+        -- So we can access slang.h
+        slangPath, 
+        -- For core/compiler-core
+        path.join(slangPath, "source"), 
+        -- For slang-llvm.h
+        "source/slang-llvm"
+    }
+
+-- Tests for slang-llvm. Run with the path of the slang-llvm shared library, for example
+-- 'slang-llvm-test bin/linux-x64/release/libslang-llvm.so'. Test names (or prefixes of them) can follow, to only run those tests.
+tool "slang-llvm-test"
+    uuid "0D5C1A6E-8B0C-4A61-9E59-3C2B7B5A4F21"
+    warnings "Extra"
+    flags { "FatalWarnings" }
+
+    -- The tests load slang-llvm themselves, but need it (and the worker) to have been built
+    dependson { "slang-llvm", "slang-llvm-worker" }
+
+    links { "core", "compiler-core" }
+
+    includedirs
+    {
+        -- So we can access slang.h
+        slangPath,
+        -- For core/compiler-core
+        path.join(slangPath, "source"),
+        -- For slang-llvm.h
+        "source/slang-llvm"
+    }
@@ -0,0 +1,138 @@
+// slang-llvm-worker
+//
+// Performs compilations for slang-llvm in a separate process, such that a crash or fatal LLVM error only terminates
+// this process. It is started by slang-llvm with the path of the slang-llvm shared library, and communicates with it
+// over stdin and stdout.
+
+#include <slang.h>
+
+#include "slang-llvm.h"
+
+#include <stdio.h>
+
+#if SLANG_WINDOWS_FAMILY
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#   include <fcntl.h>
+#   include <io.h>
+#else
+#   include <dlfcn.h>
+#   include <errno.h>
+#   include <unistd.h>
+#endif
+
+namespace { // anonymous
+
+struct Channel
+{
+    int readFd;
+    int writeFd;
+};
+
+SlangResult _readChannel(void* data, size_t size, void* userData)
+{
+    const Channel* channel = (const Channel*)userData;
+    char* cur = (char*)data;
+    while (size > 0)
+    {
+#if SLANG_WINDOWS_FAMILY
+        const int readCount = _read(channel->readFd, cur, unsigned(size));
+#else
+        const ssize_t readCount = read(channel->readFd, cur, size);
+        if (readCount < 0 && errno == EINTR)
+        {
+            continue;
+        }
+#endif
+        if (readCount <= 0)
+        {
+            return SLANG_FAIL;
+        }
+        cur += readCount;
+        size -= size_t(readCount);
+    }
+    return SLANG_OK;
+}
+
+SlangResult _writeChannel(const void* data, size_t size, void* userData)
+{
+    const Channel* channel = (const Channel*)userData;
+    const char* cur = (const char*)data;
+    while (size > 0)
+    {
+#if SLANG_WINDOWS_FAMILY
+        const int written = _write(channel->writeFd, cur, unsigned(size));
+#else
+        const ssize_t written = write(channel->writeFd, cur, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+#endif
+        if (written <= 0)
+        {
+            return SLANG_FAIL;
+        }
+        cur += written;
+        size -= size_t(written);
+    }
+    return SLANG_OK;
+}
+
+slang_llvm::LLVMRunCompileWorkerFunc _loadRunCompileWorker(const char* libraryPath)
+{
+#if SLANG_WINDOWS_FAMILY
+    HMODULE module = LoadLibraryA(libraryPath);
+    return module ? (slang_llvm::LLVMRunCompileWorkerFunc)GetProcAddress(module, SLANG_LLVM_RUN_COMPILE_WORKER_NAME) : nullptr;
+#else
+    void* module = dlopen(libraryPath, RTLD_NOW | RTLD_LOCAL);
+    return module ? (slang_llvm::LLVMRunCompileWorkerFunc)dlsym(module, SLANG_LLVM_RUN_COMPILE_WORKER_NAME) : nullptr;
+#endif
+}
+
+} // anonymous
+
+int main(int argc, const char** argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: slang-llvm-worker <slang-llvm library path>\n");
+        return 1;
+    }
+
+    const auto runCompileWorker = _loadRunCompileWorker(argv[1]);
+    if (!runCompileWorker)
+    {
+        fprintf(stderr, "slang-llvm-worker: unable to load '%s'\n", argv[1]);
+        return 1;
+    }
+
+    // Keep stdout for communicating with the host, and send anything else that is written to stdout to stderr,
+    // such that it can't corrupt the communication.
+    Channel channel;
+#if SLANG_WINDOWS_FAMILY
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+
+    channel.readFd = _fileno(stdin);
+    channel.writeFd = _dup(_fileno(stdout));
+    _dup2(_fileno(stderr), _fileno(stdout));
+#else
+    channel.readFd = STDIN_FILENO;
+    channel.writeFd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+
+    if (channel.writeFd < 0)
+    {
+        return 1;
+    }
+
+    slang_llvm::LLVMCompileWorkerIO io;
+    io.read = &_readChannel;
+    io.write = &_writeChannel;
+    io.userData = &channel;
+
+    return SLANG_SUCCEEDED(runCompileWorker(&io)) ? 0 : 1;
+}
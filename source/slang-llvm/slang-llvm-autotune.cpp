@@ -0,0 +1,269 @@
+#include "slang-llvm-compiler.h"
+
+#include "llvm/Support/MD5.h"
+
+#include <core/slang-string-util.h>
+
+#include <algorithm>
+
+namespace slang_llvm {
+
+using namespace llvm;
+
+using namespace Slang;
+
+/* !!!!!!!!!!!!!!!!!!!!! Autotuning !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* Autotuning compiles a variant of the source for each configuration, and keeps the one the benchmark callback finds
+fastest. The variants are compiled in parallel on the worker threads, but benchmarked one at a time, such that they
+don't compete for the CPU.
+
+The configuration found is recorded against a hash of everything in the request and the options that determines the
+code, other than the tuning configuration itself. Later compilations only use it if they ask to, with
+LLVMCompileOptions::useAutotunedConfig. */
+
+// Returns the key the configuration found by autotuning request with llvmOptions is recorded against
+static std::string _getTuningKey(const LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions)
+{
+    MD5 hash;
+    auto addString = [&](StringRef string)
+    {
+        // Include the size, such that the boundaries between strings are part of the hash
+        const uint64_t size = string.size();
+        hash.update(ArrayRef<uint8_t>((const uint8_t*)&size, sizeof(size)));
+        hash.update(string);
+    };
+    auto addValue = [&](uint64_t value)
+    {
+        addString(std::to_string(value));
+    };
+
+    addValue(uint64_t(request->targetType));
+    addValue(uint64_t(request->sourceLanguage));
+    addValue(uint64_t(request->optimizationLevel));
+    addValue(uint64_t(request->floatingPointMode));
+    for (const auto& define : request->defines)
+    {
+        addString(define);
+    }
+    // Separate the defines from the include paths
+    addString(StringRef());
+    for (const auto& includePath : request->includePaths)
+    {
+        addString(includePath);
+    }
+    const auto sourceSlice = StringUtil::getSlice(request->sourceBlob);
+    addString(StringRef(sourceSlice.begin(), sourceSlice.getLength()));
+
+    // The options that change the code generated. Ones that only change how it's produced (such as the budget) aren't
+    // included, nor is the tuning configuration, which is what is being looked up.
+    addValue(uint64_t(llvmOptions.profileMode));
+    if (llvmOptions.profileMode == LLVMCompileOptions::ProfileMode::Use && llvmOptions.profileData)
+    {
+        const auto profileSlice = StringUtil::getSlice(llvmOptions.profileData);
+        addString(StringRef(profileSlice.begin(), profileSlice.getLength()));
+    }
+    addValue(uint64_t(llvmOptions.instrumentFunctions));
+    addValue(uint64_t(llvmOptions.vectorizeGroups));
+    addValue(uint64_t(llvmOptions.multiversionLevels));
+    addValue(uint64_t(llvmOptions.keepBitcode));
+    addValue(uint64_t(llvmOptions.shareFunctions));
+    addValue(uint64_t(llvmOptions.incremental));
+    addValue(uint64_t(llvmOptions.profilerSupport));
+    addValue(uint64_t(llvmOptions.pipelineProfile));
+    addString(llvmOptions.passPipeline ? StringRef(llvmOptions.passPipeline) : StringRef());
+
+    // Sorted so the order the names were given in doesn't matter
+    std::vector<StringRef> exportNames;
+    for (Index i = 0; i < llvmOptions.exportNameCount; ++i)
+    {
+        exportNames.push_back(llvmOptions.exportNames[i]);
+    }
+    std::sort(exportNames.begin(), exportNames.end());
+    addValue(exportNames.size());
+    for (StringRef exportName : exportNames)
+    {
+        addString(exportName);
+    }
+
+    MD5::MD5Result result;
+    hash.final(result);
+    return result.digest().str().str();
+}
+
+// The configurations tried if none are specified
+static std::vector<LLVMTuningConfig> _getDefaultTuningConfigs(const LLVMCompileRequest* request)
+{
+    typedef DownstreamCompileOptions::OptimizationLevel OptimizationLevel;
+    typedef DownstreamCompileOptions::FloatingPointMode FloatingPointMode;
+
+    // Only use fast floating point if precise wasn't asked for
+    std::vector<FloatingPointMode> floatingPointModes;
+    floatingPointModes.push_back(request->floatingPointMode);
+    if (request->floatingPointMode != FloatingPointMode::Precise && request->floatingPointMode != FloatingPointMode::Fast)
+    {
+        floatingPointModes.push_back(FloatingPointMode::Fast);
+    }
+
+    std::vector<LLVMTuningConfig> configs;
+    for (auto floatingPointMode : floatingPointModes)
+    {
+        LLVMTuningConfig config;
+        config.floatingPointMode = floatingPointMode;
+
+        // As the compiler would compile it without tuning
+        config.optimizationLevel = request->optimizationLevel;
+        configs.push_back(config);
+
+        for (auto optimizationLevel : { OptimizationLevel::Default, OptimizationLevel::Maximal })
+        {
+            config.optimizationLevel = optimizationLevel;
+            config.unrollLoops = true;
+            config.vectorizeLoops = true;
+            config.vectorizeSLP = true;
+            config.vectorizeWidth = 0;
+            configs.push_back(config);
+
+            for (uint32_t vectorizeWidth : { 4u, 8u })
+            {
+                config.vectorizeWidth = vectorizeWidth;
+                configs.push_back(config);
+            }
+        }
+    }
+    return configs;
+}
+
+bool LLVMDownstreamCompiler::_findTuningConfig(const LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, LLVMTuningConfig& outConfig)
+{
+    // Hashed outside of the lock, as the source can be large
+    const std::string key = _getTuningKey(request, llvmOptions);
+
+    std::lock_guard<std::mutex> lock(m_tuningConfigsMutex);
+    auto iter = m_tuningConfigs.find(key);
+    if (iter == m_tuningConfigs.end())
+    {
+        return false;
+    }
+    outConfig = iter->second;
+    return true;
+}
+
+SlangResult LLVMDownstreamCompiler::autotune(const CompileOptions& inOptions, const LLVMAutotuneDesc& desc, IArtifact** outArtifact, LLVMTuningConfig* outConfig)
+{
+    *outArtifact = nullptr;
+
+    if (!isVersionCompatible(inOptions))
+    {
+        // Not possible to compile with this version of the interface.
+        return SLANG_E_NOT_IMPLEMENTED;
+    }
+    if (!desc.entryPointName || !desc.benchmark)
+    {
+        return SLANG_E_INVALID_ARG;
+    }
+
+    RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+    SLANG_RETURN_ON_FAIL(request->init(getCompatibleVersion(&inOptions)));
+    request->runtimeSymbols = _getRuntimeSymbolTable();
+
+    std::vector<LLVMTuningConfig> configs;
+    if (desc.configCount > 0)
+    {
+        configs.assign(desc.configs, desc.configs + desc.configCount);
+    }
+    else
+    {
+        configs = _getDefaultTuningConfigs(request);
+    }
+
+    // Compile all of the variants
+    std::vector<ComPtr<LLVMCompileTask>> tasks;
+    for (const auto& config : configs)
+    {
+        LLVMCompileOptions llvmOptions;
+        llvmOptions.useTuningConfig = true;
+        llvmOptions.tuningConfig = config;
+
+        ComPtr<LLVMCompileTask> task(new LLVMCompileTask(request, llvmOptions, LLVMCompilePriority::Normal, m_workerPool.nextSequence()));
+        m_workerPool.enqueue(this, task);
+        tasks.push_back(task);
+    }
+
+    // Every compilation must be complete before benchmarking, so that the benchmarks don't compete with them for the CPU
+    for (const auto& task : tasks)
+    {
+        task->wait();
+    }
+
+    // Benchmark them in turn
+    ComPtr<IArtifact> firstArtifact;
+    bool anyCompiled = false;
+    ComPtr<IArtifact> bestArtifact;
+    Index bestIndex = -1;
+    double bestTime = 0.0;
+
+    for (Index i = 0; i < Index(tasks.size()); ++i)
+    {
+        ComPtr<IArtifact> artifact;
+        if (SLANG_FAILED(tasks[i]->getResult(artifact.writeRef())) || !artifact)
+        {
+            continue;
+        }
+        if (!firstArtifact)
+        {
+            firstArtifact = artifact;
+        }
+
+        ComPtr<ISlangSharedLibrary> sharedLibrary;
+        if (SLANG_FAILED(artifact->loadSharedLibrary(ArtifactKeep::Yes, sharedLibrary.writeRef())))
+        {
+            // Didn't compile
+            continue;
+        }
+        anyCompiled = true;
+
+        void* func = sharedLibrary->findSymbolAddressByName(desc.entryPointName);
+        if (!func)
+        {
+            continue;
+        }
+
+        const double time = desc.benchmark(func, desc.benchmarkUserData);
+        if (time >= 0.0 && (bestIndex < 0 || time < bestTime))
+        {
+            bestIndex = i;
+            bestTime = time;
+            bestArtifact = artifact;
+        }
+    }
+
+    if (!bestArtifact)
+    {
+        // If every variant that compiled was rejected, there is no best variant
+        if (anyCompiled || !firstArtifact)
+        {
+            return SLANG_FAIL;
+        }
+        // None compiled, return the first so its diagnostics are available
+        *outArtifact = firstArtifact.detach();
+        return SLANG_OK;
+    }
+
+    // The variants were compiled with otherwise default options
+    const auto& bestConfig = configs[bestIndex];
+    const std::string key = _getTuningKey(request, LLVMCompileOptions());
+    {
+        std::lock_guard<std::mutex> lock(m_tuningConfigsMutex);
+        m_tuningConfigs[key] = bestConfig;
+    }
+
+    if (outConfig)
+    {
+        *outConfig = bestConfig;
+    }
+    *outArtifact = bestArtifact.detach();
+    return SLANG_OK;
+}
+
+} // namespace slang_llvm
@@ -0,0 +1,527 @@
+#ifndef SLANG_LLVM_COMPILER_H
+#define SLANG_LLVM_COMPILER_H
+
+// The types that are used by more than one of the slang-llvm source files. The implementation of LLVMDownstreamCompiler
+// is in slang-llvm.cpp, other than autotuning (slang-llvm-autotune.cpp).
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+#include <slang.h>
+#include <slang-com-helper.h>
+#include <slang-com-ptr.h>
+
+#include <core/slang-com-object.h>
+#include <core/slang-smart-pointer.h>
+
+#include <compiler-core/slang-downstream-compiler.h>
+
+#include "slang-llvm.h"
+#include "slang-llvm-dispatch.h"
+#include "slang-llvm-worker-process.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace slang_llvm {
+
+// A native function (or variable) that JIT'd code can reference by name
+struct RuntimeSymbol
+{
+    typedef void (*Func)();
+
+    std::string name;
+    std::string mangledName;
+    Func func;
+};
+
+/* A library registered with ILLVMLibraryDownstreamCompiler::registerLibrary. Its functions only replace a compilation's
+own copies if the compilation has the same defines and floating point mode as the library, as otherwise the copies may
+not be the same. */
+struct RuntimeLibrary
+{
+    Slang::ComPtr<Slang::IArtifact> artifact;   ///< Holds the code of the functions. Not set in a worker process.
+    std::string bitcode;
+    std::vector<std::string> defines;           ///< Sorted, as the order they're defined in doesn't matter
+    Slang::DownstreamCompileOptions::FloatingPointMode floatingPointMode = Slang::DownstreamCompileOptions::FloatingPointMode::Default;
+    llvm::StringSet<> functionNames;            ///< The functions that replace a compilation's copies
+};
+
+/* The native functions and bitcode made available to JIT'd code: the built in runtime functions, and anything
+registered with ILLVMSymbolDownstreamCompiler. Names are mangled when added, so a JIT only has to intern them.
+
+A table isn't changed once it has been published, so compilations can share it without locking. Registering something
+creates a new table, and replaces the compiler's reference to the current table under a mutex. Getting the current table
+only holds the mutex while the reference is copied. */
+class RuntimeSymbolTable : public Slang::RefObject
+{
+public:
+    std::vector<RuntimeSymbol> symbols;
+    llvm::StringSet<> symbolNames;              ///< The (unmangled) names of symbols
+    std::vector<std::string> bitcodeModules;    ///< Linked into each module, so their functions can be inlined
+    std::vector<RuntimeLibrary> libraries;      ///< The libraries whose functions are among the symbols
+};
+
+/* Holds a copy of the parts of DownstreamCompileOptions that are used by a compilation. As it owns all of its contents
+it can outlive the options it was initialized from - which allows for the compilation to be performed again later (for
+example to recompile with a profile). */
+class LLVMCompileRequest : public Slang::RefObject
+{
+public:
+    typedef Slang::DownstreamCompileOptions CompileOptions;
+
+    SlangResult init(const CompileOptions& options);
+
+    CompileOptions::OptimizationLevel optimizationLevel = CompileOptions::OptimizationLevel::Default;
+    CompileOptions::FloatingPointMode floatingPointMode = CompileOptions::FloatingPointMode::Default;
+    SlangCompileTarget targetType = SLANG_HOST_CALLABLE;
+    SlangSourceLanguage sourceLanguage = SLANG_SOURCE_LANGUAGE_CPP;
+
+    std::vector<std::string> defines;
+    std::vector<std::string> includePaths;
+
+    Slang::ComPtr<ISlangBlob> sourceBlob;
+
+    Slang::RefPtr<RuntimeSymbolTable> runtimeSymbols; ///< If not set only the built in runtime functions are available
+
+    llvm::StringSet<> exportNames;              ///< If not empty, the only symbols that remain external
+
+    std::string remarksFilter;                  ///< If not empty, remarks of the passes matching it are reported
+    std::string passPipeline;                   ///< Run by LLVMCompileOptions::PipelineProfile::Custom
+
+    bool isLibrary = false;                     ///< Compiled by compileLibrary, so inline functions are kept even if unused
+
+        /// Copy the options that are referenced by llvmOptions, rather than held in it
+    void setReferencedOptions(const LLVMCompileOptions& llvmOptions)
+    {
+        exportNames.clear();
+        for (Slang::Index i = 0; i < llvmOptions.exportNameCount; ++i)
+        {
+            exportNames.insert(llvmOptions.exportNames[i]);
+        }
+        remarksFilter = llvmOptions.remarksFilter ? llvmOptions.remarksFilter : "";
+        passPipeline = llvmOptions.passPipeline ? llvmOptions.passPipeline : "";
+    }
+};
+
+/* Determines if a compilation should stop, because it has been cancelled or has exceeded its time budget */
+class CompileBudget
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef LLVMCompileOptions::BudgetExceededAction ExceededAction;
+
+        /// Initialize from the options. The time budget is measured from when this is called.
+    void init(const LLVMCompileOptions& options)
+    {
+        m_token = options.cancellationToken;
+        m_exceededAction = options.budgetExceededAction;
+        m_hasDeadline = options.timeBudgetInMs > 0;
+        if (m_hasDeadline)
+        {
+            m_deadline = Clock::now() + std::chrono::milliseconds(options.timeBudgetInMs);
+        }
+    }
+
+    bool isCancelled() const { return m_isCancelled || (m_token && m_token->isCancelled()); }
+    bool isExpired() const { return m_hasDeadline && Clock::now() >= m_deadline; }
+        /// True if no more work (such as optimization passes) should be done
+    bool shouldStop() const { return isCancelled() || isExpired(); }
+        /// True if the compilation should stop and fail
+    bool shouldFail() const { return isCancelled() || (isExpired() && m_exceededAction == ExceededAction::Fail); }
+        /// True if the compilation can be cancelled or has a time budget
+    bool hasLimit() const { return m_token || m_hasDeadline; }
+
+    ExceededAction getExceededAction() const { return m_exceededAction; }
+
+        /// Cancels just the compilation using this budget
+    void cancel() { m_isCancelled = true; }
+
+protected:
+    Slang::ComPtr<ILLVMCancellationToken> m_token;
+    std::atomic<bool> m_isCancelled{ false };
+
+    bool m_hasDeadline = false;
+    Clock::time_point m_deadline;
+    ExceededAction m_exceededAction = ExceededAction::Fail;
+};
+
+/* A JIT that is shared by multiple compilations (such as those of a batch), such that the cost of creating a JIT
+and defining the runtime symbols is only paid once. Each compilation adds its code to its own JITDylib.
+
+The JIT, and so the code of all of the compilations, is freed when the shared libraries of all of the compilations
+have been released. */
+class SharedJIT : public Slang::RefObject
+{
+public:
+        /// Create a JITDylib for a compilation, creating the JIT first if necessary. Can be called from any thread.
+        /// On failure an error is added to diagnostics.
+    SlangResult createDylib(Slang::IArtifactDiagnostics* diagnostics, std::shared_ptr<llvm::orc::LLJIT>& outJIT, llvm::orc::JITDylib*& outDylib);
+
+        /// runtimeSymbols are made available to the code of all of the compilations. If null the built in runtime functions are.
+    SharedJIT(RuntimeSymbolTable* runtimeSymbols):
+        m_runtimeSymbols(runtimeSymbols)
+    {
+    }
+
+protected:
+    Slang::RefPtr<RuntimeSymbolTable> m_runtimeSymbols;
+
+    std::mutex m_mutex;
+    std::shared_ptr<llvm::orc::LLJIT> m_jit;
+    llvm::orc::JITDylib* m_runtimeLib = nullptr;
+    uint32_t m_dylibCount = 0;
+};
+
+class FunctionStore;
+
+/* The functions of a FunctionStore that a library uses. They remain in the store while this exists, and are released
+when it's destroyed. */
+class SharedFunctions : public Slang::RefObject
+{
+public:
+    SharedFunctions(FunctionStore* store):
+        store(store)
+    {
+    }
+    ~SharedFunctions();
+
+    Slang::RefPtr<FunctionStore> store;
+    std::vector<std::string> functionNames;            ///< Each holds one use of the function in the store
+};
+
+/* Holds the code of functions that are shared by the compilations of a compiler, keyed by a hash of their optimized IR,
+such that code for a function that is identical in many compilations is only generated (and held in memory) once.
+
+Each function counts the libraries that use it, and its code is removed from the store's JIT when the last of them is
+released. The JIT itself is freed when the store and every library using it have been released. */
+class FunctionStore : public Slang::RefObject
+{
+public:
+        /// Replace the functions of module that can be shared with declarations of the same functions in the store, adding
+        /// any the store doesn't have yet. If shareExported is set, functions module exports are replaced too, and
+        /// outSymbols also receives their original names. outSymbols receives the names and addresses of the functions
+        /// module now uses from the store, and outShared holds them in the store (it's null if there are none). Can be
+        /// called from any thread.
+    SlangResult shareFunctions(llvm::Module& module, bool shareExported, std::vector<std::pair<std::string, void*>>& outSymbols, Slang::RefPtr<SharedFunctions>& outShared);
+
+        /// Get the runtime symbols that are available to the stored functions
+    RuntimeSymbolTable* getRuntimeSymbols() const { return m_runtimeSymbols; }
+
+    FunctionStore(RuntimeSymbolTable* runtimeSymbols):
+        m_runtimeSymbols(runtimeSymbols)
+    {
+    }
+
+protected:
+    friend class SharedFunctions;
+
+    struct StoredFunction
+    {
+        llvm::orc::ResourceTrackerSP tracker;           ///< Tracks the code of the function, so it can be removed
+        uint32_t useCount = 0;                          ///< The amount of SharedFunctions holding the function
+    };
+
+        /// Release a use of each of the functions, removing those that are no longer used
+    void _releaseFunctions(const std::vector<std::string>& functionNames);
+
+    Slang::RefPtr<RuntimeSymbolTable> m_runtimeSymbols;
+
+    std::mutex m_mutex;
+    std::unique_ptr<llvm::orc::LLJIT> m_jit;            ///< Created when the first function is added
+    llvm::StringMap<StoredFunction> m_functions;        ///< The functions that have been added to the JIT
+};
+
+// Where the counters of each function are, in code instrumented for branch profiling
+struct BranchProfileLayout
+{
+    struct Function
+    {
+        std::string name;
+        uint32_t counterStart = 0;                      ///< Index of the entry counter. The site counters follow.
+        llvm::SmallVector<uint32_t, 8> siteSuccessorCounts; ///< The amount of successors (and so counters) for each site
+    };
+
+    std::vector<Function> functions;
+    uint32_t counterCount = 0;
+};
+
+// Statistics about the functions of a compilation, and the LLVM statistics it changed
+class LLVMCompileStats : public ILLVMCompileStats, public Slang::ComBaseObject
+{
+public:
+    // ISlangUnknown
+    SLANG_COM_BASE_IUNKNOWN_ALL
+
+    // ICastable
+    virtual SLANG_NO_THROW void* SLANG_MCALL castAs(const Slang::Guid& guid) SLANG_OVERRIDE;
+
+    // ILLVMCompileStats
+    virtual SLANG_NO_THROW Slang::Count SLANG_MCALL getFunctionCount() SLANG_OVERRIDE { return Slang::Count(functions.size()); }
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getFunctionAt(Slang::Index index, LLVMFunctionCompileStats* outStats) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW Slang::Count SLANG_MCALL getStatisticCount() SLANG_OVERRIDE { return Slang::Count(statistics.size()); }
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getStatisticAt(Slang::Index index, LLVMStatistic* outStatistic) SLANG_OVERRIDE;
+
+    struct FunctionInfo
+    {
+        std::string name;
+        uint32_t instructionCount = 0;
+        uint32_t basicBlockCount = 0;
+        uint32_t loopCount = 0;
+        uint32_t codeSize = 0;
+        uint32_t spillCount = 0;
+    };
+
+        /// Add the stats of a function
+    void addFunction(FunctionInfo&& function);
+        /// Find the function called name, or nullptr if it has no stats
+    FunctionInfo* findFunction(llvm::StringRef name);
+
+    std::vector<FunctionInfo> functions;                        ///< Only added to with addFunction
+    std::vector<std::pair<std::string, uint64_t>> statistics;
+
+protected:
+    void* getInterface(const Slang::Guid& guid);
+
+    llvm::StringMap<size_t> m_functionIndices;                  ///< Maps the name of a function to its index in functions
+};
+
+/* !!!!!!!!!!!!!!!!!!!!! LLVMCompileTask !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+class LLVMDownstreamCompiler;
+
+class LLVMCompileTask : public ILLVMCompileTask, public Slang::ComBaseObject
+{
+public:
+    // ISlangUnknown
+    SLANG_COM_BASE_IUNKNOWN_ALL
+
+    // ICastable
+    virtual SLANG_NO_THROW void* SLANG_MCALL castAs(const Slang::Guid& guid) SLANG_OVERRIDE;
+
+    // ILLVMCompileTask
+    virtual SLANG_NO_THROW bool SLANG_MCALL isComplete() SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW void SLANG_MCALL wait() SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getResult(Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW void SLANG_MCALL setCompletionCallback(LLVMCompileTaskCallback callback, void* userData) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW void SLANG_MCALL cancel() SLANG_OVERRIDE { m_budget.cancel(); }
+
+        /// Called when the compilation is complete. Wakes any waiting threads and calls the callback, if one is set.
+    void complete(SlangResult result, Slang::IArtifact* artifact);
+
+    LLVMCompileTask(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, LLVMCompilePriority priority, uint64_t sequence, SharedJIT* sharedJIT = nullptr):
+        m_request(request),
+        m_llvmOptions(llvmOptions),
+        m_profileData(llvmOptions.profileData),
+        m_priority(priority),
+        m_sequence(sequence),
+        m_sharedJIT(sharedJIT)
+    {
+        // Any time budget starts from when the task is created
+        m_budget.init(llvmOptions);
+    }
+
+    Slang::RefPtr<LLVMCompileRequest> m_request;
+    LLVMCompileOptions m_llvmOptions;
+    Slang::ComPtr<ISlangBlob> m_profileData;    ///< Keeps the blob referenced in m_llvmOptions in scope
+
+    LLVMCompilePriority m_priority;
+    uint64_t m_sequence;                        ///< Orders tasks of the same priority
+
+    Slang::RefPtr<SharedJIT> m_sharedJIT;       ///< If set the code is added to this JIT
+
+    Slang::ComPtr<LLVMDownstreamCompiler> m_compiler;   ///< Set while the task is queued, so the compiler outlives it
+
+    CompileBudget m_budget;
+
+protected:
+    void* getInterface(const Slang::Guid& guid);
+    void* getObject(const Slang::Guid& guid);
+
+    std::mutex m_mutex;
+    std::condition_variable m_completeCondition;
+
+    bool m_isComplete = false;
+    SlangResult m_result = SLANG_OK;
+    Slang::ComPtr<Slang::IArtifact> m_artifact;
+
+    LLVMCompileTaskCallback m_callback = nullptr;
+    void* m_callbackUserData = nullptr;
+};
+
+/* Holds the queue of tasks in priority order, and the worker threads that compile them. A worker thread is only
+started when a task is added and all of the existing threads are busy, up to one per hardware thread.
+
+A queued task holds a reference to its compiler, so the pool (a member of the compiler) can be destroyed by a worker
+thread releasing the last reference. In that case the thread is detached rather than joined. */
+class LLVMCompileWorkerPool
+{
+public:
+        /// Add the task to the queue. The task references compiler until it has been executed.
+    void enqueue(LLVMDownstreamCompiler* compiler, LLVMCompileTask* task);
+
+        /// Get the sequence number for a new task
+    uint64_t nextSequence() { return m_sequence++; }
+
+        /// Stops the worker threads. As tasks reference the compiler, there can't be any queued or in progress.
+    ~LLVMCompileWorkerPool();
+
+protected:
+    struct TaskOrder
+    {
+        bool operator()(const Slang::ComPtr<LLVMCompileTask>& a, const Slang::ComPtr<LLVMCompileTask>& b) const
+        {
+            // The 'largest' task is at the top of the queue
+            return (a->m_priority != b->m_priority) ? (a->m_priority < b->m_priority) : (a->m_sequence > b->m_sequence);
+        }
+    };
+
+    void _runWorker();
+
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailableCondition;
+    std::priority_queue<Slang::ComPtr<LLVMCompileTask>, std::vector<Slang::ComPtr<LLVMCompileTask>>, TaskOrder> m_queue;
+    std::vector<std::thread> m_threads;
+    size_t m_idleThreadCount = 0;               ///< The amount of threads waiting for a task
+    bool m_isShuttingDown = false;
+
+    std::atomic<uint64_t> m_sequence{ 0 };
+};
+
+/* Holds the worker processes used for out of process compilation. Processes are started when needed, up to one per
+hardware thread, and are reused between compilations. */
+class CompileWorkerProcessPool
+{
+public:
+        /// Get a process that isn't in use, starting one if necessary. Blocks if the maximum amount are in use.
+    SlangResult acquire(std::unique_ptr<CompileWorkerProcess>& outProcess);
+        /// Return a process obtained from acquire. If the process can't be reused (for example it has crashed) pass nullptr.
+    void release(std::unique_ptr<CompileWorkerProcess> process);
+
+protected:
+    std::mutex m_mutex;
+    std::condition_variable m_availableCondition;
+    std::vector<std::unique_ptr<CompileWorkerProcess>> m_idleProcesses;
+    unsigned m_processCount = 0;                ///< The amount of processes including those in use
+
+    std::string m_libraryPath;
+    std::string m_workerPath;
+};
+
+class LLVMDownstreamCompiler : public Slang::IDownstreamCompiler, public ILLVMDownstreamCompiler, public ILLVMAsyncDownstreamCompiler, public ILLVMBatchDownstreamCompiler, public ILLVMAutotuneDownstreamCompiler, public ILLVMSymbolDownstreamCompiler, public ILLVMLinkDownstreamCompiler, public ILLVMLibraryDownstreamCompiler, Slang::ComBaseObject
+{
+public:
+    typedef Slang::ComBaseObject Super;
+
+    // IUnknown
+    SLANG_COM_BASE_IUNKNOWN_ALL
+
+    // ICastable
+    virtual SLANG_NO_THROW void* SLANG_MCALL castAs(const Slang::Guid& guid) SLANG_OVERRIDE;
+
+    // IDownstreamCompiler
+    virtual SLANG_NO_THROW const Desc& SLANG_MCALL getDesc() SLANG_OVERRIDE { return m_desc; }
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compile(const CompileOptions& options, Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW bool SLANG_MCALL canConvert(const Slang::ArtifactDesc& from, const Slang::ArtifactDesc& to) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL convert(Slang::IArtifact* from, const Slang::ArtifactDesc& to, Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW bool SLANG_MCALL isFileBased() SLANG_OVERRIDE { return false; }
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getVersionString(slang::IBlob** outVersionString) SLANG_OVERRIDE;
+
+    // ILLVMDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileWithOptions(const CompileOptions& options, const LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL recompileWithProfile(Slang::IArtifact* artifact, ISlangBlob* profileData, Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL createCancellationToken(ILLVMCancellationToken** outToken) SLANG_OVERRIDE;
+
+    // ILLVMAsyncDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileAsync(const CompileOptions& options, const LLVMCompileOptions& llvmOptions, LLVMCompilePriority priority, ILLVMCompileTask** outTask) SLANG_OVERRIDE;
+
+    // ILLVMBatchDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileBatch(const CompileOptions* options, Slang::Count count, const LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifacts) SLANG_OVERRIDE;
+
+    // ILLVMAutotuneDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL autotune(const CompileOptions& options, const LLVMAutotuneDesc& desc, Slang::IArtifact** outArtifact, LLVMTuningConfig* outConfig) SLANG_OVERRIDE;
+
+    // ILLVMSymbolDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL registerSymbol(const char* name, void* address) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL registerBitcode(ISlangBlob* bitcode) SLANG_OVERRIDE;
+
+    // ILLVMLinkDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL link(const LLVMLinkDesc& desc, Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+
+    // ILLVMLibraryDownstreamCompiler
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileLibrary(const CompileOptions& options, Slang::IArtifact** outArtifact) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL registerLibrary(Slang::IArtifact* artifact) SLANG_OVERRIDE;
+
+    LLVMDownstreamCompiler():
+        m_desc(SLANG_PASS_THROUGH_LLVM, Slang::SemanticVersion(LLVM_VERSION_MAJOR, LLVM_VERSION_MINOR, LLVM_VERSION_PATCH))
+    {
+    }
+
+    void* getInterface(const Slang::Guid& guid);
+    void* getObject(const Slang::Guid& guid);
+
+        /// Performs the compilation described by the task
+    void executeTask(LLVMCompileTask* task);
+
+    Desc m_desc;
+
+protected:
+        /// Performs the compilation described by request
+        /// If sharedJIT is set the code is added to it, rather than to a JIT created for the compilation.
+    SlangResult _compile(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, SharedJIT* sharedJIT, Slang::IArtifact** outArtifact);
+        /// Performs the compilation described by request in a worker process
+    SlangResult _compileOutOfProcess(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, SharedJIT* sharedJIT, Slang::IArtifact** outArtifact);
+
+        /// Get the configuration found by autotuning the source of request with llvmOptions. Returns false if it hasn't
+        /// been autotuned.
+    bool _findTuningConfig(const LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, LLVMTuningConfig& outConfig);
+
+        /// Get the table of runtime symbols for a compilation. Null if nothing has been registered. Briefly locks
+        /// m_runtimeSymbolsMutex, the table itself can be used without locking.
+    Slang::RefPtr<RuntimeSymbolTable> _getRuntimeSymbolTable();
+
+        /// Get the store for the functions shared by compilations using runtimeSymbols
+    Slang::RefPtr<FunctionStore> _getFunctionStore(RuntimeSymbolTable* runtimeSymbols);
+
+    CompileWorkerProcessPool m_workerProcessPool;
+
+    Slang::RefPtr<DispatchThreadPool> m_dispatchThreadPool{ new DispatchThreadPool }; ///< Shared by all of the libraries produced
+
+    std::mutex m_tuningConfigsMutex;
+    llvm::StringMap<LLVMTuningConfig> m_tuningConfigs;  ///< Configurations found by autotuning, keyed by _getTuningKey
+
+    std::mutex m_runtimeSymbolsMutex;
+    Slang::RefPtr<RuntimeSymbolTable> m_runtimeSymbols; ///< Replaced (rather than changed) when something is registered
+
+    std::mutex m_functionStoreMutex;
+    Slang::RefPtr<FunctionStore> m_functionStore;       ///< Replaced when the runtime symbols change
+
+    // NOTE! Must be the last member, so the worker threads are stopped before anything they use is destroyed
+    LLVMCompileWorkerPool m_workerPool;
+};
+
+/* !!!!!!!!!!!!!!!!!!!!! Functions !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+// Creates a JIT, and a JITDylib in it (outRuntimeLib) that defines the runtime symbols. If runtimeSymbols is null
+// only the built in runtime functions are defined. If profilerSupport is set, code loaded by the JIT is made visible
+// to profilers. If compileStats is set, the stats of each module the JIT generates code for are added to it. On
+// failure an error is added to diagnostics.
+SlangResult createJIT(bool reduceOptimization, bool profilerSupport, LLVMCompileStats* compileStats, const RuntimeSymbolTable* runtimeSymbols, Slang::IArtifactDiagnostics* diagnostics, std::unique_ptr<llvm::orc::LLJIT>& outJIT, llvm::orc::JITDylib*& outRuntimeLib);
+
+// Adds the global values referenced by value (looking through constant expressions and metadata) to outGlobals
+void findReferencedGlobals(llvm::Value* value, llvm::SetVector<llvm::GlobalValue*>& outGlobals);
+
+} // namespace slang_llvm
+
+#endif
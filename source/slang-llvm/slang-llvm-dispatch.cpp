@@ -0,0 +1,360 @@
+#include "slang-llvm-dispatch.h"
+
+#include "slang-llvm-fiber.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace slang_llvm {
+
+/* !!!!!!!!!!!!!!!!!!!!! DispatchThreadPool !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+// Set on a thread while it's running a worker of a dispatch (of any pool)
+static thread_local bool s_isInDispatch = false;
+
+void DispatchThreadPool::run(uint32_t workerCount, Func func, void* userData)
+{
+    // A dispatch made by the code of a dispatch can't wait for the threads, as they may be running that code
+    if (s_isInDispatch || workerCount <= 1)
+    {
+        const bool wasInDispatch = s_isInDispatch;
+        s_isInDispatch = true;
+        func(0, userData);
+        s_isInDispatch = wasInDispatch;
+        return;
+    }
+
+    // Other dispatches wait for the threads to be free
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    s_isInDispatch = true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_threads.size() < workerCount - 1)
+        {
+            const uint32_t workerIndex = uint32_t(m_threads.size()) + 1;
+            const uint64_t generation = m_generation;
+            m_threads.emplace_back([this, workerIndex, generation]() { _threadMain(workerIndex, generation); });
+        }
+
+        m_func = func;
+        m_userData = userData;
+        m_workerCount = workerCount;
+        m_runningCount = workerCount - 1;
+        m_generation++;
+    }
+    m_startCondition.notify_all();
+
+    func(0, userData);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_completeCondition.wait(lock, [this]() { return m_runningCount == 0; });
+    s_isInDispatch = false;
+}
+
+void DispatchThreadPool::_threadMain(uint32_t workerIndex, uint64_t generation)
+{
+    // The thread only ever runs workers of dispatches
+    s_isInDispatch = true;
+
+    for (;;)
+    {
+        Func func;
+        void* userData;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCondition.wait(lock, [&]() { return m_isShutdown || m_generation != generation; });
+            if (m_isShutdown)
+            {
+                return;
+            }
+            generation = m_generation;
+
+            // Threads beyond the amount of workers asked for don't take part
+            if (workerIndex >= m_workerCount)
+            {
+                continue;
+            }
+            func = m_func;
+            userData = m_userData;
+        }
+
+        func(workerIndex, userData);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_runningCount == 0)
+            {
+                m_completeCondition.notify_one();
+            }
+        }
+    }
+}
+
+DispatchThreadPool::~DispatchThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isShutdown = true;
+    }
+    m_startCondition.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Dispatch !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* A dispatch splits the grid of groups into 'chunks', each of which is run by a single call to the entry point. A chunk
+is either part of a row of groups (along x), or a number of whole rows in the same z slice, such that it can be
+described by ComputeVaryingInput.
+
+Each worker starts with an equal share of the chunks, as a range in a DispatchWorkerQueue. A worker takes chunks from
+the front of its own range, and when that is empty steals the back half of another worker's range. As chunks are
+never added, a worker that finds every range empty is done. */
+
+/* A range of chunk indices that can be taken from (by the owner) and stolen from (by other workers) without locking.
+The range is packed as the begin index in the low 32 bits, and the end index in the high 32 bits. */
+struct DispatchWorkerQueue
+{
+    static uint64_t pack(uint32_t begin, uint32_t end) { return (uint64_t(end) << 32) | begin; }
+
+        /// Set the range. Only called by the owner when the range is empty.
+    void set(uint32_t begin, uint32_t end) { m_range.store(pack(begin, end)); }
+
+        /// Take the chunk at the front
+    bool pop(uint32_t& outChunk)
+    {
+        uint64_t range = m_range.load();
+        for (;;)
+        {
+            const uint32_t begin = uint32_t(range), end = uint32_t(range >> 32);
+            if (begin >= end)
+            {
+                return false;
+            }
+            if (m_range.compare_exchange_weak(range, pack(begin + 1, end)))
+            {
+                outChunk = begin;
+                return true;
+            }
+        }
+    }
+        /// Take the back half (rounded up) of the chunks
+    bool steal(uint32_t& outBegin, uint32_t& outEnd)
+    {
+        uint64_t range = m_range.load();
+        for (;;)
+        {
+            const uint32_t begin = uint32_t(range), end = uint32_t(range >> 32);
+            if (begin >= end)
+            {
+                return false;
+            }
+            const uint32_t split = end - (end - begin + 1) / 2;
+            if (m_range.compare_exchange_weak(range, pack(begin, split)))
+            {
+                outBegin = split;
+                outEnd = end;
+                return true;
+            }
+        }
+    }
+
+    std::atomic<uint64_t> m_range{ 0 };
+};
+
+struct DispatchContext
+{
+    void runChunk(uint32_t chunk)
+    {
+        const uint32_t chunkX = chunk % chunkCountX;
+        const uint32_t chunkY = (chunk / chunkCountX) % chunkCountY;
+        const uint32_t z = chunk / (chunkCountX * chunkCountY);
+
+        LLVMComputeVaryingInput varyingInput;
+        varyingInput.startGroupID[0] = chunkX * chunkSizeX;
+        varyingInput.startGroupID[1] = chunkY * chunkSizeY;
+        varyingInput.startGroupID[2] = z;
+        varyingInput.endGroupID[0] = std::min(varyingInput.startGroupID[0] + chunkSizeX, groupCount[0]);
+        varyingInput.endGroupID[1] = std::min(varyingInput.startGroupID[1] + chunkSizeY, groupCount[1]);
+        varyingInput.endGroupID[2] = z + 1;
+
+        func(&varyingInput, entryPointParams, globalParams);
+    }
+
+    LLVMComputeFunc func;
+    void* entryPointParams;
+    void* globalParams;
+
+    uint32_t groupCount[3];
+    uint32_t chunkSizeX;            ///< Groups in a chunk along x
+    uint32_t chunkSizeY;            ///< Rows in a chunk. If more than 1, chunkSizeX is the whole row.
+    uint32_t chunkCountX;
+    uint32_t chunkCountY;
+
+    std::unique_ptr<DispatchWorkerQueue[]> queues;
+    uint32_t queueCount;
+};
+
+static void _runDispatchWorker(uint32_t workerIndex, void* userData)
+{
+    DispatchContext* context = (DispatchContext*)userData;
+    DispatchWorkerQueue& queue = context->queues[workerIndex];
+
+    for (;;)
+    {
+        uint32_t chunk;
+        while (queue.pop(chunk))
+        {
+            context->runChunk(chunk);
+        }
+
+        // Steal from the other workers in turn, starting with the next
+        bool hasStolen = false;
+        for (uint32_t i = 1; i < context->queueCount && !hasStolen; ++i)
+        {
+            uint32_t begin, end;
+            if (context->queues[(workerIndex + i) % context->queueCount].steal(begin, end))
+            {
+                queue.set(begin, end);
+                hasStolen = true;
+            }
+        }
+        if (!hasStolen)
+        {
+            return;
+        }
+    }
+}
+
+SlangResult runDispatch(DispatchThreadPool* pool, LLVMComputeFunc func, const LLVMDispatchDesc& desc)
+{
+    DispatchContext context;
+    context.func = func;
+    context.entryPointParams = desc.entryPointParams;
+    context.globalParams = desc.globalParams;
+
+    const uint32_t* groupCount = desc.groupCount;
+    const uint64_t totalGroupCount = uint64_t(groupCount[0]) * groupCount[1] * groupCount[2];
+    if (totalGroupCount == 0)
+    {
+        return SLANG_OK;
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        context.groupCount[i] = groupCount[i];
+    }
+
+    uint32_t workerCount = desc.threadCount ? desc.threadCount : std::thread::hardware_concurrency();
+    workerCount = std::max(workerCount, 1u);
+
+    // By default aim for several chunks per worker, so a worker that finishes early can take work from the others
+    const uint64_t kChunksPerWorker = 8;
+    const uint64_t grainSize = desc.grainSize ? desc.grainSize : std::max(totalGroupCount / (workerCount * kChunksPerWorker), uint64_t(1));
+
+    if (grainSize < groupCount[0])
+    {
+        context.chunkSizeX = uint32_t(grainSize);
+        context.chunkSizeY = 1;
+    }
+    else
+    {
+        context.chunkSizeX = groupCount[0];
+        context.chunkSizeY = uint32_t(std::min(grainSize / groupCount[0], uint64_t(groupCount[1])));
+    }
+    context.chunkCountX = (groupCount[0] + context.chunkSizeX - 1) / context.chunkSizeX;
+    context.chunkCountY = (groupCount[1] + context.chunkSizeY - 1) / context.chunkSizeY;
+
+    // Chunk indices must fit in 32 bits
+    const uint64_t chunkCount = uint64_t(context.chunkCountX) * context.chunkCountY * groupCount[2];
+    if (chunkCount > std::numeric_limits<uint32_t>::max())
+    {
+        return SLANG_E_INVALID_ARG;
+    }
+
+    // No point in having workers without chunks
+    workerCount = uint32_t(std::min(uint64_t(workerCount), chunkCount));
+
+    context.queueCount = workerCount;
+    context.queues.reset(new DispatchWorkerQueue[workerCount]);
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        context.queues[i].set(uint32_t(chunkCount * i / workerCount), uint32_t(chunkCount * (i + 1) / workerCount));
+    }
+
+    if (pool)
+    {
+        pool->run(workerCount, &_runDispatchWorker, &context);
+    }
+    else
+    {
+        _runDispatchWorker(0, &context);
+    }
+    return SLANG_OK;
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Fiber groups !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+// Passed to the lanes of a FiberGroup running a compute group
+struct ComputeGroupContext
+{
+    LLVMComputeThreadFunc threadFunc;
+    uint32_t groupID[3];
+    uint32_t groupSize[3];
+    void* entryPointParams;
+    void* globalParams;
+};
+
+static void _runComputeThread(size_t laneIndex, void* userData)
+{
+    const ComputeGroupContext* context = (const ComputeGroupContext*)userData;
+
+    LLVMComputeThreadVaryingInput varyingInput;
+    for (int i = 0; i < 3; ++i)
+    {
+        varyingInput.groupID[i] = context->groupID[i];
+    }
+    varyingInput.groupThreadID[0] = uint32_t(laneIndex % context->groupSize[0]);
+    varyingInput.groupThreadID[1] = uint32_t((laneIndex / context->groupSize[0]) % context->groupSize[1]);
+    varyingInput.groupThreadID[2] = uint32_t(laneIndex / (size_t(context->groupSize[0]) * context->groupSize[1]));
+
+    context->threadFunc(&varyingInput, context->entryPointParams, context->globalParams);
+}
+
+SlangResult runGroupsAsFibers(LLVMComputeThreadFunc threadFunc, const uint32_t groupCount[3], const uint32_t groupSize[3], void* entryPointParams, void* globalParams)
+{
+    ComputeGroupContext context;
+    context.threadFunc = threadFunc;
+    for (int i = 0; i < 3; ++i)
+    {
+        context.groupSize[i] = groupSize[i];
+    }
+    context.entryPointParams = entryPointParams;
+    context.globalParams = globalParams;
+
+    const size_t threadCount = size_t(groupSize[0]) * groupSize[1] * groupSize[2];
+
+    // The same fibers are used for every group
+    FiberGroup fiberGroup;
+    for (uint32_t z = 0; z < groupCount[2]; ++z)
+    {
+        for (uint32_t y = 0; y < groupCount[1]; ++y)
+        {
+            for (uint32_t x = 0; x < groupCount[0]; ++x)
+            {
+                context.groupID[0] = x;
+                context.groupID[1] = y;
+                context.groupID[2] = z;
+                SLANG_RETURN_ON_FAIL(fiberGroup.run(threadCount, &_runComputeThread, &context));
+            }
+        }
+    }
+    return SLANG_OK;
+}
+
+} // namespace slang_llvm
@@ -0,0 +1,61 @@
+#ifndef SLANG_LLVM_DISPATCH_H
+#define SLANG_LLVM_DISPATCH_H
+
+// Running compute kernels over a grid of groups, on the threads of a DispatchThreadPool or as fibers.
+
+#include <slang.h>
+
+#include <core/slang-smart-pointer.h>
+
+#include "slang-llvm.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace slang_llvm {
+
+/* Threads that run the groups of dispatches. The thread calling run is always one of the workers, and other threads are
+only started when first needed. Only one dispatch can use the threads at a time, other dispatches wait for them. */
+class DispatchThreadPool : public Slang::RefObject
+{
+public:
+    typedef void (*Func)(uint32_t workerIndex, void* userData);
+
+        /// Run func on workerCount workers, with the calling thread being worker 0, returning when all have returned.
+        /// If called by a worker of a dispatch (so the threads may be in use), only the calling thread runs func, so func
+        /// must not depend on other workers running.
+    void run(uint32_t workerCount, Func func, void* userData);
+
+    ~DispatchThreadPool();
+
+protected:
+    void _threadMain(uint32_t workerIndex, uint64_t generation);
+
+    std::mutex m_runMutex;                          ///< Held by the thread in run while the threads are used
+
+    std::mutex m_mutex;
+    std::condition_variable m_startCondition;
+    std::condition_variable m_completeCondition;
+    std::vector<std::thread> m_threads;
+
+    uint64_t m_generation = 0;                      ///< Incremented each time the threads are started
+    uint32_t m_workerCount = 0;
+    uint32_t m_runningCount = 0;                    ///< Threads (other than the caller) that haven't completed
+    Func m_func = nullptr;
+    void* m_userData = nullptr;
+    bool m_isShutdown = false;
+};
+
+// Runs the dispatch described by desc, by calling func for chunks of the groups on the threads of pool.
+// If pool is nullptr every chunk is run on the calling thread.
+SlangResult runDispatch(DispatchThreadPool* pool, LLVMComputeFunc func, const LLVMDispatchDesc& desc);
+
+// Runs every group of the grid in turn on the calling thread, running the threads of each group as fibers,
+// such that threadFunc can use group memory barriers.
+SlangResult runGroupsAsFibers(LLVMComputeThreadFunc threadFunc, const uint32_t groupCount[3], const uint32_t groupSize[3], void* entryPointParams, void* globalParams);
+
+} // namespace slang_llvm
+
+#endif
@@ -0,0 +1,405 @@
+// ucontext (only used on processors without an assembly context switch) requires _XOPEN_SOURCE on Apple platforms, which
+// must be defined before any system header is included. _DARWIN_C_SOURCE keeps the rest of the API (such as MAP_ANON).
+#if defined(__APPLE__)
+#   define _XOPEN_SOURCE 600
+#   define _DARWIN_C_SOURCE
+#endif
+
+#include "slang-llvm-fiber.h"
+
+#if SLANG_WINDOWS_FAMILY
+#   define SLANG_LLVM_FIBER_WINDOWS 1
+#elif SLANG_PROCESSOR_X86_64 || SLANG_PROCESSOR_ARM_64
+#   define SLANG_LLVM_FIBER_ASM 1
+#else
+#   define SLANG_LLVM_FIBER_UCONTEXT 1
+#endif
+
+#if SLANG_LLVM_FIBER_WINDOWS
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <stdint.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   if SLANG_LLVM_FIBER_UCONTEXT
+#       if SLANG_APPLE_FAMILY
+// ucontext is deprecated (but still supported)
+#           pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#       endif
+#       include <ucontext.h>
+#   endif
+#endif
+
+#if SLANG_LLVM_FIBER_ASM
+
+/* Switching saves the callee saved registers on the current stack, stores the stack pointer to *outStackPointer, then
+loads stackPointer and restores the registers saved on that stack. As the switch is a call, the caller saved registers
+are already saved by the compiler as needed. The floating point control state isn't switched, as all fibers run on the
+same thread.
+
+A new fiber's stack is set up as if it had switched away, with the fiber and its entry function in callee saved
+registers, and a return address of slang_llvm_startFiber, which calls the entry function with the fiber. */
+extern "C" void slang_llvm_switchFiberContext(void** outStackPointer, void* stackPointer);
+extern "C" void slang_llvm_startFiber();
+
+#   if SLANG_APPLE_FAMILY
+#       define SLANG_LLVM_FIBER_ASM_FUNC(name) ".private_extern _" #name "\n.globl _" #name "\n.p2align 4\n_" #name ":\n"
+#   else
+#       define SLANG_LLVM_FIBER_ASM_FUNC(name) ".hidden " #name "\n.globl " #name "\n.p2align 4\n" #name ":\n"
+#   endif
+
+#   if SLANG_PROCESSOR_X86_64
+
+// Stack layout of a switched out fiber, from the stack pointer: r15, r14, r13, r12, rbx, rbp, return address
+__asm__(
+    ".text\n"
+    SLANG_LLVM_FIBER_ASM_FUNC(slang_llvm_switchFiberContext)
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    SLANG_LLVM_FIBER_ASM_FUNC(slang_llvm_startFiber)
+    "    movq %r12, %rdi\n"
+    "    andq $-16, %rsp\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+);
+
+static const size_t kFiberArgIndex = 3;             ///< r12
+static const size_t kEntryIndex = 2;                ///< r13
+static const size_t kReturnAddressIndex = 6;
+// Space for the saved registers and the return address, keeping the stack 16 byte aligned
+static const size_t kInitialFrameSize = 8 * sizeof(void*);
+
+#   else
+
+// Stack layout of a switched out fiber, from the stack pointer: x19 to x30 (x29 is the frame pointer, x30 the return
+// address), then d8 to d15
+__asm__(
+    ".text\n"
+    SLANG_LLVM_FIBER_ASM_FUNC(slang_llvm_switchFiberContext)
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    SLANG_LLVM_FIBER_ASM_FUNC(slang_llvm_startFiber)
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n"
+);
+
+static const size_t kFiberArgIndex = 0;             ///< x19
+static const size_t kEntryIndex = 1;                ///< x20
+static const size_t kReturnAddressIndex = 11;       ///< x30
+static const size_t kInitialFrameSize = 160;
+
+#   endif
+
+#endif // SLANG_LLVM_FIBER_ASM
+
+namespace slang_llvm {
+
+// The group running lanes on this thread, if any
+static thread_local FiberGroup* s_currentGroup = nullptr;
+
+struct FiberGroup::Fiber
+{
+    enum class State
+    {
+        Ready,
+        AtBarrier,
+        Complete,
+    };
+
+        /// Runs lanes of the group. Each time a lane completes, switches back to the scheduler, which only switches
+        /// back when there is another lane to run. So never returns.
+    static void runLanes(Fiber* fiber)
+    {
+        FiberGroup* group = fiber->group;
+        for (;;)
+        {
+            group->m_func(fiber->laneIndex, group->m_userData);
+
+            fiber->state = State::Complete;
+            group->_switchToScheduler(fiber);
+        }
+    }
+
+#if SLANG_LLVM_FIBER_WINDOWS
+    static void WINAPI entry(void* param)
+    {
+        runLanes((Fiber*)param);
+    }
+
+    void* handle = nullptr;
+#else
+#   if SLANG_LLVM_FIBER_ASM
+        /// Called by slang_llvm_startFiber
+    static void entry(Fiber* fiber)
+    {
+        runLanes(fiber);
+    }
+
+    void* stackPointer = nullptr;               ///< Where the registers are saved while switched out
+#   else
+    // makecontext can only pass int parameters, so the pointer is split in two
+    static void entry(int low, int high)
+    {
+        const uint64_t value = (uint64_t(uint32_t(high)) << 32) | uint64_t(uint32_t(low));
+        runLanes((Fiber*)uintptr_t(value));
+    }
+
+    ucontext_t context;
+#   endif
+    void* stackMapping = nullptr;               ///< The stack, starting with the guard page
+    size_t stackMappingSize = 0;
+#endif
+
+    FiberGroup* group = nullptr;
+    size_t laneIndex = 0;
+    State state = State::Ready;
+};
+
+#if !SLANG_LLVM_FIBER_WINDOWS
+
+// Maps a stack of at least size bytes above a guard page, so an overflow faults rather than writing over other memory
+static SlangResult _mapStack(size_t size, void*& outMapping, size_t& outMappingSize)
+{
+    const size_t pageSize = size_t(::sysconf(_SC_PAGESIZE));
+    const size_t mappingSize = ((size + pageSize - 1) / pageSize + 1) * pageSize;
+
+    void* mapping = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return SLANG_E_OUT_OF_MEMORY;
+    }
+    // Stacks grow down, so the guard page is the lowest
+    if (::mprotect(mapping, pageSize, PROT_NONE) != 0)
+    {
+        ::munmap(mapping, mappingSize);
+        return SLANG_FAIL;
+    }
+
+    outMapping = mapping;
+    outMappingSize = mappingSize;
+    return SLANG_OK;
+}
+
+#endif
+
+FiberGroup::FiberGroup(size_t stackSize):
+    m_stackSize(stackSize),
+    m_scheduler(new Fiber)
+{
+}
+
+FiberGroup::~FiberGroup()
+{
+    // The fibers are all waiting to run another lane, so can just be freed
+    for (auto& fiber : m_fibers)
+    {
+#if SLANG_LLVM_FIBER_WINDOWS
+        DeleteFiber(fiber->handle);
+#else
+        ::munmap(fiber->stackMapping, fiber->stackMappingSize);
+#endif
+    }
+
+#if SLANG_LLVM_FIBER_WINDOWS
+    if (m_hasConvertedThread)
+    {
+        ConvertFiberToThread();
+    }
+#endif
+}
+
+void FiberGroup::_switchToFiber(Fiber* fiber)
+{
+    m_currentFiber = fiber;
+#if SLANG_LLVM_FIBER_WINDOWS
+    SwitchToFiber(fiber->handle);
+#elif SLANG_LLVM_FIBER_ASM
+    slang_llvm_switchFiberContext(&m_scheduler->stackPointer, fiber->stackPointer);
+#else
+    swapcontext(&m_scheduler->context, &fiber->context);
+#endif
+    m_currentFiber = nullptr;
+}
+
+void FiberGroup::_switchToScheduler(Fiber* fiber)
+{
+#if SLANG_LLVM_FIBER_WINDOWS
+    SLANG_UNUSED(fiber);
+    SwitchToFiber(m_scheduler->handle);
+#elif SLANG_LLVM_FIBER_ASM
+    slang_llvm_switchFiberContext(&fiber->stackPointer, m_scheduler->stackPointer);
+#else
+    swapcontext(&fiber->context, &m_scheduler->context);
+#endif
+}
+
+SlangResult FiberGroup::_createFiber(std::unique_ptr<Fiber>& outFiber)
+{
+    std::unique_ptr<Fiber> fiber(new Fiber);
+    fiber->group = this;
+
+#if SLANG_LLVM_FIBER_WINDOWS
+    // The stack is reserved and committed as it's used, with a guard page maintained by Windows
+    fiber->handle = CreateFiberEx(0, m_stackSize, FIBER_FLAG_FLOAT_SWITCH, &Fiber::entry, fiber.get());
+    if (!fiber->handle)
+    {
+        return SLANG_E_OUT_OF_MEMORY;
+    }
+#else
+    SLANG_RETURN_ON_FAIL(_mapStack(m_stackSize, fiber->stackMapping, fiber->stackMappingSize));
+    uint8_t* const stackTop = (uint8_t*)fiber->stackMapping + fiber->stackMappingSize;
+
+#   if SLANG_LLVM_FIBER_ASM
+    // Set up the stack as if the fiber had switched out, such that switching to it starts slang_llvm_startFiber
+    void** frame = (void**)(stackTop - kInitialFrameSize);
+    for (size_t i = 0; i < kInitialFrameSize / sizeof(void*); ++i)
+    {
+        frame[i] = nullptr;
+    }
+    frame[kFiberArgIndex] = fiber.get();
+    frame[kEntryIndex] = (void*)&Fiber::entry;
+    frame[kReturnAddressIndex] = (void*)&slang_llvm_startFiber;
+    fiber->stackPointer = frame;
+#   else
+    if (getcontext(&fiber->context) != 0)
+    {
+        ::munmap(fiber->stackMapping, fiber->stackMappingSize);
+        return SLANG_FAIL;
+    }
+    // The stack given to makecontext excludes the guard page
+    const size_t pageSize = size_t(::sysconf(_SC_PAGESIZE));
+    fiber->context.uc_stack.ss_sp = (uint8_t*)fiber->stackMapping + pageSize;
+    fiber->context.uc_stack.ss_size = size_t(stackTop - (uint8_t*)fiber->context.uc_stack.ss_sp);
+    fiber->context.uc_link = nullptr;
+
+    const uint64_t value = uint64_t(uintptr_t(fiber.get()));
+    makecontext(&fiber->context, (void (*)())&Fiber::entry, 2, int(uint32_t(value)), int(uint32_t(value >> 32)));
+#   endif
+#endif
+
+    outFiber = std::move(fiber);
+    return SLANG_OK;
+}
+
+SlangResult FiberGroup::run(size_t laneCount, Func func, void* userData)
+{
+    // Create any fibers needed. They are kept, so later runs (such as the other groups of a dispatch) reuse them.
+    while (m_fibers.size() < laneCount)
+    {
+        std::unique_ptr<Fiber> fiber;
+        SLANG_RETURN_ON_FAIL(_createFiber(fiber));
+        m_fibers.push_back(std::move(fiber));
+    }
+
+#if SLANG_LLVM_FIBER_WINDOWS
+    // Switching between fibers requires the thread to be a fiber. It's converted once, and converted back when the
+    // group is destroyed, as converting is relatively expensive.
+    if (!m_scheduler->handle)
+    {
+        if (IsThreadAFiber())
+        {
+            m_scheduler->handle = GetCurrentFiber();
+        }
+        else
+        {
+            m_scheduler->handle = ConvertThreadToFiberEx(nullptr, FIBER_FLAG_FLOAT_SWITCH);
+            m_hasConvertedThread = (m_scheduler->handle != nullptr);
+        }
+        if (!m_scheduler->handle)
+        {
+            return SLANG_FAIL;
+        }
+    }
+#endif
+
+    m_func = func;
+    m_userData = userData;
+
+    for (size_t i = 0; i < laneCount; ++i)
+    {
+        m_fibers[i]->laneIndex = i;
+        m_fibers[i]->state = Fiber::State::Ready;
+    }
+
+    // This thread may already be running the lane of another group
+    FiberGroup* const previousGroup = s_currentGroup;
+    s_currentGroup = this;
+
+    // Each pass runs every lane up to its next barrier, so when a pass ends all lanes are at the same barrier
+    size_t remainingCount = laneCount;
+    while (remainingCount > 0)
+    {
+        for (size_t i = 0; i < laneCount; ++i)
+        {
+            Fiber* fiber = m_fibers[i].get();
+            if (fiber->state == Fiber::State::Complete)
+            {
+                continue;
+            }
+
+            fiber->state = Fiber::State::Ready;
+            _switchToFiber(fiber);
+
+            if (fiber->state == Fiber::State::Complete)
+            {
+                --remainingCount;
+            }
+        }
+    }
+
+    s_currentGroup = previousGroup;
+    return SLANG_OK;
+}
+
+/* static */void FiberGroup::barrier()
+{
+    FiberGroup* group = s_currentGroup;
+    if (group && group->m_currentFiber)
+    {
+        Fiber* fiber = group->m_currentFiber;
+        fiber->state = Fiber::State::AtBarrier;
+        group->_switchToScheduler(fiber);
+    }
+}
+
+} // namespace slang_llvm
@@ -0,0 +1,67 @@
+#ifndef SLANG_LLVM_FIBER_H
+#define SLANG_LLVM_FIBER_H
+
+// Running the threads of a compute workgroup as fibers on a single thread.
+
+#include <slang.h>
+
+#include <memory>
+#include <vector>
+
+namespace slang_llvm {
+
+/* Runs a number of 'lanes' of a function as fibers on the calling thread. A lane that calls barrier is suspended until
+every other lane has reached a barrier (or completed), such that group memory barriers in compute kernels can be
+implemented without OS threads or spinning.
+
+Lanes are scheduled round robin, each running until its next barrier. Fibers (and their stacks) are kept, so running
+the same amount of lanes again doesn't allocate. Switching between fibers only saves and restores the callee saved
+registers (on x86-64 and AArch64), and each stack has a guard page below it, so an overflow faults. */
+class FiberGroup
+{
+public:
+    typedef void (*Func)(size_t laneIndex, void* userData);
+
+        /// Run func for every lane from 0 to laneCount - 1, returning when all have completed.
+    SlangResult run(size_t laneCount, Func func, void* userData);
+
+        /// Called by a lane to wait for all other lanes of its group to reach a barrier.
+        /// Does nothing if not called from a lane, as the caller is the only thread in its group.
+    static void barrier();
+
+        /// Kernels run as fibers are typically shallow, and there is a stack for every thread of a group
+    static const size_t kDefaultStackSize = 64 * 1024;
+
+    FiberGroup(size_t stackSize = kDefaultStackSize);
+    ~FiberGroup();
+
+private:
+    // Disable copy
+    FiberGroup(const FiberGroup&) = delete;
+    void operator=(const FiberGroup&) = delete;
+
+    struct Fiber;
+
+        /// Create a fiber with its stack, that will run lanes of the group
+    SlangResult _createFiber(std::unique_ptr<Fiber>& outFiber);
+        /// Switch from the scheduler to the fiber, returning when it reaches a barrier or completes
+    void _switchToFiber(Fiber* fiber);
+        /// Switch from the fiber back to the scheduler
+    void _switchToScheduler(Fiber* fiber);
+
+    size_t m_stackSize;
+
+    std::vector<std::unique_ptr<Fiber>> m_fibers;
+    std::unique_ptr<Fiber> m_scheduler;         ///< Context of the thread calling run
+    Fiber* m_currentFiber = nullptr;            ///< The running lane, or nullptr if the scheduler is running
+#if SLANG_WINDOWS_FAMILY
+    bool m_hasConvertedThread = false;          ///< Set if the thread was converted to a fiber by run
+#endif
+
+    Func m_func = nullptr;
+    void* m_userData = nullptr;
+};
+
+} // namespace slang_llvm
+
+#endif // SLANG_LLVM_FIBER_H
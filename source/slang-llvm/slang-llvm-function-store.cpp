@@ -0,0 +1,419 @@
+#include "slang-llvm-compiler.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <compiler-core/slang-artifact-associated-impl.h>
+
+namespace slang_llvm {
+
+using namespace llvm;
+using namespace llvm::orc;
+
+using namespace Slang;
+
+// Names of functions in a FunctionStore start with this, followed by a hash of their IR
+static const char kSharedFunctionPrefix[] = "slang_llvm_shared_";
+
+void findReferencedGlobals(Value* value, SetVector<GlobalValue*>& outGlobals)
+{
+    if (auto globalValue = dyn_cast<GlobalValue>(value))
+    {
+        outGlobals.insert(globalValue);
+    }
+    else if (auto metadataValue = dyn_cast<MetadataAsValue>(value))
+    {
+        if (auto valueMetadata = dyn_cast<ValueAsMetadata>(metadataValue->getMetadata()))
+        {
+            findReferencedGlobals(valueMetadata->getValue(), outGlobals);
+        }
+    }
+    else if (auto constant = dyn_cast<Constant>(value))
+    {
+        for (Value* operand : constant->operands())
+        {
+            findReferencedGlobals(operand, outGlobals);
+        }
+    }
+}
+
+// A function can be shared if only its module uses it (or shareExported is set), and everything it references is the
+// same wherever it's used. That is functions and variables defined outside of the module (such as runtime and shared
+// functions), and constant data, which is copied. outGlobals receives everything the function references.
+static bool _canShareFunction(Function& func, bool shareExported, SetVector<GlobalValue*>& outGlobals)
+{
+    const bool canShareLinkage = func.hasLocalLinkage() || func.hasLinkOnceODRLinkage() || (shareExported && func.hasExternalLinkage());
+    if (func.isDeclaration() || !canShareLinkage ||
+        func.hasPersonalityFn() || func.hasPrefixData() || func.hasPrologueData())
+    {
+        return false;
+    }
+
+    for (Instruction& inst : instructions(func))
+    {
+        for (Value* operand : inst.operands())
+        {
+            findReferencedGlobals(operand, outGlobals);
+        }
+    }
+
+    for (GlobalValue* globalValue : outGlobals)
+    {
+        if (globalValue->isDeclaration())
+        {
+            continue;
+        }
+
+        auto variable = dyn_cast<GlobalVariable>(globalValue);
+        if (!variable || !variable->isConstant() || !variable->hasLocalLinkage())
+        {
+            return false;
+        }
+
+        // The data can only be copied if it doesn't reference anything else
+        SetVector<GlobalValue*> initializerGlobals;
+        findReferencedGlobals(variable->getInitializer(), initializerGlobals);
+        if (!initializerGlobals.empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Creates a module holding a copy of func, with declarations of what it references and copies of its constant data.
+// The copy is named after a hash of the module, which only depends on the content of the function.
+static std::unique_ptr<llvm::Module> _cloneForSharing(Function& func, const SetVector<GlobalValue*>& globals)
+{
+    llvm::Module& module = *func.getParent();
+
+    // The module ID and source file name are part of the hash, so are the same for every function
+    std::unique_ptr<llvm::Module> shared = std::make_unique<llvm::Module>("shared", module.getContext());
+    shared->setSourceFileName("shared");
+    shared->setDataLayout(module.getDataLayout());
+    shared->setTargetTriple(module.getTargetTriple());
+
+    ValueToValueMapTy valueMap;
+    uint32_t dataCount = 0;
+    for (GlobalValue* globalValue : globals)
+    {
+        if (auto function = dyn_cast<Function>(globalValue))
+        {
+            Function* declaration = Function::Create(function->getFunctionType(), GlobalValue::ExternalLinkage, function->getAddressSpace(), function->getName(), shared.get());
+            declaration->setAttributes(function->getAttributes());
+            valueMap[function] = declaration;
+            continue;
+        }
+
+        auto variable = cast<GlobalVariable>(globalValue);
+        auto copy = new GlobalVariable(*shared, variable->getValueType(), variable->isConstant(), GlobalValue::ExternalLinkage, nullptr, variable->getName(), nullptr, variable->getThreadLocalMode(), variable->getAddressSpace());
+        copy->copyAttributesFrom(variable);
+        if (!variable->isDeclaration())
+        {
+            // Renamed, as the name in module doesn't change what the function does
+            copy->setName("data" + Twine(dataCount++));
+            copy->setLinkage(GlobalValue::PrivateLinkage);
+            copy->setInitializer(variable->getInitializer());
+        }
+        valueMap[variable] = copy;
+    }
+
+    Function* copy = Function::Create(func.getFunctionType(), GlobalValue::ExternalLinkage, func.getAddressSpace(), kSharedFunctionPrefix, shared.get());
+    auto copyArg = copy->arg_begin();
+    for (const Argument& arg : func.args())
+    {
+        valueMap[&arg] = &*copyArg++;
+    }
+
+    SmallVector<ReturnInst*, 8> returns;
+    CloneFunctionInto(copy, &func, valueMap, CloneFunctionChangeType::DifferentModule, returns);
+
+    copy->setLinkage(GlobalValue::ExternalLinkage);
+    copy->setVisibility(GlobalValue::DefaultVisibility);
+    copy->setDSOLocal(false);
+    copy->setComdat(nullptr);
+
+    // Cloning adds this even though there is no debug info
+    if (NamedMDNode* compileUnits = shared->getNamedMetadata("llvm.dbg.cu"))
+    {
+        if (compileUnits->getNumOperands() == 0)
+        {
+            shared->eraseNamedMetadata(compileUnits);
+        }
+    }
+
+    std::string text;
+    raw_string_ostream stream(text);
+    shared->print(stream, nullptr);
+    stream.flush();
+
+    MD5 hash;
+    hash.update(text);
+    MD5::MD5Result result;
+    hash.final(result);
+
+    copy->setName(kSharedFunctionPrefix + result.digest().str());
+    return shared;
+}
+
+// Replaces func by a declaration of the shared function called name, or by existing if it isn't null
+static void _replaceBySharedFunction(Function& func, StringRef name, Function* existing)
+{
+    if (existing)
+    {
+        func.replaceAllUsesWith(existing);
+        func.eraseFromParent();
+        return;
+    }
+
+    // The shared function is in another JIT, so may not be close enough to call directly
+    func.deleteBody();
+    func.setName(name);
+    func.setVisibility(GlobalValue::DefaultVisibility);
+    func.setDSOLocal(false);
+    func.setComdat(nullptr);
+}
+
+/* Replaces the functions of module that can be shared with declarations of shared functions, which are named after
+a hash of their content. Functions with the same content in the module are replaced by the same declaration.
+outSharedModules receives a module for each shared function, holding its definition.
+
+If shareExported is set functions that are exported are replaced too, and outAliases receives the original name and the
+name of the shared function for each of them, as they must remain available by their original name. Exported functions
+must have distinct addresses, so an exported function that is identical to another exported function isn't replaced.
+
+A function that calls a function defined in the module can't be shared, but can be once its callees have been replaced
+by declarations. So functions are shared from the bottom of the call graph up, each being checked (and hashed) once all
+of its callees have been shared. As functions that call a shared function use its hashed name, their hash depends on the
+content of everything they call. */
+static void _shareFunctions(llvm::Module& module, bool shareExported, std::vector<std::unique_ptr<llvm::Module>>& outSharedModules, std::vector<std::pair<std::string, std::string>>& outAliases)
+{
+    // For each function, the amount of functions defined in the module that it references and that haven't been shared
+    DenseMap<Function*, uint32_t> pendingCounts;
+    DenseMap<Function*, SmallVector<Function*, 4>> callers;
+
+    // The shared functions that an exported function is an alias of
+    StringSet<> exportedNames;
+
+    std::vector<Function*> readyFuncs;
+    for (Function& func : module)
+    {
+        if (func.isDeclaration())
+        {
+            continue;
+        }
+
+        SetVector<GlobalValue*> globals;
+        for (Instruction& inst : instructions(func))
+        {
+            for (Value* operand : inst.operands())
+            {
+                findReferencedGlobals(operand, globals);
+            }
+        }
+
+        uint32_t pendingCount = 0;
+        for (GlobalValue* globalValue : globals)
+        {
+            auto callee = dyn_cast<Function>(globalValue);
+            if (callee && !callee->isDeclaration())
+            {
+                // A function that references itself can never be shared, so is never ready
+                pendingCount++;
+                callers[callee].push_back(&func);
+            }
+        }
+
+        pendingCounts[&func] = pendingCount;
+        if (pendingCount == 0)
+        {
+            readyFuncs.push_back(&func);
+        }
+    }
+
+    while (readyFuncs.size())
+    {
+        Function& func = *readyFuncs.back();
+        readyFuncs.pop_back();
+
+        SetVector<GlobalValue*> globals;
+        if (!_canShareFunction(func, shareExported, globals))
+        {
+            // Its callers reference a definition, so can't be shared either
+            continue;
+        }
+
+        std::unique_ptr<llvm::Module> shared = _cloneForSharing(func, globals);
+        const std::string name = shared->getFunctionList().back().getName().str();
+
+        if (func.hasExternalLinkage() && !exportedNames.insert(name).second)
+        {
+            // Merging it would give two exported functions the same address. Its callers can't be shared, as it remains
+            // a definition.
+            continue;
+        }
+
+        // The callers can be checked once all their callees have been replaced
+        auto callersIt = callers.find(&func);
+        if (callersIt != callers.end())
+        {
+            for (Function* caller : callersIt->second)
+            {
+                if (--pendingCounts[caller] == 0)
+                {
+                    readyFuncs.push_back(caller);
+                }
+            }
+        }
+
+        Function* existing = module.getFunction(name);
+        if (!existing && func.hasExternalLinkage())
+        {
+            // Callers must use the hashed name, so the original name is only kept as an alias
+            existing = Function::Create(func.getFunctionType(), GlobalValue::ExternalLinkage, func.getAddressSpace(), name, &module);
+            existing->setAttributes(func.getAttributes());
+            outSharedModules.push_back(std::move(shared));
+        }
+        else if (!existing)
+        {
+            outSharedModules.push_back(std::move(shared));
+        }
+
+        // An identical function may already have been shared, or func is exported
+        if (existing && func.hasExternalLinkage())
+        {
+            outAliases.push_back(std::make_pair(func.getName().str(), name));
+        }
+        _replaceBySharedFunction(func, name, existing);
+    }
+}
+
+SharedFunctions::~SharedFunctions()
+{
+    store->_releaseFunctions(functionNames);
+}
+
+void FunctionStore::_releaseFunctions(const std::vector<std::string>& functionNames)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const std::string& name : functionNames)
+    {
+        auto it = m_functions.find(name);
+        if (it == m_functions.end() || --it->second.useCount > 0)
+        {
+            continue;
+        }
+
+        // Every library that called the function has been released, so its code can be freed. A function that calls
+        // it is held by the same libraries, so has been (or is being) removed too.
+        if (auto err = it->second.tracker->remove())
+        {
+            consumeError(std::move(err));
+        }
+        m_functions.erase(it);
+    }
+}
+
+SlangResult FunctionStore::shareFunctions(llvm::Module& module, bool shareExported, std::vector<std::pair<std::string, void*>>& outSymbols, RefPtr<SharedFunctions>& outShared)
+{
+    std::vector<std::unique_ptr<llvm::Module>> sharedModules;
+    std::vector<std::pair<std::string, std::string>> aliases;
+    _shareFunctions(module, shareExported, sharedModules, aliases);
+
+    if (sharedModules.empty())
+    {
+        return SLANG_OK;
+    }
+
+    // Releases the uses taken so far if this fails. Declared before the lock, so is destroyed after it's unlocked.
+    RefPtr<SharedFunctions> shared(new SharedFunctions(this));
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_jit)
+        {
+            ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
+            JITDylib* runtimeLib = nullptr;
+            SLANG_RETURN_ON_FAIL(createJIT(false, false, nullptr, m_runtimeSymbols, diagnostics, m_jit, runtimeLib));
+            m_jit->getMainJITDylib().addToLinkOrder(*runtimeLib);
+        }
+
+        for (const auto& sharedModule : sharedModules)
+        {
+            const StringRef name = sharedModule->getFunctionList().back().getName();
+
+            StoredFunction& stored = m_functions[name];
+            if (stored.useCount++ > 0)
+            {
+                // Already added by another compilation
+                shared->functionNames.push_back(name.str());
+                continue;
+            }
+
+            // The JIT takes ownership of the context of the module, so it's moved to a context of its own
+            SmallVector<char, 0> bitcode;
+            raw_svector_ostream stream(bitcode);
+            WriteBitcodeToFile(*sharedModule, stream);
+
+            std::unique_ptr<LLVMContext> llvmContext = std::make_unique<LLVMContext>();
+            auto moduleExpected = parseBitcodeFile(MemoryBufferRef(StringRef(bitcode.data(), bitcode.size()), "shared"), *llvmContext);
+            if (!moduleExpected)
+            {
+                consumeError(moduleExpected.takeError());
+                m_functions.erase(name);
+                return SLANG_FAIL;
+            }
+
+            // Each function has a tracker of its own, so its code can be removed when it's no longer used
+            stored.tracker = m_jit->getMainJITDylib().createResourceTracker();
+            if (auto err = m_jit->addIRModule(stored.tracker, ThreadSafeModule(std::move(*moduleExpected), std::move(llvmContext))))
+            {
+                consumeError(std::move(err));
+                m_functions.erase(name);
+                return SLANG_FAIL;
+            }
+            shared->functionNames.push_back(name.str());
+        }
+    }
+
+    // Looking up the functions generates their code if necessary, which can take place outside of the lock as the uses
+    // that are held keep them in the store
+    for (const auto& sharedModule : sharedModules)
+    {
+        const StringRef name = sharedModule->getFunctionList().back().getName();
+
+        auto symbolExpected = m_jit->lookup(name);
+        if (!symbolExpected)
+        {
+            consumeError(symbolExpected.takeError());
+            return SLANG_FAIL;
+        }
+        outSymbols.push_back(std::make_pair(name.str(), (void*)symbolExpected->getAddress()));
+    }
+
+    for (const auto& alias : aliases)
+    {
+        auto symbolExpected = m_jit->lookup(alias.second);
+        if (!symbolExpected)
+        {
+            consumeError(symbolExpected.takeError());
+            return SLANG_FAIL;
+        }
+        outSymbols.push_back(std::make_pair(alias.first, (void*)symbolExpected->getAddress()));
+    }
+
+    outShared = shared;
+    return SLANG_OK;
+}
+
+} // namespace slang_llvm
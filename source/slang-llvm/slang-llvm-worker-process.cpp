@@ -0,0 +1,490 @@
+#include "slang-llvm-worker-process.h"
+
+#include <algorithm>
+
+#if SLANG_WINDOWS_FAMILY
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+
+#   include <vector>
+#else
+#   include <dlfcn.h>
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <poll.h>
+#   include <signal.h>
+#   include <spawn.h>
+#   include <sys/wait.h>
+#   include <time.h>
+#   include <unistd.h>
+
+#   include <mutex>
+
+extern char** environ;
+
+// If pipes can be created close-on-exec in one step
+#   if SLANG_LINUX_FAMILY || defined(__FreeBSD__)
+#       define SLANG_LLVM_HAS_PIPE2 1
+#   else
+#       define SLANG_LLVM_HAS_PIPE2 0
+#   endif
+#endif
+
+namespace slang_llvm {
+
+#if SLANG_WINDOWS_FAMILY
+
+SlangResult CompileWorkerProcess::start(const std::string& workerPath, const std::string& libraryPath)
+{
+    kill();
+
+    // The pipes are created such that they aren't inherited. Only the child's ends are made inheritable, and they are
+    // passed in a handle list, such that no other process started at the same time inherits them.
+    HANDLE childStdinRead = nullptr, childStdinWrite = nullptr;
+    HANDLE childStdoutRead = nullptr, childStdoutWrite = nullptr;
+
+    if (!CreatePipe(&childStdinRead, &childStdinWrite, nullptr, 0))
+    {
+        return SLANG_FAIL;
+    }
+    if (!CreatePipe(&childStdoutRead, &childStdoutWrite, nullptr, 0))
+    {
+        CloseHandle(childStdinRead);
+        CloseHandle(childStdinWrite);
+        return SLANG_FAIL;
+    }
+
+    HANDLE inheritedHandles[3] = { childStdinRead, childStdoutWrite };
+    DWORD inheritedHandleCount = 2;
+
+    SetHandleInformation(childStdinRead, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+    SetHandleInformation(childStdoutWrite, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+
+    // Stderr is shared with this process, if it has one that can be inherited
+    HANDLE stdError = GetStdHandle(STD_ERROR_HANDLE);
+    DWORD stdErrorFlags = 0;
+    if (stdError && stdError != INVALID_HANDLE_VALUE && GetHandleInformation(stdError, &stdErrorFlags) && (stdErrorFlags & HANDLE_FLAG_INHERIT))
+    {
+        inheritedHandles[inheritedHandleCount++] = stdError;
+    }
+    else
+    {
+        stdError = nullptr;
+    }
+
+    SIZE_T attributeListSize = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSize);
+    std::vector<char> attributeListData(attributeListSize);
+    LPPROC_THREAD_ATTRIBUTE_LIST attributeList = LPPROC_THREAD_ATTRIBUTE_LIST(attributeListData.data());
+
+    BOOL created = InitializeProcThreadAttributeList(attributeList, 1, 0, &attributeListSize);
+    if (created)
+    {
+        STARTUPINFOEXA startupInfo = {};
+        startupInfo.StartupInfo.cb = sizeof(startupInfo);
+        startupInfo.StartupInfo.hStdInput = childStdinRead;
+        startupInfo.StartupInfo.hStdOutput = childStdoutWrite;
+        startupInfo.StartupInfo.hStdError = stdError;
+        startupInfo.StartupInfo.dwFlags |= STARTF_USESTDHANDLES;
+        startupInfo.lpAttributeList = attributeList;
+
+        std::string commandLine = "\"" + workerPath + "\" \"" + libraryPath + "\"";
+
+        PROCESS_INFORMATION processInfo = {};
+        created = UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inheritedHandles, inheritedHandleCount * sizeof(HANDLE), nullptr, nullptr) &&
+            CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startupInfo.StartupInfo, &processInfo);
+        DeleteProcThreadAttributeList(attributeList);
+
+        if (created)
+        {
+            CloseHandle(processInfo.hThread);
+            m_process = processInfo.hProcess;
+        }
+    }
+
+    // The child has its own copies of its ends
+    CloseHandle(childStdinRead);
+    CloseHandle(childStdoutWrite);
+
+    if (!created)
+    {
+        CloseHandle(childStdinWrite);
+        CloseHandle(childStdoutRead);
+        return SLANG_FAIL;
+    }
+
+    // Writes shouldn't block, so a host waiting for a worker can stop
+    DWORD pipeMode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+    SetNamedPipeHandleState(childStdinWrite, &pipeMode, nullptr, nullptr);
+
+    m_writePipe = childStdinWrite;
+    m_readPipe = childStdoutRead;
+    m_hasExited = false;
+    return SLANG_OK;
+}
+
+SlangResult CompileWorkerProcess::write(const void* data, size_t size, size_t& outWrittenSize)
+{
+    // As the pipe doesn't wait, only what fits in the pipes buffer is written
+    DWORD written = 0;
+    if (!WriteFile((HANDLE)m_writePipe, data, DWORD(size), &written, nullptr))
+    {
+        return SLANG_FAIL;
+    }
+    outWrittenSize = size_t(written);
+    return SLANG_OK;
+}
+
+void CompileWorkerProcess::waitForWrite(int timeoutInMs)
+{
+    // Anonymous pipes can't be waited on, so the caller polls
+    SLANG_UNUSED(timeoutInMs);
+    Sleep(1);
+}
+
+SlangResult CompileWorkerProcess::read(void* data, size_t size)
+{
+    char* cur = (char*)data;
+    while (size > 0)
+    {
+        // Once the worker has terminated only what's left in the pipe can be read. As another process may have the
+        // write end of the pipe, a read past that could block.
+        DWORD available = 0;
+        if (m_hasExited && (!PeekNamedPipe((HANDLE)m_readPipe, nullptr, 0, nullptr, &available, nullptr) || available == 0))
+        {
+            return SLANG_FAIL;
+        }
+
+        DWORD readCount = 0;
+        if (!ReadFile((HANDLE)m_readPipe, cur, DWORD(size), &readCount, nullptr) || readCount == 0)
+        {
+            return SLANG_FAIL;
+        }
+        cur += readCount;
+        size -= readCount;
+    }
+    return SLANG_OK;
+}
+
+bool CompileWorkerProcess::waitForData(int timeoutInMs)
+{
+    // Anonymous pipes can't be waited on, so poll
+    const DWORD start = GetTickCount();
+    for (;;)
+    {
+        DWORD available = 0;
+        if (!PeekNamedPipe((HANDLE)m_readPipe, nullptr, 0, nullptr, &available, nullptr) || available > 0)
+        {
+            return true;
+        }
+        // If the worker has terminated a read won't block, as it fails once the pipe is empty
+        if (WaitForSingleObject((HANDLE)m_process, 0) == WAIT_OBJECT_0)
+        {
+            m_hasExited = true;
+            return true;
+        }
+        if (GetTickCount() - start >= DWORD(timeoutInMs))
+        {
+            return false;
+        }
+        Sleep(1);
+    }
+}
+
+void CompileWorkerProcess::kill()
+{
+    if (m_process)
+    {
+        TerminateProcess((HANDLE)m_process, 1);
+        WaitForSingleObject((HANDLE)m_process, INFINITE);
+        CloseHandle((HANDLE)m_process);
+        m_process = nullptr;
+    }
+    if (m_writePipe)
+    {
+        CloseHandle((HANDLE)m_writePipe);
+        m_writePipe = nullptr;
+    }
+    if (m_readPipe)
+    {
+        CloseHandle((HANDLE)m_readPipe);
+        m_readPipe = nullptr;
+    }
+}
+
+/* static */SlangResult CompileWorkerProcessUtil::getLibraryPath(std::string& outPath)
+{
+    HMODULE module = nullptr;
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+        (LPCSTR)&CompileWorkerProcessUtil::getLibraryPath, &module))
+    {
+        return SLANG_FAIL;
+    }
+
+    char path[MAX_PATH];
+    const DWORD length = GetModuleFileNameA(module, path, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH)
+    {
+        return SLANG_FAIL;
+    }
+    outPath.assign(path, length);
+    return SLANG_OK;
+}
+
+#else
+
+// How often waitForData checks if the worker has terminated
+static const int kExitCheckIntervalInMs = 50;
+
+#if !SLANG_LLVM_HAS_PIPE2
+static std::mutex s_startMutex;
+#endif
+
+// Creates a pipe with both ends close-on-exec. Returns 0 on success.
+static int _createPipe(int fds[2])
+{
+#if SLANG_LLVM_HAS_PIPE2
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+SlangResult CompileWorkerProcess::start(const std::string& workerPath, const std::string& libraryPath)
+{
+    kill();
+
+    // Creating the pipes and starting the worker is serialized where the pipes can't be created close-on-exec,
+    // such that another worker started at the same time can't inherit them
+#if !SLANG_LLVM_HAS_PIPE2
+    std::lock_guard<std::mutex> startLock(s_startMutex);
+#endif
+
+    int toWorker[2];
+    int fromWorker[2];
+    if (_createPipe(toWorker) != 0)
+    {
+        return SLANG_FAIL;
+    }
+    if (_createPipe(fromWorker) != 0)
+    {
+        close(toWorker[0]);
+        close(toWorker[1]);
+        return SLANG_FAIL;
+    }
+
+    // Writes shouldn't block, so a host waiting for a worker can stop
+    fcntl(toWorker[1], F_SETFL, fcntl(toWorker[1], F_GETFL) | O_NONBLOCK);
+
+    // None of the ends are inherited as they are, as they're all close-on-exec. Duplicating the worker's ends onto
+    // its stdin and stdout clears the flag on the duplicates.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, toWorker[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fromWorker[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, toWorker[0]);
+    posix_spawn_file_actions_addclose(&actions, fromWorker[1]);
+
+    char* argv[] = { const_cast<char*>(workerPath.c_str()), const_cast<char*>(libraryPath.c_str()), nullptr };
+
+    pid_t pid = -1;
+    const int spawnError = posix_spawn(&pid, workerPath.c_str(), &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    // The child has its own copies of its ends
+    close(toWorker[0]);
+    close(fromWorker[1]);
+
+    if (spawnError != 0)
+    {
+        close(toWorker[1]);
+        close(fromWorker[0]);
+        return SLANG_FAIL;
+    }
+
+#if defined(F_SETNOSIGPIPE)
+    // Writing to a terminated worker should fail, not raise SIGPIPE
+    fcntl(toWorker[1], F_SETNOSIGPIPE, 1);
+#endif
+
+    m_pid = int(pid);
+    m_writeFd = toWorker[1];
+    m_readFd = fromWorker[0];
+    return SLANG_OK;
+}
+
+SlangResult CompileWorkerProcess::write(const void* data, size_t size, size_t& outWrittenSize)
+{
+#if !defined(F_SETNOSIGPIPE)
+    // If the worker has terminated the write raises SIGPIPE, which would end this process. Block it on this thread,
+    // and discard it if it was raised.
+    sigset_t pipeSet;
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+
+    sigset_t pendingSet;
+    sigpending(&pendingSet);
+    const bool wasPending = sigismember(&pendingSet, SIGPIPE) == 1;
+
+    sigset_t oldSet;
+    pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+#endif
+
+    SlangResult res = SLANG_OK;
+    int writeError = 0;
+
+    outWrittenSize = 0;
+    for (;;)
+    {
+        const ssize_t written = ::write(m_writeFd, data, size);
+        if (written >= 0)
+        {
+            outWrittenSize = size_t(written);
+            break;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        // The pipe is full
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        writeError = errno;
+        res = SLANG_FAIL;
+        break;
+    }
+
+#if !defined(F_SETNOSIGPIPE)
+    if (writeError == EPIPE && !wasPending)
+    {
+        const timespec zeroTimeout = {};
+        while (sigtimedwait(&pipeSet, nullptr, &zeroTimeout) < 0 && errno == EINTR) {}
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+#endif
+
+    return res;
+}
+
+SlangResult CompileWorkerProcess::read(void* data, size_t size)
+{
+    char* cur = (char*)data;
+    while (size > 0)
+    {
+        const ssize_t readCount = ::read(m_readFd, cur, size);
+        if (readCount < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (readCount <= 0)
+        {
+            // Error, or the worker closed its end
+            return SLANG_FAIL;
+        }
+        cur += readCount;
+        size -= size_t(readCount);
+    }
+    return SLANG_OK;
+}
+
+void CompileWorkerProcess::waitForWrite(int timeoutInMs)
+{
+    pollfd pollFd = {};
+    pollFd.fd = m_writeFd;
+    pollFd.events = POLLOUT;
+
+    // If the worker has terminated the poll returns, and the next write fails
+    poll(&pollFd, 1, timeoutInMs);
+}
+
+bool CompileWorkerProcess::waitForData(int timeoutInMs)
+{
+    pollfd pollFd = {};
+    pollFd.fd = m_readFd;
+    pollFd.events = POLLIN;
+
+    // Polls in slices, checking in between whether the worker has terminated. That's noticed even if another process
+    // has inherited the write end of the pipe, so it's never closed.
+    for (int remainingInMs = timeoutInMs; ; )
+    {
+        const int sliceInMs = std::min(remainingInMs, kExitCheckIntervalInMs);
+        const int res = poll(&pollFd, 1, sliceInMs);
+        // On an error return true, such that the following read fails
+        if (res != 0)
+        {
+            return true;
+        }
+
+        if (m_pid > 0 && waitpid(pid_t(m_pid), nullptr, WNOHANG) == pid_t(m_pid))
+        {
+            // Reaped, so it mustn't be killed or waited on again. Reads no longer block, so they fail once what's
+            // left in the pipe has been read.
+            m_pid = -1;
+            fcntl(m_readFd, F_SETFL, fcntl(m_readFd, F_GETFL) | O_NONBLOCK);
+            return true;
+        }
+
+        remainingInMs -= sliceInMs;
+        if (remainingInMs <= 0)
+        {
+            return false;
+        }
+    }
+}
+
+void CompileWorkerProcess::kill()
+{
+    if (m_pid > 0)
+    {
+        ::kill(pid_t(m_pid), SIGKILL);
+        while (waitpid(pid_t(m_pid), nullptr, 0) < 0 && errno == EINTR) {}
+        m_pid = -1;
+    }
+    if (m_writeFd >= 0)
+    {
+        close(m_writeFd);
+        m_writeFd = -1;
+    }
+    if (m_readFd >= 0)
+    {
+        close(m_readFd);
+        m_readFd = -1;
+    }
+}
+
+/* static */SlangResult CompileWorkerProcessUtil::getLibraryPath(std::string& outPath)
+{
+    Dl_info info;
+    if (dladdr((void*)&CompileWorkerProcessUtil::getLibraryPath, &info) == 0 || info.dli_fname == nullptr)
+    {
+        return SLANG_FAIL;
+    }
+    outPath = info.dli_fname;
+    return SLANG_OK;
+}
+
+#endif
+
+/* static */SlangResult CompileWorkerProcessUtil::getWorkerPath(const std::string& libraryPath, std::string& outPath)
+{
+    const size_t separatorIndex = libraryPath.find_last_of("/\\");
+    const std::string directory = (separatorIndex == std::string::npos) ? std::string() : libraryPath.substr(0, separatorIndex + 1);
+
+#if SLANG_WINDOWS_FAMILY
+    outPath = directory + "slang-llvm-worker.exe";
+#else
+    outPath = directory + "slang-llvm-worker";
+#endif
+    return SLANG_OK;
+}
+
+} // namespace slang_llvm
@@ -0,0 +1,64 @@
+#ifndef SLANG_LLVM_WORKER_PROCESS_H
+#define SLANG_LLVM_WORKER_PROCESS_H
+
+// Starting and communicating with slang-llvm-worker processes, which compilations can be run in.
+
+#include <slang.h>
+
+#include <string>
+
+namespace slang_llvm {
+
+/* A worker process (slang-llvm-worker) that compilations can be sent to. Communication is via the processes stdin and stdout. */
+class CompileWorkerProcess
+{
+public:
+        /// Start the worker executable at workerPath, which will load the slang-llvm shared library at libraryPath.
+    SlangResult start(const std::string& workerPath, const std::string& libraryPath);
+
+        /// Write as much of the data to the worker as can be written without blocking. Fails if the worker has terminated.
+    SlangResult write(const void* data, size_t size, size_t& outWrittenSize);
+        /// Wait up to timeoutInMs for the worker to be able to accept more data
+    void waitForWrite(int timeoutInMs);
+        /// Read exactly size bytes from the worker. Blocks until the data is available.
+        /// Fails if the worker terminates before all of the data is read.
+    SlangResult read(void* data, size_t size);
+
+        /// Wait up to timeoutInMs for data to be available to read. Returns true if there is data, or if the worker
+        /// has terminated (such that a read will not block).
+    bool waitForData(int timeoutInMs);
+
+        /// Terminate the process (if it is running)
+    void kill();
+
+    CompileWorkerProcess() {}
+    ~CompileWorkerProcess() { kill(); }
+
+private:
+    // Disable copy
+    CompileWorkerProcess(const CompileWorkerProcess&) = delete;
+    void operator=(const CompileWorkerProcess&) = delete;
+
+#if SLANG_WINDOWS_FAMILY
+    void* m_process = nullptr;
+    void* m_writePipe = nullptr;
+    void* m_readPipe = nullptr;
+    bool m_hasExited = false;           ///< Set once waitForData finds the process has terminated
+#else
+    int m_pid = -1;
+    int m_writeFd = -1;
+    int m_readFd = -1;
+#endif
+};
+
+struct CompileWorkerProcessUtil
+{
+        /// Get the path of the slang-llvm shared library
+    static SlangResult getLibraryPath(std::string& outPath);
+        /// Get the path to the worker executable, which is expected to be in the same directory as the shared library
+    static SlangResult getWorkerPath(const std::string& libraryPath, std::string& outPath);
+};
+
+} // namespace slang_llvm
+
+#endif // SLANG_LLVM_WORKER_PROCESS_H
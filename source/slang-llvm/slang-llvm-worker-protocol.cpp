@@ -0,0 +1,457 @@
+#include "slang-llvm-worker-protocol.h"
+
+#include <core/slang-blob.h>
+#include <core/slang-string-util.h>
+
+#include <compiler-core/slang-artifact-associated-impl.h>
+
+namespace slang_llvm {
+
+using namespace llvm;
+
+using namespace Slang;
+
+// How often a host waiting for a worker checks if the compilation should stop
+static const int kWorkerPollIntervalInMs = 10;
+// How long a host waits for a worker that has been started to say it's ready
+static const int kWorkerStartTimeoutInMs = 60 * 1000;
+
+static StringRef _asStringRef(const CharSlice& slice)
+{
+    return StringRef(slice.begin(), size_t(slice.count));
+}
+
+static void _writeStrings(CompileMessageWriter& writer, const std::vector<std::string>& strings)
+{
+    writer.writeUInt32(uint32_t(strings.size()));
+    for (const auto& string : strings)
+    {
+        writer.writeString(string);
+    }
+}
+
+static void _readStrings(CompileMessageReader& reader, std::vector<std::string>& outStrings)
+{
+    const uint32_t count = reader.readUInt32();
+    for (uint32_t i = 0; i < count && reader.isValid(); ++i)
+    {
+        outStrings.push_back(reader.readString().str());
+    }
+}
+
+void writeCompileRequest(CompileMessageWriter& writer, const LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions)
+{
+    writer.writeUInt32(uint32_t(request->optimizationLevel));
+    writer.writeUInt32(uint32_t(request->floatingPointMode));
+    writer.writeUInt32(uint32_t(request->targetType));
+    writer.writeUInt32(uint32_t(request->sourceLanguage));
+    _writeStrings(writer, request->defines);
+    _writeStrings(writer, request->includePaths);
+
+    const auto sourceSlice = StringUtil::getSlice(request->sourceBlob);
+    writer.writeString(StringRef(sourceSlice.begin(), sourceSlice.getLength()));
+
+    writer.writeUInt32(uint32_t(llvmOptions.profileMode));
+    const auto profileSlice = llvmOptions.profileData ? StringUtil::getSlice(llvmOptions.profileData) : UnownedStringSlice();
+    writer.writeString(StringRef(profileSlice.begin(), profileSlice.getLength()));
+    writer.writeUInt32(llvmOptions.errorLimit);
+    writer.writeUInt32(uint32_t(llvmOptions.instrumentFunctions));
+    writer.writeUInt32(uint32_t(llvmOptions.vectorizeGroups));
+    writer.writeUInt32(llvmOptions.multiversionLevels);
+    writer.writeUInt32(uint32_t(llvmOptions.keepBitcode));
+    writer.writeUInt32(uint32_t(llvmOptions.shareFunctions));
+    writer.writeUInt32(uint32_t(llvmOptions.incremental));
+    writer.writeUInt32(uint32_t(llvmOptions.keepRepresentations));
+    writer.writeUInt32(uint32_t(llvmOptions.profilerSupport));
+    writer.writeUInt32(uint32_t(llvmOptions.compileStats));
+    writer.writeUInt32(uint32_t(llvmOptions.pipelineProfile));
+
+    const auto& tuningConfig = llvmOptions.tuningConfig;
+    writer.writeUInt32(uint32_t(llvmOptions.useTuningConfig));
+    writer.writeUInt32(uint32_t(tuningConfig.optimizationLevel));
+    writer.writeUInt32(uint32_t(tuningConfig.floatingPointMode));
+    writer.writeUInt32(uint32_t(tuningConfig.unrollLoops));
+    writer.writeUInt32(uint32_t(tuningConfig.vectorizeLoops));
+    writer.writeUInt32(uint32_t(tuningConfig.vectorizeSLP));
+    writer.writeUInt32(tuningConfig.vectorizeWidth);
+
+    // The worker only needs the runtime bitcode, the names of the symbols to know which of its functions to keep
+    // external, and what each library was compiled with to know if it can be used. The symbols themselves are resolved
+    // when the object is added to the JIT in this process.
+    const RuntimeSymbolTable* runtimeSymbols = request->runtimeSymbols;
+    const bool hasBitcode = runtimeSymbols && (!runtimeSymbols->bitcodeModules.empty() || !runtimeSymbols->libraries.empty());
+
+    _writeStrings(writer, hasBitcode ? runtimeSymbols->bitcodeModules : std::vector<std::string>());
+
+    writer.writeUInt32(hasBitcode ? uint32_t(runtimeSymbols->symbolNames.size()) : 0);
+    if (hasBitcode)
+    {
+        for (const auto& entry : runtimeSymbols->symbolNames)
+        {
+            writer.writeString(entry.getKey());
+        }
+    }
+
+    writer.writeUInt32(hasBitcode ? uint32_t(runtimeSymbols->libraries.size()) : 0);
+    if (hasBitcode)
+    {
+        for (const RuntimeLibrary& library : runtimeSymbols->libraries)
+        {
+            writer.writeString(library.bitcode);
+            _writeStrings(writer, library.defines);
+            writer.writeUInt32(uint32_t(library.floatingPointMode));
+
+            writer.writeUInt32(uint32_t(library.functionNames.size()));
+            for (const auto& entry : library.functionNames)
+            {
+                writer.writeString(entry.getKey());
+            }
+        }
+    }
+
+    writer.writeUInt32(uint32_t(request->exportNames.size()));
+    for (const auto& entry : request->exportNames)
+    {
+        writer.writeString(entry.getKey());
+    }
+
+    writer.writeString(request->remarksFilter);
+    writer.writeString(request->passPipeline);
+
+    writer.writeUInt32(uint32_t(llvmOptions.diagnosticCallback != nullptr));
+}
+
+void readCompileRequest(CompileMessageReader& reader, LLVMCompileRequest* request, LLVMCompileOptions& outLLVMOptions, ComPtr<ISlangBlob>& outProfileData, bool& outStreamDiagnostics)
+{
+    typedef LLVMCompileRequest::CompileOptions CompileOptions;
+
+    request->optimizationLevel = CompileOptions::OptimizationLevel(reader.readUInt32());
+    request->floatingPointMode = CompileOptions::FloatingPointMode(reader.readUInt32());
+    request->targetType = SlangCompileTarget(reader.readUInt32());
+    request->sourceLanguage = SlangSourceLanguage(reader.readUInt32());
+    _readStrings(reader, request->defines);
+    _readStrings(reader, request->includePaths);
+
+    const StringRef source = reader.readString();
+    request->sourceBlob = RawBlob::create(source.data(), source.size());
+
+    outLLVMOptions.profileMode = LLVMCompileOptions::ProfileMode(reader.readUInt32());
+    const StringRef profile = reader.readString();
+    if (outLLVMOptions.profileMode == LLVMCompileOptions::ProfileMode::Use)
+    {
+        outProfileData = RawBlob::create(profile.data(), profile.size());
+        outLLVMOptions.profileData = outProfileData;
+    }
+    outLLVMOptions.errorLimit = reader.readUInt32();
+    outLLVMOptions.instrumentFunctions = reader.readUInt32() != 0;
+    outLLVMOptions.vectorizeGroups = reader.readUInt32() != 0;
+    outLLVMOptions.multiversionLevels = reader.readUInt32();
+    outLLVMOptions.keepBitcode = reader.readUInt32() != 0;
+    outLLVMOptions.shareFunctions = reader.readUInt32() != 0;
+    outLLVMOptions.incremental = reader.readUInt32() != 0;
+    outLLVMOptions.keepRepresentations = reader.readUInt32() != 0;
+    outLLVMOptions.profilerSupport = reader.readUInt32() != 0;
+    outLLVMOptions.compileStats = reader.readUInt32() != 0;
+    outLLVMOptions.pipelineProfile = LLVMCompileOptions::PipelineProfile(reader.readUInt32());
+
+    auto& tuningConfig = outLLVMOptions.tuningConfig;
+    outLLVMOptions.useTuningConfig = reader.readUInt32() != 0;
+    tuningConfig.optimizationLevel = CompileOptions::OptimizationLevel(reader.readUInt32());
+    tuningConfig.floatingPointMode = CompileOptions::FloatingPointMode(reader.readUInt32());
+    tuningConfig.unrollLoops = reader.readUInt32() != 0;
+    tuningConfig.vectorizeLoops = reader.readUInt32() != 0;
+    tuningConfig.vectorizeSLP = reader.readUInt32() != 0;
+    tuningConfig.vectorizeWidth = reader.readUInt32();
+
+    RefPtr<RuntimeSymbolTable> runtimeSymbols(new RuntimeSymbolTable);
+    _readStrings(reader, runtimeSymbols->bitcodeModules);
+
+    std::vector<std::string> symbolNames;
+    _readStrings(reader, symbolNames);
+    for (const auto& name : symbolNames)
+    {
+        runtimeSymbols->symbolNames.insert(name);
+    }
+
+    const uint32_t libraryCount = reader.readUInt32();
+    for (uint32_t i = 0; i < libraryCount && reader.isValid(); ++i)
+    {
+        RuntimeLibrary library;
+        library.bitcode = reader.readString().str();
+        _readStrings(reader, library.defines);
+        library.floatingPointMode = CompileOptions::FloatingPointMode(reader.readUInt32());
+
+        const uint32_t functionNameCount = reader.readUInt32();
+        for (uint32_t j = 0; j < functionNameCount && reader.isValid(); ++j)
+        {
+            library.functionNames.insert(reader.readString());
+        }
+        runtimeSymbols->libraries.push_back(std::move(library));
+    }
+    request->runtimeSymbols = runtimeSymbols;
+
+    const uint32_t exportNameCount = reader.readUInt32();
+    for (uint32_t i = 0; i < exportNameCount && reader.isValid(); ++i)
+    {
+        request->exportNames.insert(reader.readString());
+    }
+
+    request->remarksFilter = reader.readString().str();
+    request->passPipeline = reader.readString().str();
+
+    outStreamDiagnostics = reader.readUInt32() != 0;
+}
+
+void writeDiagnostic(CompileMessageWriter& writer, const ArtifactDiagnostic& diagnostic)
+{
+    writer.writeUInt32(uint32_t(diagnostic.severity));
+    writer.writeUInt32(uint32_t(diagnostic.stage));
+    writer.writeUInt32(uint32_t(diagnostic.location.line));
+    writer.writeString(_asStringRef(diagnostic.filePath));
+    writer.writeString(_asStringRef(diagnostic.text));
+}
+
+// Reads a diagnostic written by writeDiagnostic, and passes it to func. The diagnostic is only valid during the call.
+template <typename Func>
+static void _readDiagnostic(CompileMessageReader& reader, const Func& func)
+{
+    ArtifactDiagnostic diagnostic;
+    diagnostic.severity = ArtifactDiagnostic::Severity(reader.readUInt32());
+    diagnostic.stage = ArtifactDiagnostic::Stage(reader.readUInt32());
+    diagnostic.location.line = Int(reader.readUInt32());
+
+    // Copied so they are zero terminated
+    const std::string filePath = reader.readString().str();
+    const std::string text = reader.readString().str();
+
+    diagnostic.filePath = TerminatedCharSlice(filePath.c_str(), Count(filePath.size()));
+    diagnostic.text = TerminatedCharSlice(text.c_str(), Count(text.size()));
+
+    if (reader.isValid())
+    {
+        func(diagnostic);
+    }
+}
+
+void readDiagnostic(CompileMessageReader& reader, const LLVMCompileOptions& llvmOptions)
+{
+    _readDiagnostic(reader, [&](const ArtifactDiagnostic& diagnostic)
+    {
+        if (llvmOptions.diagnosticCallback)
+        {
+            llvmOptions.diagnosticCallback(diagnostic, llvmOptions.diagnosticCallbackUserData);
+        }
+    });
+}
+
+void writeDiagnostics(CompileMessageWriter& writer, IArtifactDiagnostics* diagnostics)
+{
+    const Count count = diagnostics->getCount();
+    writer.writeUInt32(uint32_t(count));
+    for (Index i = 0; i < count; ++i)
+    {
+        writeDiagnostic(writer, *diagnostics->getAt(i));
+    }
+}
+
+void readDiagnostics(CompileMessageReader& reader, IArtifactDiagnostics* diagnostics)
+{
+    const uint32_t count = reader.readUInt32();
+    for (uint32_t i = 0; i < count && reader.isValid(); ++i)
+    {
+        _readDiagnostic(reader, [&](const ArtifactDiagnostic& diagnostic) { diagnostics->add(diagnostic); });
+    }
+}
+
+void writeBranchProfileLayout(CompileMessageWriter& writer, const BranchProfileLayout& layout)
+{
+    writer.writeUInt32(layout.counterCount);
+    writer.writeUInt32(uint32_t(layout.functions.size()));
+    for (const auto& function : layout.functions)
+    {
+        writer.writeString(function.name);
+        writer.writeUInt32(function.counterStart);
+        writer.writeUInt32(uint32_t(function.siteSuccessorCounts.size()));
+        for (auto successorCount : function.siteSuccessorCounts)
+        {
+            writer.writeUInt32(successorCount);
+        }
+    }
+}
+
+void readBranchProfileLayout(CompileMessageReader& reader, BranchProfileLayout& outLayout)
+{
+    outLayout.counterCount = reader.readUInt32();
+    const uint32_t functionCount = reader.readUInt32();
+    for (uint32_t i = 0; i < functionCount && reader.isValid(); ++i)
+    {
+        BranchProfileLayout::Function function;
+        function.name = reader.readString().str();
+        function.counterStart = reader.readUInt32();
+        const uint32_t siteCount = reader.readUInt32();
+        for (uint32_t j = 0; j < siteCount && reader.isValid(); ++j)
+        {
+            function.siteSuccessorCounts.push_back(reader.readUInt32());
+        }
+        outLayout.functions.push_back(std::move(function));
+    }
+}
+
+void writeCompileStats(CompileMessageWriter& writer, const LLVMCompileStats& stats)
+{
+    writer.writeUInt32(uint32_t(stats.functions.size()));
+    for (const auto& function : stats.functions)
+    {
+        writer.writeString(function.name);
+        writer.writeUInt32(function.instructionCount);
+        writer.writeUInt32(function.basicBlockCount);
+        writer.writeUInt32(function.loopCount);
+        writer.writeUInt32(function.codeSize);
+        writer.writeUInt32(function.spillCount);
+    }
+
+    writer.writeUInt32(uint32_t(stats.statistics.size()));
+    for (const auto& statistic : stats.statistics)
+    {
+        writer.writeString(statistic.first);
+        writer.writeUInt64(statistic.second);
+    }
+}
+
+void readCompileStats(CompileMessageReader& reader, LLVMCompileStats& outStats)
+{
+    const uint32_t functionCount = reader.readUInt32();
+    for (uint32_t i = 0; i < functionCount && reader.isValid(); ++i)
+    {
+        LLVMCompileStats::FunctionInfo function;
+        function.name = reader.readString().str();
+        function.instructionCount = reader.readUInt32();
+        function.basicBlockCount = reader.readUInt32();
+        function.loopCount = reader.readUInt32();
+        function.codeSize = reader.readUInt32();
+        function.spillCount = reader.readUInt32();
+        outStats.addFunction(std::move(function));
+    }
+
+    const uint32_t statisticCount = reader.readUInt32();
+    for (uint32_t i = 0; i < statisticCount && reader.isValid(); ++i)
+    {
+        std::string name = reader.readString().str();
+        const uint64_t value = reader.readUInt64();
+        outStats.statistics.push_back(std::make_pair(std::move(name), value));
+    }
+}
+
+SlangResult writeWorkerMessage(const LLVMCompileWorkerIO* io, const CompileMessageWriter& writer)
+{
+    const std::string& data = writer.getData();
+    const uint32_t size = uint32_t(data.size());
+    SLANG_RETURN_ON_FAIL(io->write(&size, sizeof(size), io->userData));
+    return io->write(data.data(), data.size(), io->userData);
+}
+
+// Writes all of the data to the worker. Fails if the budget says the compilation should fail whilst waiting for the
+// worker to read it.
+static SlangResult _writeToWorker(CompileWorkerProcess& process, const void* data, size_t size, const CompileBudget& budget)
+{
+    const char* cur = (const char*)data;
+    while (size > 0)
+    {
+        size_t writtenSize = 0;
+        SLANG_RETURN_ON_FAIL(process.write(cur, size, writtenSize));
+        cur += writtenSize;
+        size -= writtenSize;
+
+        // The worker isn't keeping up
+        if (size > 0 && writtenSize == 0)
+        {
+            if (budget.shouldFail())
+            {
+                return SLANG_FAIL;
+            }
+            process.waitForWrite(kWorkerPollIntervalInMs);
+        }
+    }
+    return SLANG_OK;
+}
+
+// Reads a message from the worker, which starts with its kind. Fails if the budget says the compilation should fail
+// before the worker starts sending it.
+static SlangResult _readFromWorker(CompileWorkerProcess& process, const CompileBudget& budget, std::string& outMessage)
+{
+    while (!process.waitForData(kWorkerPollIntervalInMs))
+    {
+        if (budget.shouldFail())
+        {
+            return SLANG_FAIL;
+        }
+    }
+
+    uint32_t size = 0;
+    SLANG_RETURN_ON_FAIL(process.read(&size, sizeof(size)));
+    if (size < sizeof(uint32_t))
+    {
+        return SLANG_FAIL;
+    }
+
+    outMessage.resize(size);
+    return process.read(&outMessage[0], size);
+}
+
+SlangResult checkWorkerVersion(CompileWorkerProcess& process)
+{
+    // If the worker terminates the read fails. If it doesn't respond in time it's assumed to be stuck, and the
+    // caller discards it.
+    if (!process.waitForData(kWorkerStartTimeoutInMs))
+    {
+        return SLANG_FAIL;
+    }
+
+    uint32_t size = 0;
+    SLANG_RETURN_ON_FAIL(process.read(&size, sizeof(size)));
+
+    // The Hello message is the kind and the version, whatever the version
+    uint32_t message[2];
+    if (size != sizeof(message))
+    {
+        return SLANG_FAIL;
+    }
+    SLANG_RETURN_ON_FAIL(process.read(message, sizeof(message)));
+
+    if (CompileWorkerMessage(message[0]) != CompileWorkerMessage::Hello || message[1] != kCompileWorkerProtocolVersion)
+    {
+        return SLANG_E_NOT_IMPLEMENTED;
+    }
+    return SLANG_OK;
+}
+
+SlangResult exchangeWithWorker(CompileWorkerProcess& process, const std::string& request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, std::string& outResult)
+{
+    const uint32_t requestSize = uint32_t(request.size());
+    SLANG_RETURN_ON_FAIL(_writeToWorker(process, &requestSize, sizeof(requestSize), budget));
+    SLANG_RETURN_ON_FAIL(_writeToWorker(process, request.data(), request.size(), budget));
+
+    for (;;)
+    {
+        std::string message;
+        SLANG_RETURN_ON_FAIL(_readFromWorker(process, budget, message));
+
+        CompileMessageReader reader(message);
+        switch (CompileWorkerMessage(reader.readUInt32()))
+        {
+            case CompileWorkerMessage::Diagnostic:
+            {
+                readDiagnostic(reader, llvmOptions);
+                break;
+            }
+            case CompileWorkerMessage::Result:
+            {
+                outResult = message.substr(sizeof(uint32_t));
+                return SLANG_OK;
+            }
+            default: return SLANG_FAIL;
+        }
+    }
+}
+
+} // namespace slang_llvm
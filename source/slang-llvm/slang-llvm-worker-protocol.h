@@ -0,0 +1,134 @@
+#ifndef SLANG_LLVM_WORKER_PROTOCOL_H
+#define SLANG_LLVM_WORKER_PROTOCOL_H
+
+/* The messages exchanged with a worker process (slang-llvm-worker) for out of process compilation.
+
+Messages in both directions are a uint32_t size followed by the contents. The host sends requests, which are just the
+request. The contents of messages from the worker start with a CompileWorkerMessage saying what the message is.
+
+When started the worker sends a Hello message holding kCompileWorkerProtocolVersion. The worker loads the shared
+library the host uses, but the file can be replaced (for example by a rebuild) whilst the host runs, so the host
+doesn't use a worker with a different version. In response to a request the worker sends a Diagnostic message for
+each front end diagnostic as it is produced (if the request asks for them to be streamed), followed by a Result. */
+
+#include "slang-llvm-compiler.h"
+
+namespace slang_llvm {
+
+// Must be changed whenever the contents of any message changes, other than Hello which can't change
+static const uint32_t kCompileWorkerProtocolVersion = 1;
+
+enum class CompileWorkerMessage : uint32_t
+{
+    Hello,                  ///< Sent by the worker when it starts. Holds the protocol version.
+    Diagnostic,             ///< A diagnostic streamed whilst compiling
+    Result,                 ///< The result of a compilation
+};
+
+class CompileMessageWriter
+{
+public:
+    void writeUInt32(uint32_t value) { m_data.append((const char*)&value, sizeof(value)); }
+    void writeUInt64(uint64_t value) { m_data.append((const char*)&value, sizeof(value)); }
+    void writeString(llvm::StringRef value)
+    {
+        writeUInt32(uint32_t(value.size()));
+        m_data.append(value.data(), value.size());
+    }
+
+    const std::string& getData() const { return m_data; }
+
+protected:
+    std::string m_data;
+};
+
+class CompileMessageReader
+{
+public:
+    uint32_t readUInt32()
+    {
+        uint32_t value = 0;
+        if (size_t(m_end - m_cur) < sizeof(value))
+        {
+            m_isValid = false;
+            return 0;
+        }
+        ::memcpy(&value, m_cur, sizeof(value));
+        m_cur += sizeof(value);
+        return value;
+    }
+    uint64_t readUInt64()
+    {
+        uint64_t value = 0;
+        if (size_t(m_end - m_cur) < sizeof(value))
+        {
+            m_isValid = false;
+            return 0;
+        }
+        ::memcpy(&value, m_cur, sizeof(value));
+        m_cur += sizeof(value);
+        return value;
+    }
+    llvm::StringRef readString()
+    {
+        const uint32_t size = readUInt32();
+        if (size_t(m_end - m_cur) < size)
+        {
+            m_isValid = false;
+            return llvm::StringRef();
+        }
+        llvm::StringRef value(m_cur, size);
+        m_cur += size;
+        return value;
+    }
+
+        /// True if everything read so far was within the message
+    bool isValid() const { return m_isValid; }
+
+    CompileMessageReader(llvm::StringRef data):
+        m_cur(data.begin()),
+        m_end(data.end())
+    {
+    }
+
+protected:
+    const char* m_cur;
+    const char* m_end;
+    bool m_isValid = true;
+};
+
+// Write the parts of the request and the options that are used by a compilation in a worker
+void writeCompileRequest(CompileMessageWriter& writer, const LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions);
+// Read a request written by writeCompileRequest. If the options reference profile data, outProfileData holds it.
+// outStreamDiagnostics is set if the host has a diagnostic callback, and so wants Diagnostic messages.
+void readCompileRequest(CompileMessageReader& reader, LLVMCompileRequest* request, LLVMCompileOptions& outLLVMOptions, Slang::ComPtr<ISlangBlob>& outProfileData, bool& outStreamDiagnostics);
+
+void writeDiagnostic(CompileMessageWriter& writer, const Slang::ArtifactDiagnostic& diagnostic);
+// Reads a diagnostic written by writeDiagnostic, and sends it to the diagnostic callback of llvmOptions
+void readDiagnostic(CompileMessageReader& reader, const LLVMCompileOptions& llvmOptions);
+
+void writeDiagnostics(CompileMessageWriter& writer, Slang::IArtifactDiagnostics* diagnostics);
+void readDiagnostics(CompileMessageReader& reader, Slang::IArtifactDiagnostics* diagnostics);
+
+void writeBranchProfileLayout(CompileMessageWriter& writer, const BranchProfileLayout& layout);
+void readBranchProfileLayout(CompileMessageReader& reader, BranchProfileLayout& outLayout);
+
+void writeCompileStats(CompileMessageWriter& writer, const LLVMCompileStats& stats);
+void readCompileStats(CompileMessageReader& reader, LLVMCompileStats& outStats);
+
+// Write the contents of writer as a message to the host
+SlangResult writeWorkerMessage(const LLVMCompileWorkerIO* io, const CompileMessageWriter& writer);
+
+// Waits for the Hello message from a worker that has just been started. Fails if the worker terminates, or uses a
+// different version of the protocol.
+SlangResult checkWorkerVersion(CompileWorkerProcess& process);
+
+// Sends the request to the worker and waits for the Result, the contents of which (after the message kind) are
+// output in outResult. Diagnostic messages received whilst waiting are sent to the diagnostic callback of llvmOptions.
+// Fails if the worker terminates, or if the budget says the compilation should fail, in which case the worker is left
+// part way through the exchange.
+SlangResult exchangeWithWorker(CompileWorkerProcess& process, const std::string& request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, std::string& outResult);
+
+} // namespace slang_llvm
+
+#endif
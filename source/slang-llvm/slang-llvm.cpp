@@ -19,7 +19,9 @@
 #include "clang/CodeGen/CodeGenAction.h"
 #include "clang/Basic/Version.h"
 
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/LinkAllPasses.h"
 #include "llvm/Option/Arg.h"
@@ -31,6 +33,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/Regex.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
@@ -45,15 +48,46 @@
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITLink/JITLinkMemoryManager.h"
 
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
 
 #include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 
 #include "llvm/ExecutionEngine/JITSymbol.h"
 
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LLVMRemarkStreamer.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IRReader/IRReader.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Remarks/RemarkStreamer.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Transforms/IPO/GlobalDCE.h"
+#include "llvm/Transforms/IPO/Internalize.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/ProfileCommon.h"
 
 // Slang
 
@@ -65,7 +99,9 @@
 #include <core/slang-string.h>
 
 #include <core/slang-hash.h>
+#include <core/slang-blob.h>
 #include <core/slang-com-object.h>
+#include <core/slang-smart-pointer.h>
 #include <core/slang-string-util.h>
 #include <core/slang-shared-library.h>
 
@@ -74,8 +110,22 @@
 #include <compiler-core/slang-artifact-desc-util.h>
 #include <compiler-core/slang-slice-allocator.h>
 
+#include "slang-llvm.h"
+#include "slang-llvm-compiler.h"
+#include "slang-llvm-fiber.h"
+#include "slang-llvm-worker-protocol.h"
+
 #include <stdio.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
+
 // We want to make math functions available to the JIT
 #if SLANG_GCC_FAMILY && __GNUC__ < 6
 #   include <cmath>
@@ -91,6 +141,11 @@
 #   include <string.h>
 #endif
 
+#if SLANG_VC
+// For the interlocked functions used to access function stats
+#   include <intrin.h>
+#endif
+
 #if SLANG_WINDOWS_FAMILY
 
 /*
@@ -121,83 +176,74 @@ using namespace llvm::orc;
 
 using namespace Slang;
 
-class LLVMDownstreamCompiler : public IDownstreamCompiler, ComBaseObject
+/* !!!!!!!!!!!!!!!!!!!!! LLVMCancellationToken !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+class LLVMCancellationToken : public ILLVMCancellationToken, public ComBaseObject
 {
 public:
-    typedef ComBaseObject Super;
-
-    // IUnknown
+    // ISlangUnknown
     SLANG_COM_BASE_IUNKNOWN_ALL
 
     // ICastable
     virtual SLANG_NO_THROW void* SLANG_MCALL castAs(const Guid& guid) SLANG_OVERRIDE;
 
-    // IDownstreamCompiler
-    virtual SLANG_NO_THROW const Desc& SLANG_MCALL getDesc() SLANG_OVERRIDE { return m_desc; }
-    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compile(const CompileOptions& options, IArtifact** outArtifact) SLANG_OVERRIDE;
-    virtual SLANG_NO_THROW bool SLANG_MCALL canConvert(const ArtifactDesc& from, const ArtifactDesc& to) SLANG_OVERRIDE;
-    virtual SLANG_NO_THROW SlangResult SLANG_MCALL convert(IArtifact* from, const ArtifactDesc& to, IArtifact** outArtifact) SLANG_OVERRIDE;
-    virtual SLANG_NO_THROW bool SLANG_MCALL isFileBased() SLANG_OVERRIDE { return false; }
-    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getVersionString(slang::IBlob** outVersionString) SLANG_OVERRIDE;
-
-    LLVMDownstreamCompiler():
-        m_desc(SLANG_PASS_THROUGH_LLVM, SemanticVersion(LLVM_VERSION_MAJOR, LLVM_VERSION_MINOR, LLVM_VERSION_PATCH))
-    {
-    }
+    // ILLVMCancellationToken
+    virtual SLANG_NO_THROW void SLANG_MCALL cancel() SLANG_OVERRIDE { m_isCancelled = true; }
+    virtual SLANG_NO_THROW bool SLANG_MCALL isCancelled() SLANG_OVERRIDE { return m_isCancelled; }
 
+protected:
     void* getInterface(const Guid& guid);
     void* getObject(const Guid& guid);
 
-    Desc m_desc;
+    std::atomic<bool> m_isCancelled{ false };
 };
 
-
-/* !!!!!!!!!!!!!!!!!!!!! LLVMJITSharedLibrary !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
-
-/* This implementation uses atomic ref counting to ensure the shared libraries lifetime can outlive the 
-LLVMDownstreamCompileResult and the compilation that created it */
-class LLVMJITSharedLibrary : public ISlangSharedLibrary, public ComBaseObject
+void* LLVMCancellationToken::getInterface(const Guid& guid)
 {
-public:
-    // ISlangUnknown
-    SLANG_COM_BASE_IUNKNOWN_ALL
-
-    /// ICastable
-    virtual SLANG_NO_THROW void* SLANG_MCALL castAs(const Guid& guid) SLANG_OVERRIDE;
+    if (guid == ISlangUnknown::getTypeGuid() ||
+        guid == ICastable::getTypeGuid() ||
+        guid == ILLVMCancellationToken::getTypeGuid())
+    {
+        return static_cast<ILLVMCancellationToken*>(this);
+    }
+    return nullptr;
+}
 
-    // ISlangSharedLibrary impl
-    virtual SLANG_NO_THROW void* SLANG_MCALL findSymbolAddressByName(char const* name) SLANG_OVERRIDE;
+void* LLVMCancellationToken::getObject(const Guid& guid)
+{
+    SLANG_UNUSED(guid);
+    return nullptr;
+}
 
-    LLVMJITSharedLibrary(std::unique_ptr<llvm::orc::LLJIT> jit) :
-        m_jit(std::move(jit))
+void* LLVMCancellationToken::castAs(const Guid& guid)
+{
+    if (auto ptr = getInterface(guid))
     {
+        return ptr;
     }
+    return getObject(guid);
+}
 
-protected:
-    ISlangUnknown* getInterface(const SlangUUID& uuid);
-    void* getObject(const SlangUUID& uuid);
-
-    std::unique_ptr<llvm::orc::LLJIT> m_jit;
-};
+/* !!!!!!!!!!!!!!!!!!!!! LLVMCompileTask impl !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-ISlangUnknown* LLVMJITSharedLibrary::getInterface(const SlangUUID& guid)
+void* LLVMCompileTask::getInterface(const Guid& guid)
 {
-    if (guid == ISlangUnknown::getTypeGuid() || 
-        guid == ISlangCastable::getTypeGuid() ||
-        guid == ISlangSharedLibrary::getTypeGuid())
+    if (guid == ISlangUnknown::getTypeGuid() ||
+        guid == ICastable::getTypeGuid() ||
+        guid == ILLVMCompileTask::getTypeGuid())
     {
-        return static_cast<ISlangSharedLibrary*>(this);
+        return static_cast<ILLVMCompileTask*>(this);
     }
     return nullptr;
 }
 
-void* LLVMJITSharedLibrary::getObject(const SlangUUID& uuid)
+void* LLVMCompileTask::getObject(const Guid& guid)
 {
-    SLANG_UNUSED(uuid);
+    SLANG_UNUSED(guid);
     return nullptr;
 }
 
-void* LLVMJITSharedLibrary::castAs(const Guid& guid)
+void* LLVMCompileTask::castAs(const Guid& guid)
 {
     if (auto ptr = getInterface(guid))
     {
@@ -206,847 +252,4631 @@ void* LLVMJITSharedLibrary::castAs(const Guid& guid)
     return getObject(guid);
 }
 
-void* LLVMJITSharedLibrary::findSymbolAddressByName(char const* name)
+bool LLVMCompileTask::isComplete()
 {
-    auto fnExpected = m_jit->lookup(name);
-    if (fnExpected)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isComplete;
+}
+
+void LLVMCompileTask::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_completeCondition.wait(lock, [this]() { return m_isComplete; });
+}
+
+SlangResult LLVMCompileTask::getResult(IArtifact** outArtifact)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_isComplete)
     {
-        auto fn = std::move(*fnExpected);
-        return (void*)fn.getAddress();
+        return SLANG_E_NOT_AVAILABLE;
     }
-    return nullptr;
+
+    if (SLANG_SUCCEEDED(m_result))
+    {
+        ComPtr<IArtifact> artifact(m_artifact);
+        *outArtifact = artifact.detach();
+    }
+    return m_result;
 }
 
+void LLVMCompileTask::setCompletionCallback(LLVMCompileTaskCallback callback, void* userData)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_isComplete)
+        {
+            m_callback = callback;
+            m_callbackUserData = userData;
+            return;
+        }
+    }
 
-static void _ensureSufficientStack() {}
+    // Already complete so call immediately
+    if (callback)
+    {
+        callback(this, userData);
+    }
+}
 
-static void _llvmErrorHandler(void* userData, const std::string& message, bool genCrashDiag)
+void LLVMCompileTask::complete(SlangResult result, IArtifact* artifact)
 {
-    //DiagnosticsEngine& diags = *static_cast<DiagnosticsEngine*>(userData);
-    //diags.Report(diag::err_fe_error_backend) << message;
+    LLVMCompileTaskCallback callback;
+    void* callbackUserData;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result = result;
+        m_artifact = artifact;
+        m_isComplete = true;
 
-    printf("Clang/LLVM fatal error: %s\n", message.c_str());
+        callback = m_callback;
+        callbackUserData = m_callbackUserData;
+    }
 
-    // Run the interrupt handlers to make sure any special cleanups get done, in
-    // particular that we remove files registered with RemoveFileOnSignal.
-    llvm::sys::RunInterruptHandlers();
+    m_completeCondition.notify_all();
 
-    // We cannot recover from llvm errors.  (!)
-    // 
-    // Returning nothing, will still cause LLVM to exit the process.
+    // Make the call outside of the lock, so the callback can use the task
+    if (callback)
+    {
+        callback(this, callbackUserData);
+    }
 }
 
-static Slang::ArtifactDiagnostic::Severity _getSeverity(DiagnosticsEngine::Level level)
+/* !!!!!!!!!!!!!!!!!!!!! LLVMCompileWorkerPool impl !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+// The pool the current thread is a worker of. Reset if the pool is destroyed by the thread itself.
+static thread_local LLVMCompileWorkerPool* s_currentWorkerPool = nullptr;
+
+void LLVMCompileWorkerPool::enqueue(LLVMDownstreamCompiler* compiler, LLVMCompileTask* task)
 {
-    typedef ArtifactDiagnostic::Severity Severity;
-    typedef DiagnosticsEngine::Level Level;
-    switch (level)
+    // Keeps the compiler alive until the task has been executed
+    task->m_compiler = compiler;
+
     {
-        default:
-        case Level::Ignored:
-        case Level::Note:
-        case Level::Remark:
-        {
-            return Severity::Info;
-        }
-        case Level::Warning:
-        {
-            return Severity::Warning;
-        }
-        case Level::Error:
-        case Level::Fatal:
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push(ComPtr<LLVMCompileTask>(task));
+
+        // Only start a thread if there isn't an idle one to run the task
+        const size_t maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+        if (m_queue.size() > m_idleThreadCount && m_threads.size() < maxThreadCount)
         {
-            return Severity::Error;
+            m_threads.push_back(std::thread([this]() { _runWorker(); }));
         }
     }
+    m_taskAvailableCondition.notify_one();
 }
 
-class BufferedDiagnosticConsumer : public clang::DiagnosticConsumer
+void LLVMCompileWorkerPool::_runWorker()
 {
-public:
+    s_currentWorkerPool = this;
 
-    BufferedDiagnosticConsumer(IArtifactDiagnostics* diagnostics):
-        m_diagnostics(diagnostics)
+    for (;;)
     {
-    }
+        ComPtr<LLVMCompileTask> task;
+        ComPtr<LLVMDownstreamCompiler> compiler;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
 
-    void HandleDiagnostic(DiagnosticsEngine::Level level, const Diagnostic& info) override
-    {
-        SmallString<100> text;
-        info.FormatDiagnostic(text);
+            ++m_idleThreadCount;
+            m_taskAvailableCondition.wait(lock, [this]() { return m_isShuttingDown || !m_queue.empty(); });
+            --m_idleThreadCount;
 
-        ArtifactDiagnostic diagnostic;
-        diagnostic.severity = _getSeverity(level);
-        diagnostic.stage = ArtifactDiagnostic::Stage::Compile;
-        diagnostic.text = TerminatedCharSlice(text.c_str(), Count(text.size()));
+            if (m_isShuttingDown)
+            {
+                return;
+            }
 
-        auto location = info.getLocation();
+            task = m_queue.top();
+            m_queue.pop();
 
-        // Work out what the location is
-        auto& sourceManager = info.getSourceManager();
+            // A completed task doesn't keep the compiler alive
+            compiler = task->m_compiler;
+            task->m_compiler.setNull();
+        }
 
-        // Gets the file/line number 
-        const bool useLineDirectives = true;
-        const PresumedLoc presumedLoc = sourceManager.getPresumedLoc(location, useLineDirectives);
+        compiler->executeTask(task);
+        task.setNull();
 
-        diagnostic.location.line = presumedLoc.getLine();
-        diagnostic.filePath = TerminatedCharSlice(presumedLoc.getFilename());
+        // If this is the last reference, the compiler and this pool are destroyed here. The destructor detaches
+        // this thread, which then must not use the pool.
+        compiler.setNull();
+        if (s_currentWorkerPool != this)
+        {
+            return;
+        }
+    }
+}
 
-        m_diagnostics->add(diagnostic);
+LLVMCompileWorkerPool::~LLVMCompileWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isShuttingDown = true;
     }
+    m_taskAvailableCondition.notify_all();
 
-    bool hasError() const { return m_diagnostics->getCountAtLeastSeverity(ArtifactDiagnostic::Severity::Error) > 0; }
+    const std::thread::id currentThreadId = std::this_thread::get_id();
+    for (auto& thread : m_threads)
+    {
+        // A thread can't join itself
+        if (thread.get_id() == currentThreadId)
+        {
+            s_currentWorkerPool = nullptr;
+            thread.detach();
+        }
+        else
+        {
+            thread.join();
+        }
+    }
 
-    ComPtr<IArtifactDiagnostics> m_diagnostics;
-};
+    // Queued tasks hold a reference to the compiler, so the queue must be empty
+    SLANG_ASSERT(m_queue.empty());
+}
 
-/*
-* A question is how to make the prototypes available for these functions. They would need to be defined before the
-* the prelude - or potentially in the prelude.
-*
-* I could just define the prototypes in the prelude, and only impl, if needed. Here though I require that all the functions
-* implemented here, use C style names (ie unmanagled) to simplify lookup.
-*/
+/* !!!!!!!!!!!!!!!!!!!!! CompileWorkerProcessPool impl !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-struct NameAndFunc
+SlangResult CompileWorkerProcessPool::acquire(std::unique_ptr<CompileWorkerProcess>& outProcess)
 {
-    typedef void (*Func)();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
 
-    const char* name;
-    Func func;
-};
+        if (m_workerPath.empty())
+        {
+            SLANG_RETURN_ON_FAIL(CompileWorkerProcessUtil::getLibraryPath(m_libraryPath));
+            SLANG_RETURN_ON_FAIL(CompileWorkerProcessUtil::getWorkerPath(m_libraryPath, m_workerPath));
+        }
 
-#define SLANG_LLVM_EXPAND(x) x
+        const unsigned maxProcessCount = std::max(1u, std::thread::hardware_concurrency());
+        m_availableCondition.wait(lock, [&]() { return !m_idleProcesses.empty() || m_processCount < maxProcessCount; });
 
-#define SLANG_LLVM_FUNC(name, cppName, retType, paramTypes) NameAndFunc{ #name, (NameAndFunc::Func)static_cast<retType (*) paramTypes>(&SLANG_LLVM_EXPAND(cppName)) },
+        if (!m_idleProcesses.empty())
+        {
+            outProcess = std::move(m_idleProcesses.back());
+            m_idleProcesses.pop_back();
+            return SLANG_OK;
+        }
 
-// Implementations of maths functions available to JIT
-static float F32_frexp(float x, int* e)
-{
-    float m = ::frexpf(x, e);
-    return m;
-}
+        ++m_processCount;
+    }
 
-static double F64_frexp(double x, int* e)
-{
-    double m = ::frexp(x, e);
-    return m;
+    // Started outside of the lock, as starting a process can take a while
+    std::unique_ptr<CompileWorkerProcess> process(new CompileWorkerProcess);
+    SlangResult res = process->start(m_workerPath, m_libraryPath);
+    if (SLANG_SUCCEEDED(res))
+    {
+        res = checkWorkerVersion(*process);
+    }
+    if (SLANG_FAILED(res))
+    {
+        release(nullptr);
+        return res;
+    }
+
+    outProcess = std::move(process);
+    return SLANG_OK;
 }
 
-static void assertFailed(const char* msg)
+void CompileWorkerProcessPool::release(std::unique_ptr<CompileWorkerProcess> process)
 {
-    printf("Assert failed: %s\n", msg);
-    SLANG_BREAKPOINT(0);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (process)
+        {
+            m_idleProcesses.push_back(std::move(process));
+        }
+        else
+        {
+            --m_processCount;
+        }
+    }
+    m_availableCondition.notify_one();
 }
 
-#if SLANG_OSX
+/* !!!!!!!!!!!!!!!!!!!!! Branch profile !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-namespace OSXSpecific
+/* Instrumentation adds a counter for the entry of each function, and a counter for each successor of every
+conditional branch and switch (a 'site'). All of the counters are held in a single global array. The counters
+for a function are contiguous, with the entry counter first followed by the counters for each site in the order
+the sites appear in the function.
+
+Compiling the same source with the same options produces the same unoptimized IR, so when recompiling to use the
+profile, sites can be identified by their order alone. */
+
+// Name of the global array that holds all of the counters in instrumented code
+static const char kBranchCountersName[] = "__slang_llvm_branch_counters";
+// First line of a serialized profile. Holds the version, so an incompatible profile will be rejected.
+static const char kBranchProfileHeader[] = "slang-llvm-profile 1";
+
+struct BranchProfile
 {
+    struct Function
+    {
+        uint64_t entryCount = 0;
+        std::vector<SmallVector<uint64_t, 2>> sites;
+    };
 
-static void bzero(void* dst, size_t size)
+        /// Parse text produced by LLVMJITSharedLibrary::writeProfile
+    SlangResult parse(StringRef text);
+
+    StringMap<Function> functions;
+};
+
+SlangResult BranchProfile::parse(StringRef text)
 {
-    ::memset(dst, 0, size);
-}
+    SmallVector<StringRef, 64> lines;
+    text.split(lines, '\n', -1, false);
 
-} // OSXSpecific
-#endif
+    if (lines.empty() || lines[0].trim() != kBranchProfileHeader)
+    {
+        return SLANG_FAIL;
+    }
 
-#if SLANG_VC && SLANG_PTR_IS_32
+    size_t lineIndex = 1;
+    while (lineIndex < lines.size())
+    {
+        // function <name> <entryCount> <siteCount>
+        SmallVector<StringRef, 4> tokens;
+        lines[lineIndex++].trim().split(tokens, ' ', -1, false);
+
+        uint64_t entryCount, siteCount;
+        if (tokens.size() != 4 || 
+            tokens[0] != "function" ||
+            tokens[2].getAsInteger(10, entryCount) ||
+            tokens[3].getAsInteger(10, siteCount))
+        {
+            return SLANG_FAIL;
+        }
 
-namespace WinSpecific {
+        Function& func = functions[tokens[1]];
+        func.entryCount = entryCount;
+        func.sites.clear();
 
-// NOTE! These are functions used in 32 bit windows to enable 64 bit maths. This set is probably *not* complete.
-// Check:
+        // Followed by a line holding the successor counts of each site
+        for (uint64_t i = 0; i < siteCount; ++i)
+        {
+            if (lineIndex >= lines.size())
+            {
+                return SLANG_FAIL;
+            }
 
-// https://source.winehq.org/source/dlls/ntdll/large_int.c
+            SmallVector<StringRef, 4> countTokens;
+            lines[lineIndex++].trim().split(countTokens, ' ', -1, false);
 
-static int64_t __stdcall _alldiv(int64_t a, int64_t b)
-{
-    return a / b;
-}
+            SmallVector<uint64_t, 2> counts;
+            for (auto countToken : countTokens)
+            {
+                uint64_t count;
+                if (countToken.getAsInteger(10, count))
+                {
+                    return SLANG_FAIL;
+                }
+                counts.push_back(count);
+            }
+            func.sites.push_back(std::move(counts));
+        }
+    }
 
-static int64_t __stdcall _allrem(int64_t a, int64_t b)
-{
-    return a % b;
+    return SLANG_OK;
 }
 
-static uint64_t __stdcall _aullrem(uint64_t a, uint64_t b)
+// Returns the amount of successors if the terminator is a profiled site, else 0
+static unsigned _getBranchSiteSuccessorCount(const Instruction* terminator)
 {
-    return a % b;
+    if (auto branch = dyn_cast<BranchInst>(terminator))
+    {
+        return branch->isConditional() ? 2 : 0;
+    }
+    if (auto switchInst = dyn_cast<SwitchInst>(terminator))
+    {
+        const unsigned successorCount = switchInst->getNumSuccessors();
+        return successorCount > 1 ? successorCount : 0;
+    }
+    return 0;
 }
 
-static uint64_t __stdcall _aulldiv(uint64_t a, uint64_t b)
+static void _instrumentBranches(llvm::Module& module, BranchProfileLayout& outLayout)
 {
-    return a / b;
-}
+    // Work out the layout first, so we know how many counters are needed
+    for (auto& func : module)
+    {
+        if (func.isDeclaration())
+        {
+            continue;
+        }
 
-} // WinSpecific
+        BranchProfileLayout::Function layoutFunc;
+        layoutFunc.name = func.getName().str();
+        layoutFunc.counterStart = outLayout.counterCount++;
 
-#endif
+        for (auto& block : func)
+        {
+            if (const unsigned successorCount = _getBranchSiteSuccessorCount(block.getTerminator()))
+            {
+                layoutFunc.siteSuccessorCounts.push_back(successorCount);
+                outLayout.counterCount += successorCount;
+            }
+        }
+
+        outLayout.functions.push_back(std::move(layoutFunc));
+    }
+
+    auto countersType = llvm::ArrayType::get(llvm::Type::getInt64Ty(module.getContext()), outLayout.counterCount);
+    auto counters = new GlobalVariable(module, countersType, false, GlobalValue::ExternalLinkage, ConstantAggregateZero::get(countersType), kBranchCountersName);
+
+    // Kernels may be run on multiple threads, so the counters are incremented atomically
+    auto addIncrement = [&](IRBuilder<>& builder, Value* counterIndex)
+    {
+        Value* indices[] = { builder.getInt64(0), counterIndex };
+        auto counter = builder.CreateInBoundsGEP(countersType, counters, indices);
+        builder.CreateAtomicRMW(AtomicRMWInst::Add, counter, builder.getInt64(1), MaybeAlign(), AtomicOrdering::Monotonic);
+    };
+
+    size_t functionIndex = 0;
+    for (auto& func : module)
+    {
+        if (func.isDeclaration())
+        {
+            continue;
+        }
+
+        const auto& layoutFunc = outLayout.functions[functionIndex++];
+        uint64_t counterIndex = layoutFunc.counterStart;
+
+        {
+            IRBuilder<> builder(&*func.getEntryBlock().getFirstInsertionPt());
+            addIncrement(builder, builder.getInt64(counterIndex++));
+        }
+
+        for (auto& block : func)
+        {
+            auto terminator = block.getTerminator();
+            const unsigned successorCount = _getBranchSiteSuccessorCount(terminator);
+            if (successorCount == 0)
+            {
+                continue;
+            }
+
+            // Work out the index of the successor taken, without modifying the control flow
+            IRBuilder<> builder(terminator);
+            Value* successorIndex = nullptr;
+
+            if (auto branch = dyn_cast<BranchInst>(terminator))
+            {
+                // Successor 0 is taken if the condition is true
+                successorIndex = builder.CreateSelect(branch->getCondition(), builder.getInt64(0), builder.getInt64(1));
+            }
+            else
+            {
+                // Successor 0 is the default, followed by the successors of each case
+                auto switchInst = cast<SwitchInst>(terminator);
+                successorIndex = builder.getInt64(0);
+                for (auto& switchCase : switchInst->cases())
+                {
+                    auto isCase = builder.CreateICmpEQ(switchInst->getCondition(), switchCase.getCaseValue());
+                    successorIndex = builder.CreateSelect(isCase, builder.getInt64(switchCase.getSuccessorIndex()), successorIndex);
+                }
+            }
+
+            addIncrement(builder, builder.CreateAdd(successorIndex, builder.getInt64(counterIndex)));
+            counterIndex += successorCount;
+        }
+    }
+}
+
+static void _applyBranchProfile(llvm::Module& module, const BranchProfile& profile)
+{
+    auto& context = module.getContext();
+    MDBuilder mdBuilder(context);
+    InstrProfSummaryBuilder summaryBuilder(ProfileSummaryBuilder::DefaultCutoffs);
+
+    for (auto& func : module)
+    {
+        if (func.isDeclaration())
+        {
+            continue;
+        }
+
+        auto it = profile.functions.find(func.getName());
+        if (it == profile.functions.end())
+        {
+            continue;
+        }
+        const auto& profileFunc = it->second;
+
+        // Find the sites, checking they match the profile. If they don't the profile isn't for this function.
+        SmallVector<Instruction*, 16> sites;
+        bool matches = true;
+        for (auto& block : func)
+        {
+            auto terminator = block.getTerminator();
+            if (const unsigned successorCount = _getBranchSiteSuccessorCount(terminator))
+            {
+                const size_t siteIndex = sites.size();
+                if (siteIndex >= profileFunc.sites.size() || profileFunc.sites[siteIndex].size() != successorCount)
+                {
+                    matches = false;
+                    break;
+                }
+                sites.push_back(terminator);
+            }
+        }
+
+        if (!matches || sites.size() != profileFunc.sites.size())
+        {
+            continue;
+        }
+
+        func.setEntryCount(Function::ProfileCount(profileFunc.entryCount, Function::PCT_Real));
+
+        std::vector<uint64_t> recordCounts;
+        recordCounts.push_back(profileFunc.entryCount);
+
+        for (size_t i = 0; i < sites.size(); ++i)
+        {
+            const auto& counts = profileFunc.sites[i];
+            recordCounts.insert(recordCounts.end(), counts.begin(), counts.end());
+
+            uint64_t maxCount = 0;
+            for (auto count : counts)
+            {
+                maxCount = std::max(maxCount, count);
+            }
+
+            // If the site was never reached, there is nothing to say about it
+            if (maxCount == 0)
+            {
+                continue;
+            }
+
+            // Branch weights are 32 bits, so scale if needed
+            const uint64_t scale = maxCount / UINT32_MAX + 1;
+
+            SmallVector<uint32_t, 4> weights;
+            for (auto count : counts)
+            {
+                weights.push_back(uint32_t(count / scale));
+            }
+
+            sites[i]->setMetadata(LLVMContext::MD_prof, mdBuilder.createBranchWeights(weights));
+        }
+
+        // The first count of a record is taken as the entry count
+        summaryBuilder.addRecord(InstrProfRecord(std::move(recordCounts)));
+    }
+
+    // The summary is needed for the optimizer to determine what is 'hot' and 'cold'
+    module.setProfileSummary(summaryBuilder.getSummary()->getMD(context), ProfileSummary::PSK_Instr);
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Function stats !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* Instrumentation for function stats is added after optimization, so it doesn't change what is inlined, and only
+exported functions are instrumented. Each function atomically increments its call count on entry, and adds the
+cycles since entry to its cycle count before each return.
+
+The stats are held in a global array with an element for each function, that has the same layout as
+LLVMFunctionStats, with the name pointing to a constant string. The amount of elements is held in a separate global,
+so the code is self describing, and the stats can be found after the code has been added to a JIT, however it
+was compiled. */
+
+// Name of the global array of LLVMFunctionStats
+static const char kFunctionStatsName[] = "__slang_llvm_function_stats";
+// Name of the global holding the amount of elements in the array, as a uint64_t
+static const char kFunctionStatsCountName[] = "__slang_llvm_function_stats_count";
+
+static void _instrumentFunctionStats(llvm::Module& module)
+{
+    std::vector<llvm::Function*> funcs;
+    for (auto& func : module)
+    {
+        // Functions added by slang-llvm (such as the multiversion init function) aren't counted
+        if (!func.isDeclaration() && func.hasExternalLinkage() && !func.getName().startswith("__slang_llvm_"))
+        {
+            funcs.push_back(&func);
+        }
+    }
+
+    auto& context = module.getContext();
+    auto int64Type = llvm::Type::getInt64Ty(context);
+    auto statsType = llvm::StructType::get(context, { llvm::Type::getInt8PtrTy(context), int64Type, int64Type });
+
+    std::vector<llvm::Constant*> initialStats;
+    for (auto func : funcs)
+    {
+        auto name = llvm::ConstantDataArray::getString(context, func->getName());
+        auto nameVar = new llvm::GlobalVariable(module, name->getType(), true, llvm::GlobalValue::PrivateLinkage, name);
+        nameVar->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+        llvm::Constant* fields[] = { llvm::ConstantExpr::getPointerCast(nameVar, llvm::Type::getInt8PtrTy(context)), llvm::ConstantInt::get(int64Type, 0), llvm::ConstantInt::get(int64Type, 0) };
+        initialStats.push_back(llvm::ConstantStruct::get(statsType, fields));
+    }
+
+    auto statsArrayType = llvm::ArrayType::get(statsType, funcs.size());
+    auto stats = new llvm::GlobalVariable(module, statsArrayType, false, llvm::GlobalValue::ExternalLinkage, llvm::ConstantArray::get(statsArrayType, initialStats), kFunctionStatsName);
+    new llvm::GlobalVariable(module, int64Type, true, llvm::GlobalValue::ExternalLinkage, llvm::ConstantInt::get(int64Type, funcs.size()), kFunctionStatsCountName);
+
+    auto readCycleCounter = llvm::Intrinsic::getDeclaration(&module, llvm::Intrinsic::readcyclecounter);
+
+    // Kernels may be run on multiple threads, so the counts are added atomically
+    auto addToCount = [&](llvm::IRBuilder<>& builder, uint64_t funcIndex, int fieldIndex, llvm::Value* value)
+    {
+        llvm::Value* indices[] = { builder.getInt64(0), builder.getInt64(funcIndex), builder.getInt32(fieldIndex) };
+        auto count = builder.CreateInBoundsGEP(statsArrayType, stats, indices);
+        builder.CreateAtomicRMW(llvm::AtomicRMWInst::Add, count, value, llvm::MaybeAlign(), llvm::AtomicOrdering::Monotonic);
+    };
+
+    for (uint64_t funcIndex = 0; funcIndex < funcs.size(); ++funcIndex)
+    {
+        auto func = funcs[funcIndex];
+
+        // Find the returns before adding any code
+        std::vector<llvm::ReturnInst*> returns;
+        for (auto& block : *func)
+        {
+            if (auto returnInst = llvm::dyn_cast<llvm::ReturnInst>(block.getTerminator()))
+            {
+                returns.push_back(returnInst);
+            }
+        }
+
+        llvm::Value* startCycles;
+        {
+            llvm::IRBuilder<> builder(&*func->getEntryBlock().getFirstInsertionPt());
+            addToCount(builder, funcIndex, 1, builder.getInt64(1));
+            startCycles = builder.CreateCall(readCycleCounter);
+        }
+
+        for (auto returnInst : returns)
+        {
+            llvm::IRBuilder<> builder(returnInst);
+            auto endCycles = builder.CreateCall(readCycleCounter);
+            addToCount(builder, funcIndex, 2, builder.CreateSub(endCycles, startCycles));
+        }
+    }
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Group vectorization !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* For a compute entry point Slang produces the entry point as a function _<entryPoint>, an <entryPoint>_Thread function
+that runs a single thread by forwarding to it, and an <entryPoint>_Group function that calls _<entryPoint> in a loop for
+each thread of a group. As _<entryPoint> isn't exported its name may be mangled, so it's found as the function that
+<entryPoint>_Thread forwards to. Vectorizing a group marks the loop around the call such that the loop vectorizer
+vectorizes it regardless of its cost model, and forces the entry point to be inlined into it. Each SIMD lane then runs a
+different thread (ISPC style), with the vectorizer turning control flow that depends on the thread into masked
+operations.
+
+The marking is done before optimization, as afterwards the loop can't be told apart from loops inlined from the
+thread function. Loop metadata is preserved as the loop is transformed. */
+
+static const char kGroupFuncSuffix[] = "_Group";
+static const char kThreadFuncSuffix[] = "_Thread";
+
+// Returns true if func, or anything it calls, may call the group barrier. As the threads run as lanes of a
+// loop, they can't wait for each other.
+static bool _mayCallGroupBarrier(Function& func)
+{
+    SmallPtrSet<Function*, 16> visited;
+    SmallVector<Function*, 16> work;
+
+    visited.insert(&func);
+    work.push_back(&func);
+
+    while (work.size())
+    {
+        Function* cur = work.pop_back_val();
+        for (auto& inst : instructions(*cur))
+        {
+            auto call = dyn_cast<CallBase>(&inst);
+            if (!call || isa<IntrinsicInst>(call))
+            {
+                continue;
+            }
+            Function* callee = call->getCalledFunction();
+            if (!callee || callee->getName() == SLANG_LLVM_GROUP_BARRIER_NAME)
+            {
+                // Indirect calls could call anything
+                return true;
+            }
+            if (!callee->isDeclaration() && visited.insert(callee).second)
+            {
+                work.push_back(callee);
+            }
+        }
+    }
+    return false;
+}
+
+// Returns the function threadFunc forwards to, if it consists of a call to a single function. Otherwise threadFunc.
+static Function* _getThreadEntryPoint(Function* threadFunc)
+{
+    Function* entryPoint = nullptr;
+    for (auto& inst : instructions(*threadFunc))
+    {
+        auto call = dyn_cast<CallBase>(&inst);
+        if (!call || isa<IntrinsicInst>(call))
+        {
+            continue;
+        }
+        Function* callee = call->getCalledFunction();
+        if (!callee || callee->isDeclaration() || entryPoint)
+        {
+            return threadFunc;
+        }
+        entryPoint = callee;
+    }
+    return entryPoint ? entryPoint : threadFunc;
+}
+
+static void _markGroupLoopsForVectorization(llvm::Module& module)
+{
+    for (auto& groupFunc : module)
+    {
+        const StringRef groupName = groupFunc.getName();
+        if (groupFunc.isDeclaration() || !groupName.endswith(kGroupFuncSuffix))
+        {
+            continue;
+        }
+
+        const std::string threadName = (groupName.drop_back(sizeof(kGroupFuncSuffix) - 1) + kThreadFuncSuffix).str();
+        Function* threadFunc = module.getFunction(threadName);
+        if (!threadFunc || threadFunc->isDeclaration())
+        {
+            continue;
+        }
+        Function* entryPoint = _getThreadEntryPoint(threadFunc);
+        if (entryPoint->hasFnAttribute(Attribute::NoInline) || _mayCallGroupBarrier(*entryPoint))
+        {
+            continue;
+        }
+
+        // The loop can only be vectorized if the thread is part of it
+        entryPoint->addFnAttr(Attribute::AlwaysInline);
+        if (entryPoint != threadFunc && !threadFunc->hasFnAttribute(Attribute::NoInline))
+        {
+            // In case the group calls the thread function rather than the entry point
+            threadFunc->addFnAttr(Attribute::AlwaysInline);
+        }
+
+        DominatorTree dominatorTree(groupFunc);
+        LoopInfo loopInfo(dominatorTree);
+
+        for (auto& inst : instructions(groupFunc))
+        {
+            auto call = dyn_cast<CallInst>(&inst);
+            if (call && (call->getCalledFunction() == entryPoint || call->getCalledFunction() == threadFunc))
+            {
+                // The innermost loop around the call is the one over the threads
+                if (Loop* loop = loopInfo.getLoopFor(call->getParent()))
+                {
+                    addStringMetadataToLoop(loop, "llvm.loop.vectorize.enable", 1);
+                }
+            }
+        }
+    }
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Multiversioning !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* Multiversioning clones each exported function before optimization, once for the baseline and once for each level,
+with the level's CPU set on the clone, so each is optimized and generated for its level. The exported function is
+replaced with a stub that calls through a pointer to one of the clones.
+
+An exported init function asks the runtime for the CPU level, and sets each pointer to the clone for the highest level
+supported. It isn't a module constructor, as those aren't run for code added to the JIT as an object file (such as
+code compiled out of process), so it's called explicitly once the code has been added. The code therefore runs on any
+x86-64 CPU, while the choice is made once at load time rather than on each call. */
+
+// Name of the runtime function that returns the CPU level
+static const char kGetCPULevelName[] = "slang_llvm_getCPULevel";
+// Name of the function that selects the variants. Only defined if something was multiversioned.
+static const char kMultiversionInitName[] = "__slang_llvm_multiversion_init";
+
+struct MultiversionLevelInfo
+{
+    uint32_t flag;
+    int32_t level;
+    const char* cpuName;
+};
+
+// In order of highest level first
+static const MultiversionLevelInfo kMultiversionLevelInfos[] =
+{
+    { LLVMCompileOptions::MultiversionLevel::X86_64_V4, 4, "x86-64-v4" },
+    { LLVMCompileOptions::MultiversionLevel::X86_64_V3, 3, "x86-64-v3" },
+    { LLVMCompileOptions::MultiversionLevel::X86_64_V2, 2, "x86-64-v2" },
+};
+
+static void _multiversionFunctions(llvm::Module& module, uint32_t levels)
+{
+    if (llvm::Triple(module.getTargetTriple()).getArch() != llvm::Triple::x86_64)
+    {
+        return;
+    }
+
+    std::vector<llvm::Function*> funcs;
+    for (auto& func : module)
+    {
+        if (!func.isDeclaration() && func.hasExternalLinkage() && !func.isVarArg())
+        {
+            funcs.push_back(&func);
+        }
+    }
+    if (funcs.empty())
+    {
+        return;
+    }
+
+    auto& context = module.getContext();
+    auto int32Type = llvm::Type::getInt32Ty(context);
+
+    auto initFunc = llvm::Function::Create(llvm::FunctionType::get(llvm::Type::getVoidTy(context), false), llvm::GlobalValue::ExternalLinkage, kMultiversionInitName, module);
+    llvm::IRBuilder<> initBuilder(llvm::BasicBlock::Create(context, "entry", initFunc));
+
+    auto getCPULevel = module.getOrInsertFunction(kGetCPULevelName, llvm::FunctionType::get(int32Type, false));
+    llvm::Value* cpuLevel = initBuilder.CreateCall(getCPULevel);
+
+    for (auto func : funcs)
+    {
+        const std::string name = func->getName().str();
+
+        auto cloneFunction = [&](const char* suffix) -> llvm::Function*
+        {
+            llvm::ValueToValueMapTy valueMap;
+            llvm::Function* clone = llvm::CloneFunction(func, valueMap);
+            clone->setName(name + suffix);
+            clone->setLinkage(llvm::GlobalValue::InternalLinkage);
+            return clone;
+        };
+
+        llvm::Function* baseFunc = cloneFunction(".base");
+
+        // Select the variant, starting with the lowest level
+        llvm::Value* selected = baseFunc;
+        for (int i = SLANG_COUNT_OF(kMultiversionLevelInfos) - 1; i >= 0; --i)
+        {
+            const auto& info = kMultiversionLevelInfos[i];
+            if (levels & info.flag)
+            {
+                llvm::Function* clone = cloneFunction((std::string(".") + info.cpuName).c_str());
+                clone->addFnAttr("target-cpu", info.cpuName);
+
+                auto isSupported = initBuilder.CreateICmpSGE(cpuLevel, llvm::ConstantInt::get(int32Type, info.level));
+                selected = initBuilder.CreateSelect(isSupported, clone, selected);
+            }
+        }
+
+        auto variant = new llvm::GlobalVariable(module, func->getType(), false, llvm::GlobalValue::InternalLinkage, baseFunc, name + ".variant");
+        initBuilder.CreateStore(selected, variant);
+
+        // Replace the body with a call to the variant. Deleting the body makes the linkage external, so restore it.
+        const auto linkage = func->getLinkage();
+        func->deleteBody();
+        func->setLinkage(linkage);
+
+        llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", func));
+
+        llvm::SmallVector<llvm::Value*, 8> args;
+        for (auto& arg : func->args())
+        {
+            args.push_back(&arg);
+        }
+
+        auto call = builder.CreateCall(llvm::FunctionCallee(func->getFunctionType(), builder.CreateLoad(func->getType(), variant)), args);
+        call->setCallingConv(func->getCallingConv());
+        call->setAttributes(func->getAttributes());
+        call->setTailCall();
+
+        if (func->getReturnType()->isVoidTy())
+        {
+            builder.CreateRetVoid();
+        }
+        else
+        {
+            builder.CreateRet(call);
+        }
+    }
+
+    initBuilder.CreateRetVoid();
+}
+
+// Defines the init function of module as calling the init functions of the initCount modules linked into it, which were
+// renamed with the suffixes .0 to .<initCount - 1>
+static void _combineMultiversionInits(llvm::Module& module, int initCount)
+{
+    auto& context = module.getContext();
+    auto initType = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+
+    auto initFunc = llvm::Function::Create(initType, llvm::GlobalValue::ExternalLinkage, kMultiversionInitName, module);
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", initFunc));
+    for (int i = 0; i < initCount; ++i)
+    {
+        llvm::Function* linkedInit = module.getFunction(std::string(kMultiversionInitName) + "." + std::to_string(i));
+        linkedInit->setLinkage(llvm::GlobalValue::InternalLinkage);
+        builder.CreateCall(linkedInit);
+    }
+    builder.CreateRetVoid();
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Specialization !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* A function can be specialized such that values read through its pointer parameters (for example the entry point and
+global uniforms of a Slang entry point) are replaced by constants.
+
+Loads are replaced during optimization, after the functions called by the specialized function have been inlined into it,
+so that loads made through the parameters by those functions are also replaced. All other functions are internalized, so
+those that are only used by the specialized function are inlined and removed.
+
+The specialization is compiled into its own JITDylib, which links against the library it was made from. Mutable global
+variables are made declarations, so they resolve to those of the library. A variable that is internal to the library
+can't be resolved, so a specialization that still uses one once optimized fails. */
+struct FunctionSpecialization
+{
+    struct BoundValue
+    {
+        uint32_t parameterIndex;
+        uint32_t offset;
+        std::string data;                   ///< The bytes of the value
+    };
+
+        /// Get the constant for a load of type that reads size bytes at offset through parameter parameterIndex,
+        /// or nullptr if the bytes aren't all specified
+    llvm::Constant* getConstant(uint32_t parameterIndex, uint64_t offset, llvm::Type* type, const DataLayout& dataLayout) const;
+
+        /// Get a key that uniquely identifies the specialization
+    std::string getKey() const;
+
+    std::string functionName;
+    std::vector<BoundValue> values;
+};
+
+llvm::Constant* FunctionSpecialization::getConstant(uint32_t parameterIndex, uint64_t offset, llvm::Type* type, const DataLayout& dataLayout) const
+{
+    if (!type->isIntegerTy() && !type->isFloatingPointTy())
+    {
+        return nullptr;
+    }
+
+    const uint64_t size = dataLayout.getTypeStoreSize(type);
+
+    for (const auto& value : values)
+    {
+        if (value.parameterIndex != parameterIndex ||
+            offset < value.offset ||
+            offset + size > value.offset + value.data.size())
+        {
+            continue;
+        }
+
+        const unsigned bitCount = unsigned(size * 8);
+        const uint8_t* bytes = (const uint8_t*)value.data.data() + (offset - value.offset);
+
+        APInt bits(bitCount, 0);
+        for (uint64_t i = 0; i < size; ++i)
+        {
+            const uint64_t byteIndex = dataLayout.isLittleEndian() ? i : (size - 1 - i);
+            bits |= APInt(bitCount, bytes[byteIndex]).shl(unsigned(i * 8));
+        }
+
+        if (type->isIntegerTy())
+        {
+            return ConstantInt::get(type, bits.trunc(type->getIntegerBitWidth()));
+        }
+        return ConstantFP::get(type->getContext(), APFloat(type->getFltSemantics(), bits.trunc(type->getPrimitiveSizeInBits())));
+    }
+    return nullptr;
+}
+
+std::string FunctionSpecialization::getKey() const
+{
+    std::string key = functionName;
+    for (const auto& value : values)
+    {
+        key += '\0';
+        key += std::to_string(value.parameterIndex) + ":" + std::to_string(value.offset) + ":";
+        key += value.data;
+    }
+    return key;
+}
+
+// Replaces loads through the parameters of func, that the specialization has values for, with constants.
+// Returns true if anything was changed.
+static bool _specializeLoads(Function& func, const FunctionSpecialization& specialization)
+{
+    const DataLayout& dataLayout = func.getParent()->getDataLayout();
+
+    bool changed = false;
+    for (auto& block : func)
+    {
+        for (auto it = block.begin(); it != block.end(); )
+        {
+            auto load = dyn_cast<LoadInst>(&*it++);
+            if (!load || load->isVolatile())
+            {
+                continue;
+            }
+
+            const Value* pointer = load->getPointerOperand();
+            APInt offset(dataLayout.getIndexTypeSizeInBits(pointer->getType()), 0);
+            auto arg = dyn_cast<Argument>(pointer->stripAndAccumulateConstantOffsets(dataLayout, offset, true));
+            if (!arg || offset.isNegative())
+            {
+                continue;
+            }
+
+            if (auto constant = specialization.getConstant(arg->getArgNo(), offset.getZExtValue(), load->getType(), dataLayout))
+            {
+                load->replaceAllUsesWith(constant);
+                load->eraseFromParent();
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+class SpecializeLoadsPass : public PassInfoMixin<SpecializeLoadsPass>
+{
+public:
+    PreservedAnalyses run(Function& func, FunctionAnalysisManager& analysisManager)
+    {
+        if (func.getName() != m_specialization.functionName || !_specializeLoads(func, m_specialization))
+        {
+            return PreservedAnalyses::all();
+        }
+        PreservedAnalyses preserved;
+        preserved.preserveSet<CFGAnalyses>();
+        return preserved;
+    }
+
+    SpecializeLoadsPass(const FunctionSpecialization& specialization):
+        m_specialization(specialization)
+    {
+    }
+
+protected:
+    const FunctionSpecialization& m_specialization;
+};
+
+// Get the options a specialization is compiled with, which are the optimization settings of the library's options
+static LLVMCompileOptions _getSpecializationOptions(const LLVMCompileOptions& libraryOptions)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.useTuningConfig = libraryOptions.useTuningConfig;
+    llvmOptions.tuningConfig = libraryOptions.tuningConfig;
+    llvmOptions.vectorizeGroups = libraryOptions.vectorizeGroups;
+    llvmOptions.pipelineProfile = libraryOptions.pipelineProfile;
+    return llvmOptions;
+}
+
+// Get a copy of the options a library can keep. Anything only valid for the duration of the call that compiled the
+// library is cleared. The strings are already held by the library's request.
+static LLVMCompileOptions _getKeptOptions(const LLVMCompileOptions& llvmOptions)
+{
+    LLVMCompileOptions keptOptions = llvmOptions;
+    keptOptions.profileData = nullptr;
+    keptOptions.cancellationToken = nullptr;
+    keptOptions.diagnosticCallback = nullptr;
+    keptOptions.diagnosticCallbackUserData = nullptr;
+    keptOptions.exportNames = nullptr;
+    keptOptions.exportNameCount = 0;
+    keptOptions.remarksFilter = nullptr;
+    keptOptions.passPipeline = nullptr;
+    return keptOptions;
+}
+
+// Prepares the unoptimized module for specialization, by internalizing everything other than the specialized function
+static SlangResult _prepareSpecialization(llvm::Module& module, const FunctionSpecialization& specialization)
+{
+    Function* specializedFunc = module.getFunction(specialization.functionName);
+    if (!specializedFunc || specializedFunc->isDeclaration())
+    {
+        return SLANG_E_NOT_FOUND;
+    }
+
+    for (auto& func : module)
+    {
+        if (&func != specializedFunc && !func.isDeclaration())
+        {
+            func.setLinkage(GlobalValue::InternalLinkage);
+        }
+    }
+
+    // The variables that can be changed must be those of the library
+    for (GlobalVariable& variable : module.globals())
+    {
+        if (!variable.isDeclaration() && !variable.isConstant() && !variable.hasLocalLinkage())
+        {
+            variable.setInitializer(nullptr);
+            variable.setLinkage(GlobalValue::ExternalLinkage);
+            variable.setComdat(nullptr);
+        }
+    }
+
+    // Handles the simple cases directly, for example if optimization is disabled
+    _specializeLoads(*specializedFunc, specialization);
+    return SLANG_OK;
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! LLVMJITSharedLibrary !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* This implementation uses atomic ref counting to ensure the shared libraries lifetime can outlive the 
+LLVMDownstreamCompileResult and the compilation that created it */
+class LLVMJITSharedLibrary : public ILLVMJITSharedLibrary, public ComBaseObject
+{
+public:
+    // Guid such that the LLVMJITSharedLibrary can be accessed via castAs 
+    SLANG_COM_INTERFACE(0xfbf72201, 0xdedc, 0x4e9f, { 0x88, 0xc9, 0xcc, 0x22, 0xd3, 0xba, 0x59, 0x97 })
+
+    // ISlangUnknown
+    SLANG_COM_BASE_IUNKNOWN_ALL
+
+    /// ICastable
+    virtual SLANG_NO_THROW void* SLANG_MCALL castAs(const Guid& guid) SLANG_OVERRIDE;
+
+    // ISlangSharedLibrary impl
+    virtual SLANG_NO_THROW void* SLANG_MCALL findSymbolAddressByName(char const* name) SLANG_OVERRIDE;
+
+    // ILLVMJITSharedLibrary impl
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL writeProfile(ISlangBlob** outProfile) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL specialize(const char* name, const LLVMSpecializationValue* values, Count valueCount, void** outFunc, IArtifactDiagnostics** outDiagnostics) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW Count SLANG_MCALL getFunctionStatsCount() SLANG_OVERRIDE { return m_functionStatsCount; }
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getFunctionStatsAt(Index index, LLVMFunctionStats* outStats) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW void SLANG_MCALL resetFunctionStats() SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL dispatchGroups(const char* threadFuncName, const uint32_t groupCount[3], const uint32_t groupSize[3], void* entryPointParams, void* globalParams) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL dispatch(const LLVMDispatchDesc& desc) SLANG_OVERRIDE;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getRepresentation(LLVMRepresentation representation, ISlangBlob** outBlob) SLANG_OVERRIDE;
+
+        /// Set the layout and the counters of instrumented code
+    void setBranchProfile(BranchProfileLayout&& layout, const uint64_t* counters)
+    {
+        m_branchProfileLayout = std::move(layout);
+        m_branchCounters = counters;
+    }
+        /// Set the threads used by dispatch
+    void setDispatchThreadPool(DispatchThreadPool* pool) { m_dispatchThreadPool = pool; }
+
+        /// Set the stats array of code instrumented with _instrumentFunctionStats
+    void setFunctionStats(LLVMFunctionStats* stats, Count count)
+    {
+        m_functionStats = stats;
+        m_functionStatsCount = count;
+    }
+
+        /// Set the bitcode of a module compiled with LLVMCompileOptions::keepBitcode or keepRepresentations
+    void setBitcode(ISlangBlob* bitcode) { m_bitcode = bitcode; }
+        /// Get the bitcode, or nullptr if it wasn't kept
+    ISlangBlob* getBitcode() const { return m_bitcode; }
+
+        /// Set the functions in a FunctionStore that the code calls
+    void setSharedFunctions(SharedFunctions* sharedFunctions) { m_sharedFunctions = sharedFunctions; }
+
+        /// Set the YAML optimization remarks of a module compiled with LLVMCompileOptions::remarksFilter
+    void setRemarks(ISlangBlob* remarks) { m_remarks = remarks; }
+
+        /// Get the request that produced this library. A library produced by linking has a request without any source.
+    LLVMCompileRequest* getCompileRequest() const { return m_request; }
+
+        /// Set the options the library was compiled with, which are used by specializations and recompilation
+    void setCompileOptions(const LLVMCompileOptions& llvmOptions) { m_llvmOptions = _getKeptOptions(llvmOptions); }
+        /// Get the options the library was compiled with. Those only valid whilst compiling (such as callbacks) are cleared.
+    const LLVMCompileOptions& getCompileOptions() const { return m_llvmOptions; }
+
+        /// Get the LLVMJITSharedLibrary from the artifact, or nullptr if it doesn't have one
+    static LLVMJITSharedLibrary* getFromArtifact(IArtifact* artifact);
+
+        /// The code is in dylib, which is owned by jit. The jit may be shared with other libraries.
+    LLVMJITSharedLibrary(std::shared_ptr<llvm::orc::LLJIT> jit, llvm::orc::JITDylib* dylib, LLVMCompileRequest* request) :
+        m_jit(std::move(jit)),
+        m_dylib(dylib),
+        m_request(request)
+    {
+    }
+
+protected:
+    ISlangUnknown* getInterface(const SlangUUID& uuid);
+    void* getObject(const SlangUUID& uuid);
+
+    std::shared_ptr<llvm::orc::LLJIT> m_jit;
+    llvm::orc::JITDylib* m_dylib;
+    RefPtr<LLVMCompileRequest> m_request;
+    LLVMCompileOptions m_llvmOptions;                   ///< As returned by _getKeptOptions
+
+    ComPtr<ISlangBlob> m_bitcode;
+    RefPtr<SharedFunctions> m_sharedFunctions;         ///< Keeps the functions the code calls in their store
+
+    BranchProfileLayout m_branchProfileLayout;
+    const uint64_t* m_branchCounters = nullptr;
+
+    RefPtr<DispatchThreadPool> m_dispatchThreadPool;
+
+    LLVMFunctionStats* m_functionStats = nullptr;      ///< Updated by the code as it runs
+    Count m_functionStatsCount = 0;
+
+    std::mutex m_specializationsMutex;
+    StringMap<void*> m_specializations;                 ///< Maps FunctionSpecialization keys to the specialized functions
+
+    std::mutex m_representationsMutex;
+    ComPtr<ISlangBlob> m_irText;                        ///< Produced from m_bitcode when first asked for
+    ComPtr<ISlangBlob> m_assembly;
+    ComPtr<ISlangBlob> m_remarks;
+};
+
+ISlangUnknown* LLVMJITSharedLibrary::getInterface(const SlangUUID& guid)
+{
+    if (guid == ISlangUnknown::getTypeGuid() || 
+        guid == ISlangCastable::getTypeGuid() ||
+        guid == ISlangSharedLibrary::getTypeGuid() ||
+        guid == ILLVMJITSharedLibrary::getTypeGuid())
+    {
+        return static_cast<ILLVMJITSharedLibrary*>(this);
+    }
+    return nullptr;
+}
+
+void* LLVMJITSharedLibrary::getObject(const SlangUUID& uuid)
+{
+    if (uuid == LLVMJITSharedLibrary::getTypeGuid())
+    {
+        return this;
+    }
+    return nullptr;
+}
+
+void* LLVMJITSharedLibrary::castAs(const Guid& guid)
+{
+    if (auto ptr = getInterface(guid))
+    {
+        return ptr;
+    }
+    return getObject(guid);
+}
+
+/* static */LLVMJITSharedLibrary* LLVMJITSharedLibrary::getFromArtifact(IArtifact* artifact)
+{
+    ComPtr<ISlangSharedLibrary> sharedLibrary;
+    if (!artifact || SLANG_FAILED(artifact->loadSharedLibrary(ArtifactKeep::Yes, sharedLibrary.writeRef())))
+    {
+        return nullptr;
+    }
+    // The artifact holds a reference, so it's okay to return a raw pointer
+    return static_cast<LLVMJITSharedLibrary*>(sharedLibrary->castAs(LLVMJITSharedLibrary::getTypeGuid()));
+}
+
+// The code updates the counts with atomic operations, so access them the same way. The counts are plain uint64_t
+// in the JIT's memory, so the compiler intrinsics are used, as it isn't valid to treat them as std::atomic.
+static uint64_t _atomicLoad(uint64_t* value)
+{
+#if SLANG_VC
+    // Exchanging 0 for 0 doesn't change the value, and returns it
+    return uint64_t(_InterlockedCompareExchange64((volatile __int64*)value, 0, 0));
+#else
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+}
+
+static void _atomicStore(uint64_t* value, uint64_t newValue)
+{
+#if SLANG_VC
+    _InterlockedExchange64((volatile __int64*)value, __int64(newValue));
+#else
+    __atomic_store_n(value, newValue, __ATOMIC_RELAXED);
+#endif
+}
+
+SlangResult LLVMJITSharedLibrary::getFunctionStatsAt(Index index, LLVMFunctionStats* outStats)
+{
+    if (index < 0 || index >= m_functionStatsCount)
+    {
+        return SLANG_E_INVALID_ARG;
+    }
+
+    LLVMFunctionStats& stats = m_functionStats[index];
+    outStats->name = stats.name;
+    outStats->callCount = _atomicLoad(&stats.callCount);
+    outStats->cycleCount = _atomicLoad(&stats.cycleCount);
+    return SLANG_OK;
+}
+
+void LLVMJITSharedLibrary::resetFunctionStats()
+{
+    for (Index i = 0; i < m_functionStatsCount; ++i)
+    {
+        _atomicStore(&m_functionStats[i].callCount, 0);
+        _atomicStore(&m_functionStats[i].cycleCount, 0);
+    }
+}
+
+SlangResult LLVMJITSharedLibrary::dispatchGroups(const char* threadFuncName, const uint32_t groupCount[3], const uint32_t groupSize[3], void* entryPointParams, void* globalParams)
+{
+    auto threadFunc = (LLVMComputeThreadFunc)findSymbolAddressByName(threadFuncName);
+    if (!threadFunc)
+    {
+        return SLANG_E_NOT_FOUND;
+    }
+    return runGroupsAsFibers(threadFunc, groupCount, groupSize, entryPointParams, globalParams);
+}
+
+SlangResult LLVMJITSharedLibrary::dispatch(const LLVMDispatchDesc& desc)
+{
+    auto func = (LLVMComputeFunc)findSymbolAddressByName(desc.entryPointName);
+    if (!func)
+    {
+        return SLANG_E_NOT_FOUND;
+    }
+    return runDispatch(m_dispatchThreadPool, func, desc);
+}
+
+SlangResult LLVMJITSharedLibrary::writeProfile(ISlangBlob** outProfile)
+{
+    if (!m_branchCounters)
+    {
+        return SLANG_E_NOT_AVAILABLE;
+    }
+
+    std::string text;
+    llvm::raw_string_ostream stream(text);
+
+    stream << kBranchProfileHeader << "\n";
+
+    for (const auto& func : m_branchProfileLayout.functions)
+    {
+        const uint64_t* counters = m_branchCounters + func.counterStart;
+
+        stream << "function " << func.name << " " << counters[0] << " " << func.siteSuccessorCounts.size() << "\n";
+        counters++;
+
+        for (auto successorCount : func.siteSuccessorCounts)
+        {
+            for (uint32_t i = 0; i < successorCount; ++i)
+            {
+                stream << (i ? " " : "") << counters[i];
+            }
+            stream << "\n";
+            counters += successorCount;
+        }
+    }
+    stream.flush();
+
+    *outProfile = RawBlob::create(text.data(), text.size()).detach();
+    return SLANG_OK;
+}
+
+// Generates an object file (or assembly) for the module, targeting the host in the same way as the JIT
+static SlangResult _emitCode(llvm::Module& module, CodeGenFileType fileType, SmallVectorImpl<char>& outCode)
+{
+    auto targetMachineBuilder = JITTargetMachineBuilder::detectHost();
+    if (!targetMachineBuilder)
+    {
+        consumeError(targetMachineBuilder.takeError());
+        return SLANG_FAIL;
+    }
+
+    auto targetMachine = targetMachineBuilder->createTargetMachine();
+    if (!targetMachine)
+    {
+        consumeError(targetMachine.takeError());
+        return SLANG_FAIL;
+    }
+
+    legacy::PassManager passManager;
+    raw_svector_ostream stream(outCode);
+    if ((*targetMachine)->addPassesToEmitFile(passManager, stream, nullptr, fileType))
+    {
+        // The target can't emit this kind of file
+        return SLANG_FAIL;
+    }
+
+    passManager.run(module);
+    return SLANG_OK;
+}
+
+SlangResult LLVMJITSharedLibrary::getRepresentation(LLVMRepresentation representation, ISlangBlob** outBlob)
+{
+    // Remarks are produced by the compilation, rather than from the snapshot
+    if (representation == LLVMRepresentation::Remarks)
+    {
+        if (!m_remarks)
+        {
+            return SLANG_E_NOT_AVAILABLE;
+        }
+        *outBlob = ComPtr<ISlangBlob>(m_remarks).detach();
+        return SLANG_OK;
+    }
+
+    if (!m_bitcode)
+    {
+        return SLANG_E_NOT_AVAILABLE;
+    }
+
+    if (representation == LLVMRepresentation::Bitcode)
+    {
+        *outBlob = ComPtr<ISlangBlob>(m_bitcode).detach();
+        return SLANG_OK;
+    }
+
+    ComPtr<ISlangBlob>* cached = nullptr;
+    switch (representation)
+    {
+        case LLVMRepresentation::IR:        cached = &m_irText; break;
+        case LLVMRepresentation::Assembly:  cached = &m_assembly; break;
+        default:                            return SLANG_E_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(m_representationsMutex);
+
+    if (!*cached)
+    {
+        LLVMContext llvmContext;
+        const StringRef bitcodeData((const char*)m_bitcode->getBufferPointer(), m_bitcode->getBufferSize());
+        auto moduleExpected = parseBitcodeFile(MemoryBufferRef(bitcodeData, "bitcode"), llvmContext);
+        if (!moduleExpected)
+        {
+            consumeError(moduleExpected.takeError());
+            return SLANG_FAIL;
+        }
+        llvm::Module& module = **moduleExpected;
+
+        SmallVector<char, 0> text;
+        if (representation == LLVMRepresentation::IR)
+        {
+            raw_svector_ostream stream(text);
+            module.print(stream, nullptr);
+        }
+        else
+        {
+            SLANG_RETURN_ON_FAIL(_emitCode(module, CGFT_AssemblyFile, text));
+        }
+        *cached = RawBlob::create(text.data(), text.size());
+    }
+
+    *outBlob = ComPtr<ISlangBlob>(*cached).detach();
+    return SLANG_OK;
+}
+
+void* LLVMJITSharedLibrary::findSymbolAddressByName(char const* name)
+{
+    auto fnExpected = m_jit->lookup(*m_dylib, name);
+    if (fnExpected)
+    {
+        auto fn = std::move(*fnExpected);
+        return (void*)fn.getAddress();
+    }
+    return nullptr;
+}
+
+static void _ensureSufficientStack() {}
+
+static void _llvmErrorHandler(void* userData, const std::string& message, bool genCrashDiag)
+{
+    //DiagnosticsEngine& diags = *static_cast<DiagnosticsEngine*>(userData);
+    //diags.Report(diag::err_fe_error_backend) << message;
+
+    printf("Clang/LLVM fatal error: %s\n", message.c_str());
+
+    // Run the interrupt handlers to make sure any special cleanups get done, in
+    // particular that we remove files registered with RemoveFileOnSignal.
+    llvm::sys::RunInterruptHandlers();
+
+    // We cannot recover from llvm errors.  (!)
+    // 
+    // Returning nothing, will still cause LLVM to exit the process.
+}
+
+static Slang::ArtifactDiagnostic::Severity _getSeverity(DiagnosticsEngine::Level level)
+{
+    typedef ArtifactDiagnostic::Severity Severity;
+    typedef DiagnosticsEngine::Level Level;
+    switch (level)
+    {
+        default:
+        case Level::Ignored:
+        case Level::Note:
+        case Level::Remark:
+        {
+            return Severity::Info;
+        }
+        case Level::Warning:
+        {
+            return Severity::Warning;
+        }
+        case Level::Error:
+        case Level::Fatal:
+        {
+            return Severity::Error;
+        }
+    }
+}
+
+class BufferedDiagnosticConsumer : public clang::DiagnosticConsumer
+{
+public:
+
+    BufferedDiagnosticConsumer(IArtifactDiagnostics* diagnostics, LLVMCompileOptions::DiagnosticCallback callback = nullptr, void* callbackUserData = nullptr):
+        m_diagnostics(diagnostics),
+        m_callback(callback),
+        m_callbackUserData(callbackUserData)
+    {
+    }
+
+    void HandleDiagnostic(DiagnosticsEngine::Level level, const Diagnostic& info) override
+    {
+        // Keeps the error and warning counts
+        DiagnosticConsumer::HandleDiagnostic(level, info);
+
+        SmallString<100> text;
+        info.FormatDiagnostic(text);
+
+        ArtifactDiagnostic diagnostic;
+        diagnostic.severity = _getSeverity(level);
+        diagnostic.stage = ArtifactDiagnostic::Stage::Compile;
+        diagnostic.text = TerminatedCharSlice(text.c_str(), Count(text.size()));
+
+        auto location = info.getLocation();
+
+        // Work out what the location is
+        auto& sourceManager = info.getSourceManager();
+
+        // Gets the file/line number 
+        const bool useLineDirectives = true;
+        const PresumedLoc presumedLoc = sourceManager.getPresumedLoc(location, useLineDirectives);
+
+        diagnostic.location.line = presumedLoc.getLine();
+        diagnostic.filePath = TerminatedCharSlice(presumedLoc.getFilename());
+
+        add(diagnostic);
+    }
+
+        /// Add an optimization remark as an Info diagnostic. Remarks are located by the debug locations of the code
+        /// they are about, which come from #line directives as for other diagnostics.
+    void addRemark(const DiagnosticInfoOptimizationBase& remark)
+    {
+        const char* kind = remark.isPassed() ? "passed" : (remark.isMissed() ? "missed" : "analysis");
+
+        std::string text;
+        raw_string_ostream stream(text);
+        stream << kind << ": " << remark.getMsg() << " [" << remark.getPassName() << "]";
+        stream.flush();
+
+        ArtifactDiagnostic diagnostic;
+        diagnostic.severity = ArtifactDiagnostic::Severity::Info;
+        diagnostic.stage = ArtifactDiagnostic::Stage::Compile;
+        diagnostic.text = TerminatedCharSlice(text.c_str(), Count(text.size()));
+
+        std::string filePath;
+        if (remark.isLocationAvailable())
+        {
+            const DiagnosticLocation location = remark.getLocation();
+            filePath = location.getRelativePath().str();
+            diagnostic.location.line = location.getLine();
+            diagnostic.filePath = TerminatedCharSlice(filePath.c_str(), Count(filePath.size()));
+        }
+
+        add(diagnostic);
+    }
+
+        /// Stream the diagnostic to the callback, or buffer it
+    void add(const ArtifactDiagnostic& diagnostic)
+    {
+        if (m_callback)
+        {
+            m_callback(diagnostic, m_callbackUserData);
+
+            // When streaming only errors are kept
+            if (diagnostic.severity != ArtifactDiagnostic::Severity::Error)
+            {
+                return;
+            }
+        }
+
+        m_diagnostics->add(diagnostic);
+    }
+
+    bool hasError() const { return getNumErrors() > 0; }
+
+    ComPtr<IArtifactDiagnostics> m_diagnostics;
+
+    LLVMCompileOptions::DiagnosticCallback m_callback;
+    void* m_callbackUserData;
+};
+
+// Installed on the LLVMContext whilst a module is optimized, to report the remarks of the passes matching a filter
+class RemarkDiagnosticHandler : public DiagnosticHandler
+{
+public:
+    RemarkDiagnosticHandler(const std::string& filter, BufferedDiagnosticConsumer* consumer):
+        m_filter(filter),
+        m_consumer(consumer)
+    {
+    }
+
+    bool handleDiagnostics(const DiagnosticInfo& info) override
+    {
+        if (auto remark = dyn_cast<DiagnosticInfoOptimizationBase>(&info))
+        {
+            if (remark->isEnabled())
+            {
+                m_consumer->addRemark(*remark);
+            }
+            return true;
+        }
+        // Let the context handle anything else
+        return false;
+    }
+
+    bool isAnalysisRemarkEnabled(StringRef passName) const override { return m_filter.match(passName); }
+    bool isMissedOptRemarkEnabled(StringRef passName) const override { return m_filter.match(passName); }
+    bool isPassedOptRemarkEnabled(StringRef passName) const override { return m_filter.match(passName); }
+    bool isAnyRemarkEnabled() const override { return true; }
+
+protected:
+    Regex m_filter;
+    BufferedDiagnosticConsumer* m_consumer;
+};
+
+/*
+* A question is how to make the prototypes available for these functions. They would need to be defined before the
+* the prelude - or potentially in the prelude.
+*
+* I could just define the prototypes in the prelude, and only impl, if needed. Here though I require that all the functions
+* implemented here, use C style names (ie unmanagled) to simplify lookup.
+*/
+
+struct NameAndFunc
+{
+    typedef void (*Func)();
+
+    const char* name;
+    Func func;
+};
+
+#define SLANG_LLVM_EXPAND(x) x
+
+#define SLANG_LLVM_FUNC(name, cppName, retType, paramTypes) NameAndFunc{ #name, (NameAndFunc::Func)static_cast<retType (*) paramTypes>(&SLANG_LLVM_EXPAND(cppName)) },
+
+// Implementations of maths functions available to JIT
+static float F32_frexp(float x, int* e)
+{
+    float m = ::frexpf(x, e);
+    return m;
+}
+
+static double F64_frexp(double x, int* e)
+{
+    double m = ::frexp(x, e);
+    return m;
+}
+
+static void assertFailed(const char* msg)
+{
+    printf("Assert failed: %s\n", msg);
+    SLANG_BREAKPOINT(0);
+}
+
+// Returns the highest x86-64 microarchitecture level (1 to 4) the CPU supports, or 0 if it isn't x86-64.
+// Used by multiversioned code to pick the variants to use.
+static int32_t getCPULevel()
+{
+    static const int32_t level = []()
+    {
+#if SLANG_PROCESSOR_X86_64
+        StringMap<bool> features;
+        if (!sys::getHostCPUFeatures(features))
+        {
+            return 1;
+        }
+        auto hasAll = [&](std::initializer_list<const char*> names)
+        {
+            for (auto name : names)
+            {
+                if (!features.lookup(name))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        if (!hasAll({ "cx16", "sahf", "popcnt", "sse3", "sse4.1", "sse4.2", "ssse3" }))
+        {
+            return 1;
+        }
+        if (!hasAll({ "avx", "avx2", "bmi", "bmi2", "f16c", "fma", "lzcnt", "movbe", "xsave" }))
+        {
+            return 2;
+        }
+        if (!hasAll({ "avx512f", "avx512bw", "avx512cd", "avx512dq", "avx512vl" }))
+        {
+            return 3;
+        }
+        return 4;
+#else
+        return 0;
+#endif
+    }();
+    return level;
+}
+
+#if SLANG_OSX
+
+namespace OSXSpecific
+{
+
+static void bzero(void* dst, size_t size)
+{
+    ::memset(dst, 0, size);
+}
+
+} // OSXSpecific
+#endif
+
+#if SLANG_VC && SLANG_PTR_IS_32
+
+namespace WinSpecific {
+
+// NOTE! These are functions used in 32 bit windows to enable 64 bit maths. This set is probably *not* complete.
+// Check:
+
+// https://source.winehq.org/source/dlls/ntdll/large_int.c
+
+static int64_t __stdcall _alldiv(int64_t a, int64_t b)
+{
+    return a / b;
+}
+
+static int64_t __stdcall _allrem(int64_t a, int64_t b)
+{
+    return a % b;
+}
+
+static uint64_t __stdcall _aullrem(uint64_t a, uint64_t b)
+{
+    return a % b;
+}
+
+static uint64_t __stdcall _aulldiv(uint64_t a, uint64_t b)
+{
+    return a / b;
+}
+
+} // WinSpecific
+
+#endif
+
+// These are only the functions that cannot be implemented with 'reasonable performance' in the prelude.
+// It is assumed that calling from JIT to C function whilst not super expensive, is an issue. 
+
+// name, cppName, retType, paramTypes
+#define SLANG_LLVM_FUNCS(x) \
+    x(F64_ceil, ceil, double, (double)) \
+    x(F64_floor, floor, double, (double)) \
+    x(F64_round, round, double, (double)) \
+    x(F64_abs, fabs, double, (double)) \
+    x(F64_sin, sin, double, (double)) \
+    x(F64_cos, cos, double, (double)) \
+    x(F64_tan, tan, double, (double)) \
+    x(F64_asin, asin, double, (double)) \
+    x(F64_acos, acos, double, (double)) \
+    x(F64_atan, atan, double, (double)) \
+    x(F64_sinh, sinh, double, (double)) \
+    x(F64_cosh, cosh, double, (double)) \
+    x(F64_tanh, tanh, double, (double)) \
+    x(F64_log2, log2, double, (double)) \
+    x(F64_log, log, double, (double)) \
+    x(F64_log10, log10, double, (double)) \
+    x(F64_exp2, exp2, double, (double)) \
+    x(F64_exp, exp, double, (double)) \
+    x(F64_fabs, fabs, double, (double)) \
+    x(F64_trunc, trunc, double, (double)) \
+    x(F64_sqrt, sqrt, double, (double)) \
+    \
+    x(F64_isnan, SLANG_LLVM_STD isnan, bool, (double)) \
+    x(F64_isfinite, SLANG_LLVM_STD isfinite, bool, (double)) \
+    x(F64_isinf, SLANG_LLVM_STD isinf, bool, (double)) \
+    \
+    x(F64_atan2, atan2, double, (double, double)) \
+    \
+    x(F64_frexp, F64_frexp, double, (double, int*)) \
+    x(F64_pow, pow, double, (double, double)) \
+    \
+    x(F64_modf, modf, double, (double, double*)) \
+    x(F64_fmod, fmod, double, (double, double)) \
+    x(F64_remainder, remainder, double, (double, double)) \
+    \
+    x(F32_ceil, ceilf, float, (float)) \
+    x(F32_floor, floorf, float, (float)) \
+    x(F32_round, roundf, float, (float)) \
+    x(F32_abs, fabsf, float, (float)) \
+    x(F32_sin, sinf, float, (float)) \
+    x(F32_cos, cosf, float, (float)) \
+    x(F32_tan, tanf, float, (float)) \
+    x(F32_asin, asinf, float, (float)) \
+    x(F32_acos, acosf, float, (float)) \
+    x(F32_atan, atanf, float, (float)) \
+    x(F32_sinh, sinhf, float, (float)) \
+    x(F32_cosh, coshf, float, (float)) \
+    x(F32_tanh, tanhf, float, (float)) \
+    x(F32_log2, log2f, float, (float)) \
+    x(F32_log, logf, float, (float)) \
+    x(F32_log10, log10f, float, (float)) \
+    x(F32_exp2, exp2f, float, (float)) \
+    x(F32_exp, expf, float, (float)) \
+    x(F32_fabs, fabsf, float, (float)) \
+    x(F32_trunc, truncf, float, (float)) \
+    x(F32_sqrt, sqrtf, float, (float)) \
+    \
+    x(F32_isnan, SLANG_LLVM_STD isnan, bool, (float)) \
+    x(F32_isfinite, SLANG_LLVM_STD isfinite, bool, (float)) \
+    x(F32_isinf, SLANG_LLVM_STD isinf, bool, (float)) \
+    \
+    x(F32_atan2, atan2f, float, (float, float)) \
+    \
+    x(F32_frexp, F32_frexp, float, (float, int*)) \
+    x(F32_pow, powf, float, (float, float)) \
+    \
+    x(F32_modf, modff, float, (float, float*)) \
+    x(F32_fmod, fmodf, float, (float, float)) \
+    x(F32_remainder, remainderf, float, (float, float)) \
+    \
+    x(assertFailed, assertFailed, void, (const char*)) \
+    \
+    x(memcpy, memcpy, void*, (void*, const void*, size_t)) \
+    x(memmove, memmove, void*, (void*, const void*, size_t)) \
+    x(memcmp, memcmp, int, (const void*, const void*, size_t)) \
+    x(memset, memset, void*, (void*, int, size_t)) \
+    \
+    x(slang_llvm_groupBarrier, FiberGroup::barrier, void, ()) \
+    x(slang_llvm_getCPULevel, getCPULevel, int32_t, ())
+
+#if SLANG_OSX
+#   define SLANG_PLATFORM_FUNCS(x) \
+    x(memset_pattern4, memset_pattern4, void, (void*, const void*, size_t)) \
+    x(memset_pattern8, memset_pattern8, void, (void*, const void*, size_t)) \
+    x(memset_pattern16, memset_pattern16, void, (void*, const void*, size_t)) \
+    \
+    x(__bzero, OSXSpecific::bzero, void, (void*, size_t))
+#endif
+
+#if SLANG_WINDOWS_FAMILY 
+#   if SLANG_PROCESSOR_X86
+#       define SLANG_PLATFORM_FUNCS(x) \
+            x(_chkstk, _chkstk, void, ()) 
+#   else
+#       define SLANG_PLATFORM_FUNCS(x) \
+            x(__chkstk, __chkstk, void, ()) 
+#   endif
+#endif
+
+#ifndef SLANG_PLATFORM_FUNCS
+#   define SLANG_PLATFORM_FUNCS(x)
+#endif
+
+static int _getOptimizationLevel(DownstreamCompileOptions::OptimizationLevel level)
+{
+    typedef DownstreamCompileOptions::OptimizationLevel OptimizationLevel;
+    switch (level)
+    {
+        case OptimizationLevel::None:     return 0;
+        default:
+        case OptimizationLevel::Default:  return 1;
+        case OptimizationLevel::High:     return 2;
+        case OptimizationLevel::Maximal:  return 3;
+    }
+}
+
+static PassBuilder::OptimizationLevel _getPassBuilderOptimizationLevel(int level)
+{
+    typedef PassBuilder::OptimizationLevel OptimizationLevel;
+    switch (level)
+    {
+        case 0:     return OptimizationLevel::O0;
+        case 1:     return OptimizationLevel::O1;
+        case 2:     return OptimizationLevel::O2;
+        default:    return OptimizationLevel::O3;
+    }
+}
+
+static std::unique_ptr<TargetMachine> _createTargetMachine(const std::string& targetTriple)
+{
+    std::string error;
+    const llvm::Target* target = TargetRegistry::lookupTarget(targetTriple, error);
+    if (!target)
+    {
+        return nullptr;
+    }
+
+    // The CPU and features are generic, functions have attributes that specify what they actually target.
+    llvm::TargetOptions targetOptions;
+    return std::unique_ptr<TargetMachine>(target->createTargetMachine(targetTriple, "", "", targetOptions, None));
+}
+
+/* Adds metadata to the innermost loops of a function, such that the loop vectorizer uses the given width */
+class ForceVectorizeWidthPass : public PassInfoMixin<ForceVectorizeWidthPass>
+{
+public:
+    PreservedAnalyses run(Function& func, FunctionAnalysisManager& analysisManager)
+    {
+        auto& loopInfo = analysisManager.getResult<LoopAnalysis>(func);
+        for (Loop* loop : loopInfo.getLoopsInPreorder())
+        {
+            if (loop->isInnermost())
+            {
+                addStringMetadataToLoop(loop, "llvm.loop.vectorize.enable", 1);
+                addStringMetadataToLoop(loop, "llvm.loop.vectorize.width", m_width);
+            }
+        }
+        // Only metadata is changed
+        return PreservedAnalyses::all();
+    }
+
+    ForceVectorizeWidthPass(uint32_t width):
+        m_width(width)
+    {
+    }
+
+protected:
+    uint32_t m_width;
+};
+
+// Passes run by PipelineProfile::LowLatency. Inlining (which the code Slang generates relies on) and the cheapest
+// scalar simplifications, without any loop passes.
+static const char kLowLatencyPipeline[] = "always-inline,cgscc(inline,function(sroa,early-cse,instcombine,simplifycfg)),globaldce";
+
+// Added after the pipeline of PipelineProfile::Throughput, such that loops with trip counts only known at runtime are
+// also unrolled. Loops that have already been unrolled are marked as such, so are left alone.
+static const char kThroughputUnrollPipeline[] = "function(loop-unroll<O3;runtime;partial;upperbound>,instcombine,simplifycfg)";
+
+// Checks the text can be parsed as a pipeline of passes, outputting why not in outError. The pass builder is created
+// for the target as _optimizeModule's is, so the target's own passes can be named.
+static SlangResult _checkPassPipeline(StringRef text, std::string& outError)
+{
+    std::unique_ptr<TargetMachine> targetMachine = _createTargetMachine(LLVM_DEFAULT_TARGET_TRIPLE);
+    PassBuilder passBuilder(targetMachine.get());
+    ModulePassManager modulePassManager;
+    if (auto err = passBuilder.parsePassPipeline(modulePassManager, text))
+    {
+        outError = llvm::toString(std::move(err));
+        return SLANG_E_INVALID_ARG;
+    }
+    return SLANG_OK;
+}
+
+// The optimization pipeline run on a module
+enum class OptimizationPipeline
+{
+    Default,            ///< Optimize the module on its own
+    PreLink,            ///< Optimize the module such that it can be linked with others and then optimized again (full LTO)
+    Link,               ///< Optimize modules that have been linked together, having been optimized with PreLink, as one module
+};
+
+/* Runs the optimization pipeline on the module.
+
+Used when _needsOwnPipeline is true, in which case clang is told not to run any LLVM passes, such that it's possible
+to change the unoptimized IR (for example to add profile instrumentation) before optimization takes place.
+
+If the budget says the compilation should stop, any remaining optional passes are skipped. If specialization is set, loads are
+replaced as described in the Specialization section. If vectorizeWidth is not 0 innermost loops are vectorized with that width.
+Profiles other than Default replace the pipeline of the optimization level, passPipeline being the passes of Custom. Throughput
+doesn't replace the pipeline of OptimizationLevel::None, so unoptimized code stays unoptimized.
+
+Returns an error, without optimizing the module, if the pipeline can't be parsed. */
+static Error _optimizeModule(llvm::Module& module, const CodeGenOptions& codeGenOpts, const CompileBudget& budget, const FunctionSpecialization* specialization, uint32_t vectorizeWidth, OptimizationPipeline pipeline, LLVMCompileOptions::PipelineProfile profile, StringRef passPipeline)
+{
+    typedef LLVMCompileOptions::PipelineProfile PipelineProfile;
+
+    // The target machine is used to determine costs. If one can't be created, generic costs are used.
+    std::unique_ptr<TargetMachine> targetMachine = _createTargetMachine(module.getTargetTriple());
+
+    // Only a profile for optimized code
+    const bool isThroughput = (profile == PipelineProfile::Throughput) && codeGenOpts.OptimizationLevel > 0;
+
+    // Set up the same way clang would
+    PipelineTuningOptions tuningOptions;
+    tuningOptions.LoopUnrolling = codeGenOpts.UnrollLoops;
+    tuningOptions.LoopInterleaving = codeGenOpts.UnrollLoops;
+    tuningOptions.LoopVectorization = codeGenOpts.VectorizeLoop;
+    tuningOptions.SLPVectorization = codeGenOpts.VectorizeSLP;
+    tuningOptions.MergeFunctions = codeGenOpts.MergeFunctions;
+
+    if (isThroughput)
+    {
+        tuningOptions.LoopUnrolling = true;
+        tuningOptions.LoopInterleaving = true;
+        tuningOptions.LoopVectorization = true;
+        tuningOptions.SLPVectorization = true;
+    }
+
+    LoopAnalysisManager loopAnalysisManager;
+    FunctionAnalysisManager functionAnalysisManager;
+    CGSCCAnalysisManager cgsccAnalysisManager;
+    ModuleAnalysisManager moduleAnalysisManager;
+
+    PassInstrumentationCallbacks instrumentationCallbacks;
+    instrumentationCallbacks.registerShouldRunOptionalPassCallback([&budget](StringRef passName, Any ir) 
+    {
+        return !budget.shouldStop();
+    });
+
+    PassBuilder passBuilder(targetMachine.get(), tuningOptions, None, &instrumentationCallbacks);
+
+    if (specialization)
+    {
+        // Runs after each instruction combining in the function simplification pipeline, which takes place after inlining
+        passBuilder.registerPeepholeEPCallback([specialization](FunctionPassManager& functionPassManager, PassBuilder::OptimizationLevel)
+        {
+            functionPassManager.addPass(SpecializeLoadsPass(*specialization));
+        });
+    }
+
+    if (vectorizeWidth)
+    {
+        passBuilder.registerVectorizerStartEPCallback([vectorizeWidth](FunctionPassManager& functionPassManager, PassBuilder::OptimizationLevel)
+        {
+            functionPassManager.addPass(ForceVectorizeWidthPass(vectorizeWidth));
+        });
+    }
+
+    passBuilder.registerModuleAnalyses(moduleAnalysisManager);
+    passBuilder.registerCGSCCAnalyses(cgsccAnalysisManager);
+    passBuilder.registerFunctionAnalyses(functionAnalysisManager);
+    passBuilder.registerLoopAnalyses(loopAnalysisManager);
+    passBuilder.crossRegisterProxies(loopAnalysisManager, functionAnalysisManager, cgsccAnalysisManager, moduleAnalysisManager);
+
+    const auto optimizationLevel = isThroughput ? PassBuilder::OptimizationLevel::O3 : _getPassBuilderOptimizationLevel(codeGenOpts.OptimizationLevel);
+
+    ModulePassManager modulePassManager;
+    if (profile == PipelineProfile::LowLatency || profile == PipelineProfile::Custom)
+    {
+        const StringRef pipelineText = (profile == PipelineProfile::Custom) ? passPipeline : StringRef(kLowLatencyPipeline);
+
+        // A custom pipeline is checked before the compilation starts (see _checkPassPipeline), but may still fail here
+        if (auto err = passBuilder.parsePassPipeline(modulePassManager, pipelineText))
+        {
+            return err;
+        }
+    }
+    else if (optimizationLevel == PassBuilder::OptimizationLevel::O0)
+    {
+        modulePassManager = passBuilder.buildO0DefaultPipeline(optimizationLevel, pipeline == OptimizationPipeline::PreLink);
+    }
+    else
+    {
+        switch (pipeline)
+        {
+            case OptimizationPipeline::PreLink:     modulePassManager = passBuilder.buildLTOPreLinkDefaultPipeline(optimizationLevel); break;
+            case OptimizationPipeline::Link:        modulePassManager = passBuilder.buildLTODefaultPipeline(optimizationLevel, nullptr); break;
+            default:                                modulePassManager = passBuilder.buildPerModuleDefaultPipeline(optimizationLevel); break;
+        }
+
+        if (isThroughput)
+        {
+            if (auto err = passBuilder.parsePassPipeline(modulePassManager, kThroughputUnrollPipeline))
+            {
+                return err;
+            }
+        }
+    }
+
+    modulePassManager.run(module, moduleAnalysisManager);
+    return Error::success();
+}
+
+static void _addError(IArtifactDiagnostics* diagnostics, ArtifactDiagnostic::Stage stage, const char* text)
+{
+    ArtifactDiagnostic diagnostic;
+
+    diagnostic.severity = ArtifactDiagnostic::Severity::Error;
+    diagnostic.stage = stage;
+    diagnostic.text = TerminatedCharSlice(text);
+
+    diagnostics->add(diagnostic);
+}
+
+// Adds an error with the message of err appended to the text, consuming err
+static void _addError(IArtifactDiagnostics* diagnostics, ArtifactDiagnostic::Stage stage, const char* text, Error err)
+{
+    const std::string message = std::string(text) + ": " + llvm::toString(std::move(err));
+    _addError(diagnostics, stage, message.c_str());
+}
+
+// Returns true if the compilation should stop, in which case an error is added saying why
+static bool _shouldStop(const CompileBudget& budget, IArtifactDiagnostics* diagnostics)
+{
+    if (budget.isCancelled())
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Compilation was cancelled");
+        return true;
+    }
+    if (budget.shouldFail())
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Compilation exceeded its time budget");
+        return true;
+    }
+    return false;
+}
+
+// Outputs an artifact that just holds the diagnostics
+static SlangResult _createDiagnosticsArtifact(IArtifactDiagnostics* diagnostics, IArtifact** outArtifact)
+{
+    auto artifact = ArtifactUtil::createArtifact(ArtifactDesc::make(ArtifactKind::None, ArtifactPayload::None));
+    ArtifactUtil::addAssociated(artifact, diagnostics);
+
+    *outArtifact = artifact.detach();
+    return SLANG_OK;
+}
+
+// Outputs an artifact that just holds the diagnostics of a compilation that failed
+static SlangResult _createFailedArtifact(IArtifactDiagnostics* diagnostics, IArtifact** outArtifact)
+{
+    diagnostics->setResult(SLANG_FAIL);
+    return _createDiagnosticsArtifact(diagnostics, outArtifact);
+}
+
+static bool _hasError(IArtifactDiagnostics* diagnostics)
+{
+    const Count count = diagnostics->getCount();
+    for (Index i = 0; i < count; ++i)
+    {
+        if (diagnostics->getAt(i)->severity == ArtifactDiagnostic::Severity::Error)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Outputs an artifact for options that couldn't be compiled at all, such that the diagnostics result is res
+static void _createInvalidOptionsArtifact(SlangResult res, IArtifact** outArtifact)
+{
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
+    _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Unable to compile with the options");
+    _createFailedArtifact(diagnostics, outArtifact);
+    diagnostics->setResult(res);
+}
+
+static SlangResult _initLLVM()
+{
+    // Initialize targets first, so that --version shows registered targets.
+#if 0
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmPrinters();
+    llvm::InitializeAllAsmParsers();
+#else
+    // Just initialize items needed for this target.
+
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+
+    llvm::InitializeNativeTargetDisassembler();
+#endif
+
+    // Set an error handler, so that any LLVM backend diagnostics go through our
+    // error handler.
+    //llvm::install_fatal_error_handler(_llvmErrorHandler, static_cast<void*>(&clang->getDiagnostics()));
+    // NOTE! Can only be set once.
+    llvm::install_fatal_error_handler(_llvmErrorHandler, nullptr);
+
+    return SLANG_OK;
+}
+
+// Initializes LLVM the first time it's called, returning the result of initialization
+static SlangResult _ensureLLVMInitialized()
+{
+    static const SlangResult initLLVMResult = _initLLVM();
+    return initLLVMResult;
+}
+
+bool LLVMDownstreamCompiler::canConvert(const ArtifactDesc& from, const ArtifactDesc& to)
+{
+    return false;
+}
+
+SlangResult LLVMDownstreamCompiler::convert(IArtifact* from, const ArtifactDesc& to, IArtifact** outArtifact)
+{
+    return SLANG_E_NOT_IMPLEMENTED;
+}
+
+SlangResult LLVMDownstreamCompiler::getVersionString(slang::IBlob** outVersionString)
+{
+    StringBuilder versionString;
+    // Append the version
+    m_desc.version.append(versionString);
+
+    // Really we should have a hash to identify the specific version.
+    // For now we'll fall back to just using the timestamp
+
+    {
+        // If we don't have the commitHash, we use the library timestamp, to uniquely identify.
+        versionString << " " << SharedLibraryUtils::getSharedLibraryTimestamp((void*)createLLVMDownstreamCompiler_V4);
+    }
+
+    *outVersionString = StringBlob::moveCreate(versionString).detach();
+    return SLANG_OK;
+}
+
+void* LLVMDownstreamCompiler::castAs(const Guid& guid)
+{
+    if (auto ptr = getInterface(guid))
+    {
+        return ptr;
+    }
+    return getObject(guid);
+}
+
+void* LLVMDownstreamCompiler::getInterface(const Guid& guid)
+{
+    if (guid == ISlangUnknown::getTypeGuid() ||
+        guid == ICastable::getTypeGuid() ||
+        guid == IDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<IDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMAsyncDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMAsyncDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMBatchDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMBatchDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMAutotuneDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMAutotuneDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMSymbolDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMSymbolDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMLinkDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMLinkDownstreamCompiler*>(this);
+    }
+    else if (guid == ILLVMLibraryDownstreamCompiler::getTypeGuid())
+    {
+        return static_cast<ILLVMLibraryDownstreamCompiler*>(this);
+    }
+    return nullptr;
+}
+
+void* LLVMDownstreamCompiler::getObject(const Guid& guid)
+{
+    SLANG_UNUSED(guid);
+    return nullptr;
+}
+
+SlangResult LLVMCompileRequest::init(const CompileOptions& options)
+{
+    // Currently supports single source file
+    if (options.sourceArtifacts.count != 1)
+    {
+        return SLANG_FAIL;
+    }
+    IArtifact* sourceArtifact = options.sourceArtifacts[0];
+
+    SLANG_RETURN_ON_FAIL(sourceArtifact->loadBlob(ArtifactKeep::Yes, sourceBlob.writeRef()));
+
+    optimizationLevel = options.optimizationLevel;
+    floatingPointMode = options.floatingPointMode;
+    targetType = options.targetType;
+    sourceLanguage = options.sourceLanguage;
+
+    for (const auto& define : options.defines)
+    {
+        const Index index = asStringSlice(define.nameWithSig).indexOf('(');
+        if (index >= 0)
+        {
+            // Interface does not support having a signature.
+            return SLANG_E_NOT_AVAILABLE;
+        }
+
+        // TODO(JS): NOTE! The options do not support setting a *value* just that a macro is defined.
+        // So strictly speaking, we should probably have a warning/error if the value is not appropriate
+        defines.push_back(define.nameWithSig.begin());
+    }
+
+    for (const auto& includePath : options.includePaths)
+    {
+        includePaths.push_back(includePath.begin());
+    }
+
+    return SLANG_OK;
+}
+
+// The size of each version of LLVMCompileOptions, indexed by version - 1. When fields are added kVersion is incremented,
+// and the size of the previous version becomes the offset of the first field added.
+static const size_t kLLVMCompileOptionsSizes[] = { sizeof(LLVMCompileOptions) };
+static_assert(SLANG_COUNT_OF(kLLVMCompileOptionsSizes) == LLVMCompileOptions::kVersion, "Each version needs a size");
+static_assert(std::is_trivially_copyable<LLVMCompileOptions>::value, "Versions are copied as bytes");
+
+static bool _isVersionCompatible(const LLVMCompileOptions& options)
+{
+    return options.version >= 1 && options.version <= LLVMCompileOptions::kVersion;
+}
+
+// Returns the current version of options, fields the caller doesn't know about taking their defaults
+static LLVMCompileOptions _getCompatibleVersion(const LLVMCompileOptions* options)
+{
+    LLVMCompileOptions compatibleOptions;
+    ::memcpy(&compatibleOptions, options, kLLVMCompileOptionsSizes[options->version - 1]);
+    compatibleOptions.version = LLVMCompileOptions::kVersion;
+    return compatibleOptions;
+}
+
+SlangResult LLVMDownstreamCompiler::compile(const CompileOptions& options, IArtifact** outArtifact)
+{
+    const LLVMCompileOptions llvmOptions;
+    return compileWithOptions(options, llvmOptions, outArtifact);
+}
+
+SlangResult LLVMDownstreamCompiler::compileWithOptions(const CompileOptions& inOptions, const LLVMCompileOptions& inLLVMOptions, IArtifact** outArtifact)
+{
+    if (!isVersionCompatible(inOptions) || !_isVersionCompatible(inLLVMOptions))
+    {
+        // Not possible to compile with this version of the interface.
+        return SLANG_E_NOT_IMPLEMENTED;
+    }
+
+    CompileOptions options = getCompatibleVersion(&inOptions);
+    const LLVMCompileOptions llvmOptions = _getCompatibleVersion(&inLLVMOptions);
+
+    CompileBudget budget;
+    budget.init(llvmOptions);
+
+    RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+    SLANG_RETURN_ON_FAIL(request->init(options));
+    request->runtimeSymbols = _getRuntimeSymbolTable();
+    request->setReferencedOptions(llvmOptions);
+
+    return _compile(request, llvmOptions, budget, nullptr, outArtifact);
+}
+
+SlangResult LLVMDownstreamCompiler::compileAsync(const CompileOptions& inOptions, const LLVMCompileOptions& inLLVMOptions, LLVMCompilePriority priority, ILLVMCompileTask** outTask)
+{
+    if (!isVersionCompatible(inOptions) || !_isVersionCompatible(inLLVMOptions))
+    {
+        // Not possible to compile with this version of the interface.
+        return SLANG_E_NOT_IMPLEMENTED;
+    }
+
+    CompileOptions options = getCompatibleVersion(&inOptions);
+    const LLVMCompileOptions llvmOptions = _getCompatibleVersion(&inLLVMOptions);
+
+    // Copy everything needed now, as the options may not be valid when the compilation takes place
+    RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+    SLANG_RETURN_ON_FAIL(request->init(options));
+    request->runtimeSymbols = _getRuntimeSymbolTable();
+    request->setReferencedOptions(llvmOptions);
+
+    ComPtr<LLVMCompileTask> task(new LLVMCompileTask(request, llvmOptions, priority, m_workerPool.nextSequence()));
+    m_workerPool.enqueue(this, task);
+
+    *outTask = task.detach();
+    return SLANG_OK;
+}
+
+SlangResult LLVMDownstreamCompiler::compileBatch(const CompileOptions* options, Count count, const LLVMCompileOptions& inLLVMOptions, IArtifact** outArtifacts)
+{
+    if (!_isVersionCompatible(inLLVMOptions))
+    {
+        return SLANG_E_NOT_IMPLEMENTED;
+    }
+    const LLVMCompileOptions llvmOptions = _getCompatibleVersion(&inLLVMOptions);
+
+    for (Index i = 0; i < count; ++i)
+    {
+        if (!isVersionCompatible(options[i]))
+        {
+            // Not possible to compile with this version of the interface.
+            return SLANG_E_NOT_IMPLEMENTED;
+        }
+    }
+
+    // All of the compilations use the same runtime symbols, as they share a JIT
+    RefPtr<RuntimeSymbolTable> runtimeSymbols = _getRuntimeSymbolTable();
+    RefPtr<SharedJIT> sharedJIT(new SharedJIT(runtimeSymbols));
+
+    // Start all of the compilations
+    std::vector<ComPtr<LLVMCompileTask>> tasks(count);
+    for (Index i = 0; i < count; ++i)
+    {
+        outArtifacts[i] = nullptr;
+
+        RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+        const SlangResult initResult = request->init(getCompatibleVersion(&options[i]));
+        if (SLANG_FAILED(initResult))
+        {
+            _createInvalidOptionsArtifact(initResult, &outArtifacts[i]);
+            continue;
+        }
+        request->runtimeSymbols = runtimeSymbols;
+        request->setReferencedOptions(llvmOptions);
+
+        tasks[i] = ComPtr<LLVMCompileTask>(new LLVMCompileTask(request, llvmOptions, LLVMCompilePriority::Normal, m_workerPool.nextSequence(), sharedJIT));
+        m_workerPool.enqueue(this, tasks[i]);
+    }
+
+    // Wait for them in order
+    for (Index i = 0; i < count; ++i)
+    {
+        if (auto task = tasks[i].get())
+        {
+            task->wait();
+
+            const SlangResult result = task->getResult(&outArtifacts[i]);
+            if (SLANG_FAILED(result) && !outArtifacts[i])
+            {
+                _createInvalidOptionsArtifact(result, &outArtifacts[i]);
+            }
+        }
+    }
+
+    return SLANG_OK;
+}
+
+void LLVMDownstreamCompiler::executeTask(LLVMCompileTask* task)
+{
+    ComPtr<IArtifact> artifact;
+    const SlangResult result = _compile(task->m_request, task->m_llvmOptions, task->m_budget, task->m_sharedJIT, artifact.writeRef());
+    task->complete(result, artifact);
+}
+
+SlangResult LLVMDownstreamCompiler::recompileWithProfile(IArtifact* artifact, ISlangBlob* profileData, IArtifact** outArtifact)
+{
+    LLVMJITSharedLibrary* sharedLibrary = LLVMJITSharedLibrary::getFromArtifact(artifact);
+    if (!sharedLibrary || !sharedLibrary->getCompileRequest()->sourceBlob || !profileData)
+    {
+        return SLANG_E_INVALID_ARG;
+    }
+
+    // Compiled as the artifact was, other than using the profile
+    LLVMCompileOptions llvmOptions = sharedLibrary->getCompileOptions();
+    llvmOptions.profileMode = LLVMCompileOptions::ProfileMode::Use;
+    llvmOptions.profileData = profileData;
+
+    CompileBudget budget;
+    return _compile(sharedLibrary->getCompileRequest(), llvmOptions, budget, nullptr, outArtifact);
+}
+
+SlangResult LLVMDownstreamCompiler::createCancellationToken(ILLVMCancellationToken** outToken)
+{
+    ComPtr<ILLVMCancellationToken> token(new LLVMCancellationToken);
+    *outToken = token.detach();
+    return SLANG_OK;
+}
+
+// Makes everything in module internal other than the exported symbols, and removes anything that is then unused
+static void _internalizeAllExcept(llvm::Module& module, const StringSet<>& exportNames)
+{
+    internalizeModule(module, [&](const GlobalValue& value) { return exportNames.count(value.getName()) != 0; });
+
+    // Only module analyses are needed, so there's no need for the TargetMachine or the other analysis managers
+    ModuleAnalysisManager moduleAnalysisManager;
+    PassBuilder passBuilder;
+    passBuilder.registerModuleAnalyses(moduleAnalysisManager);
+
+    ModulePassManager modulePassManager;
+    modulePassManager.addPass(GlobalDCEPass());
+    modulePassManager.run(module, moduleAnalysisManager);
+}
+
+// Returns true if the inline functions of library are the same as those of a compilation with defines and
+// floatingPointMode, such that they can replace the compilation's own copies
+static bool _isLibraryCompatible(const RuntimeLibrary& library, const std::vector<std::string>& defines, DownstreamCompileOptions::FloatingPointMode floatingPointMode)
+{
+    if (library.floatingPointMode != floatingPointMode || library.defines.size() != defines.size())
+    {
+        return false;
+    }
+    std::vector<std::string> sortedDefines(defines);
+    std::sort(sortedDefines.begin(), sortedDefines.end());
+    return sortedDefines == library.defines;
+}
+
+/* Links the registered runtime bitcode into module, such that calls to its functions can be inlined. Only what module
+uses is linked. Functions that are also registered as symbols become available externally, so calls that aren't inlined
+call the registered symbol. Anything else that is linked is internal to module.
+
+The bitcode of a registered library is only linked if the library is compatible with the compilation (having the same
+defines and floatingPointMode), as otherwise its inline functions may differ from the module's, and the module's copies
+are used. */
+static SlangResult _linkRuntimeBitcode(llvm::Module& module, const RuntimeSymbolTable& runtimeSymbols, const std::vector<std::string>& defines, DownstreamCompileOptions::FloatingPointMode floatingPointMode)
+{
+    std::vector<const std::string*> bitcodeModules;
+    for (const auto& bitcode : runtimeSymbols.bitcodeModules)
+    {
+        bitcodeModules.push_back(&bitcode);
+    }
+
+    // Inline functions provided by a compatible library are replaced by declarations, such that the library's code is
+    // called (or its definition linked below and inlined), rather than code being generated for the module's copy
+    for (const RuntimeLibrary& library : runtimeSymbols.libraries)
+    {
+        if (!_isLibraryCompatible(library, defines, floatingPointMode))
+        {
+            continue;
+        }
+        bitcodeModules.push_back(&library.bitcode);
+
+        for (Function& func : module)
+        {
+            if (func.hasLinkOnceODRLinkage() && library.functionNames.count(func.getName()))
+            {
+                func.deleteBody();
+                func.setComdat(nullptr);
+                func.setDSOLocal(false);
+            }
+        }
+    }
+
+    for (const std::string* bitcode : bitcodeModules)
+    {
+        auto srcExpected = getLazyBitcodeModule(MemoryBufferRef(*bitcode, "runtime bitcode"), module.getContext());
+        if (!srcExpected)
+        {
+            consumeError(srcExpected.takeError());
+            return SLANG_FAIL;
+        }
+
+        std::unique_ptr<llvm::Module> src = std::move(*srcExpected);
+
+        // Avoid warnings if the bitcode was produced for a different (but compatible) target
+        src->setTargetTriple(module.getTargetTriple());
+        src->setDataLayout(module.getDataLayout());
+
+        auto internalize = [&](llvm::Module& linkedModule, const StringSet<>& linkedNames)
+        {
+            for (const auto& entry : linkedNames)
+            {
+                GlobalValue* value = linkedModule.getNamedValue(entry.getKey());
+                if (value && !value->isDeclaration() && runtimeSymbols.symbolNames.count(entry.getKey()))
+                {
+                    value->setLinkage(GlobalValue::AvailableExternallyLinkage);
+                }
+            }
+
+            internalizeModule(linkedModule, [&](const GlobalValue& value)
+            {
+                return value.hasAvailableExternallyLinkage() || !linkedNames.count(value.getName());
+            });
+        };
+
+        // Returns true on failure
+        if (Linker::linkModules(module, std::move(src), Linker::Flags::LinkOnlyNeeded, internalize))
+        {
+            return SLANG_FAIL;
+        }
+    }
+    return SLANG_OK;
+}
+
+/* Returns true if the module has to be changed between being generated and optimized, or has to be optimized
+differently from how clang would. Clang is then told not to run any LLVM passes, and the module is optimized by
+_optimizeModule. Otherwise clang's own optimization pipeline is used, as it always was for a plain compile. */
+static bool _needsOwnPipeline(const LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const FunctionSpecialization* specialization, const CompileBudget& budget)
+{
+    return specialization ||
+        budget.hasLimit() ||
+        request->isLibrary ||
+        (request->runtimeSymbols && (request->runtimeSymbols->bitcodeModules.size() || request->runtimeSymbols->libraries.size())) ||
+        request->exportNames.size() ||
+        request->remarksFilter.size() ||
+        llvmOptions.profileMode != LLVMCompileOptions::ProfileMode::None ||
+        llvmOptions.vectorizeGroups ||
+        llvmOptions.multiversionLevels ||
+        llvmOptions.keepBitcode ||
+        (llvmOptions.useTuningConfig && llvmOptions.tuningConfig.vectorizeWidth) ||
+        llvmOptions.pipelineProfile != LLVMCompileOptions::PipelineProfile::Default;
+}
+
+/* Runs the front end and optimization for the request, producing the optimized module in outModule.
+
+If the compilation fails because of errors in the source, or because the budget says it should stop, SLANG_OK is
+returned, outModule is not set, and diagnostics holds the reason. With LLVMCompileOptions::syntaxOnly outModule is
+never set, and the source is valid if diagnostics holds no errors.
+
+If specialization is set, the module is specialized as described in the Specialization section. */
+static SlangResult _compileModule(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const FunctionSpecialization* specialization, const CompileBudget& budget, IArtifactDiagnostics* diagnostics, LLVMContext* llvmContext, std::unique_ptr<llvm::Module>& outModule, BranchProfileLayout& outBranchProfileLayout, std::string* outRemarks)
+{
+    _ensureSufficientStack();
+
+    SLANG_RETURN_ON_FAIL(_ensureLLVMInitialized());
+
+    // Fail before doing any work if the custom pipeline is invalid
+    if (llvmOptions.pipelineProfile == LLVMCompileOptions::PipelineProfile::Custom)
+    {
+        std::string error;
+        if (SLANG_FAILED(_checkPassPipeline(request->passPipeline, error)))
+        {
+            const std::string text = "Invalid pass pipeline: " + error;
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, text.c_str());
+            return SLANG_OK;
+        }
+    }
+
+    std::unique_ptr<CompilerInstance> clang(new CompilerInstance());
+    IntrusiveRefCntPtr<DiagnosticIDs> diagID(new DiagnosticIDs());
+
+    // Register the support for object-file-wrapped Clang modules.
+    auto pchOps = clang->getPCHContainerOperations();
+    pchOps->registerWriter(std::make_unique<ObjectFilePCHContainerWriter>());
+    pchOps->registerReader(std::make_unique<ObjectFilePCHContainerReader>());
+
+    IntrusiveRefCntPtr<DiagnosticOptions> diagOpts = new DiagnosticOptions();
+
+    // Diagnostics are buffered up, unless a callback is set in which case they are streamed to it.
+    BufferedDiagnosticConsumer diagsBuffer(diagnostics, llvmOptions.diagnosticCallback, llvmOptions.diagnosticCallbackUserData);
+
+    IntrusiveRefCntPtr<DiagnosticsEngine> diags = new DiagnosticsEngine(diagID, diagOpts, &diagsBuffer, false);
+
+    // When the limit is reached clang reports a fatal error and stops
+    diags->setErrorLimit(llvmOptions.errorLimit);
+
+    // May have been cancelled or run out of time before starting (for example whilst queued)
+    if (_shouldStop(budget, diagnostics))
+    {
+        return SLANG_OK;
+    }
+
+    BranchProfile branchProfile;
+    if (llvmOptions.profileMode == LLVMCompileOptions::ProfileMode::Use)
+    {
+        const auto profileSlice = llvmOptions.profileData ? StringUtil::getSlice(llvmOptions.profileData) : UnownedStringSlice();
+        if (SLANG_FAILED(branchProfile.parse(StringRef(profileSlice.begin(), profileSlice.getLength()))))
+        {
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Unable to read profile data");
+            return SLANG_OK;
+        }
+    }
+
+    const auto sourceSlice = StringUtil::getSlice(request->sourceBlob);
+    StringRef sourceStringRef(sourceSlice.begin(), sourceSlice.getLength());
+
+    auto sourceBuffer = llvm::MemoryBuffer::getMemBuffer(sourceStringRef);
+
+    auto& invocation = clang->getInvocation();
+
+    std::string verboseOutputString;
+
+    // Capture all of the verbose output into a buffer, so not writen to stdout
+    clang->setVerboseOutputStream(std::make_unique<llvm::raw_string_ostream>(verboseOutputString));
+
+    SmallVector<char> output;
+    clang->setOutputStream(std::make_unique<llvm::raw_svector_ostream>(output));
+
+    frontend::ActionKind action = frontend::ActionKind::EmitLLVMOnly;
+
+    // EmitCodeGenOnly doesn't appear to actually emit anything
+    // EmitLLVM outputs LLVM assembly
+    // EmitLLVMOnly doesn't 'emit' anything, but the IR that is produced is accessible, from the 'action'.
+
+    action = frontend::ActionKind::EmitLLVMOnly;
+
+    if (llvmOptions.syntaxOnly)
+    {
+        action = frontend::ActionKind::ParseSyntaxOnly;
+    }
+
+    //action = frontend::ActionKind::EmitBC;
+    //action = frontend::ActionKind::EmitLLVM;
+    // 
+    //action = frontend::ActionKind::EmitCodeGenOnly;
+    //action = frontend::ActionKind::EmitObj;
+    //action = frontend::ActionKind::EmitAssembly;
+
+    Language language;
+    LangStandard::Kind langStd;
+    switch (request->sourceLanguage)
+    {
+        case SLANG_SOURCE_LANGUAGE_CPP:
+        {
+            language = Language::CXX;
+            langStd = LangStandard::Kind::lang_cxx17;
+            break;
+        }
+        case SLANG_SOURCE_LANGUAGE_C:
+        {
+            language = Language::C;
+            langStd = LangStandard::Kind::lang_c17;
+            break;
+        }
+        default:
+        {
+            return SLANG_E_NOT_AVAILABLE;
+        }
+    }
+
+    const InputKind inputKind(language, InputKind::Format::Source);
+
+    const bool useOwnPipeline = _needsOwnPipeline(request, llvmOptions, specialization, budget);
+
+    // A tuning config replaces the optimization settings of the request
+    const auto optimizationLevel = llvmOptions.useTuningConfig ? llvmOptions.tuningConfig.optimizationLevel : request->optimizationLevel;
+    const auto floatingPointMode = llvmOptions.useTuningConfig ? llvmOptions.tuningConfig.floatingPointMode : request->floatingPointMode;
+
+    {
+        auto& opts = invocation.getFrontendOpts();
+
+        // Add the source
+        // TODO(JS): For the moment this kind of include does *NOT* show a input source filename
+        // not super surprising as one isn't set, but it's not clear how one would be set when the input is a memory buffer.
+        // For Slang usage, this probably isn't an issue, because it's *output* typically holds #line directives.
+        {
+            
+            FrontendInputFile inputFile(*sourceBuffer, inputKind);
+            opts.Inputs.push_back(inputFile);
+        }
+
+        opts.ProgramAction = action;
+    }
+
+    {
+        auto& opts = invocation.getPreprocessorOpts();
+
+        // Add definition so that 'LLVM/Clang' compilations can be recognized
+        opts.addMacroDef("SLANG_LLVM");
+
+        for (const auto& define : request->defines)
+        {
+            opts.addMacroDef(define);
+        }
+    }
+
+    llvm::Triple targetTriple;
+    {
+        auto& opts = invocation.getTargetOpts();
+
+        opts.Triple = LLVM_DEFAULT_TARGET_TRIPLE;
+
+        // A code model isn't set by default, "default" seems to fit the bill here 
+        opts.CodeModel = "default";
+
+        targetTriple = llvm::Triple(opts.Triple);
+
+        // Vectorizing groups is only worthwhile with the widest vectors available, so target the host CPU. When
+        // multiversioning, each variant is vectorized for its level instead, so the code still runs on any CPU.
+        const bool isMultiversioned = llvmOptions.multiversionLevels && targetTriple.getArch() == llvm::Triple::x86_64;
+        if (llvmOptions.vectorizeGroups && !isMultiversioned)
+        {
+            opts.CPU = sys::getHostCPUName().str();
+        }
+    }
+
+    {
+        auto opts = invocation.getLangOpts();
+
+        clang::CompilerInvocation::setLangDefaults(*opts, inputKind, targetTriple, request->includePaths, langStd);
+
+        if (floatingPointMode == DownstreamCompileOptions::FloatingPointMode::Fast)
+        {
+            opts->FastMath = true;
+        }
+
+        // Otherwise inline functions are only emitted if they are used
+        opts->EmitAllDecls = request->isLibrary;
+    }
+
+    {
+        auto& opts = invocation.getHeaderSearchOpts();
+
+        // These only work if the resource directory is setup (or a virtual file system points to it)
+        opts.UseBuiltinIncludes = true;
+        opts.UseStandardSystemIncludes = true;
+        opts.UseStandardCXXIncludes = true;
+
+        /// Use libc++ instead of the default libstdc++.
+        //opts.UseLibcxx = true;
+    }
+
+    {
+        auto& opts = invocation.getCodeGenOpts();
+
+        // Set to -O optimization level
+        opts.OptimizationLevel = _getOptimizationLevel(optimizationLevel);
+
+        if (llvmOptions.useTuningConfig)
+        {
+            opts.UnrollLoops = llvmOptions.tuningConfig.unrollLoops;
+            opts.VectorizeLoop = llvmOptions.tuningConfig.vectorizeLoops;
+            opts.VectorizeSLP = llvmOptions.tuningConfig.vectorizeSLP;
+        }
+
+        // MergeFunctions turns an exported function into a thunk to another, which for incremental would make its code
+        // depend on a function that may be edited independently. Identical functions that can be shared are still merged
+        // by the FunctionStore.
+        opts.MergeFunctions = llvmOptions.shareFunctions && !llvmOptions.incremental;
+
+        if (llvmOptions.profilerSupport)
+        {
+            // Locations come from #line directives, so map back to the source Slang generated the code from
+            opts.setDebugInfo(codegenoptions::DebugLineTablesOnly);
+        }
+        else if (!request->remarksFilter.empty())
+        {
+            // Remarks are located by the debug locations of the code, which are tracked without emitting debug info
+            opts.setDebugInfo(codegenoptions::LocTrackingOnly);
+        }
+
+        // Copy over the targets CodeModel
+        opts.CodeModel = invocation.getTargetOpts().CodeModel;
+
+        // If the IR is changed before optimization, we run the optimization passes on the module ourselves
+        opts.DisableLLVMPasses = useOwnPipeline;
+    }
+
+    //const llvm::opt::OptTable& opts = clang::driver::getDriverOptTable();
+
+    // TODO(JS): Need a way to find in system search paths, for now we just don't bother
+    //
+    // The system search paths are for includes for compiler intrinsics it seems. 
+    // Infer the builtin include path if unspecified.
+#if 0
+    {
+        auto& searchOpts = clang->getHeaderSearchOpts();
+        if (searchOpts.UseBuiltinIncludes && searchOpts.ResourceDir.empty())
+        {
+            // TODO(JS): Hack - hard coded path such that we can test out the
+            // resource directory functionality.
+
+            StringRef binaryPath = "F:/dev/llvm-12.0/llvm-project-llvmorg-12.0.1/build.vs/Release/bin";
+
+            // Dir is bin/ or lib/, depending on where BinaryPath is.
+
+            // On Windows, libclang.dll is in bin/.
+            // On non-Windows, libclang.so/.dylib is in lib/.
+            // With a static-library build of libclang, LibClangPath will contain the
+            // path of the embedding binary, which for LLVM binaries will be in bin/.
+            // ../lib gets us to lib/ in both cases.
+            SmallString<128> path = llvm::sys::path::parent_path(binaryPath);
+            llvm::sys::path::append(path, Twine("lib") + CLANG_LIBDIR_SUFFIX, "clang", CLANG_VERSION_STRING);
+
+            searchOpts.ResourceDir = path.c_str();
+        }
+    }
+#endif
+
+    // Create the actual diagnostics engine.
+    clang->createDiagnostics();
+    clang->setDiagnostics(diags.get());
+
+    if (!clang->hasDiagnostics())
+        return SLANG_FAIL;
+
+    //
+    clang->createFileManager();
+    clang->createSourceManager(clang->getFileManager());
+
+    clang::CodeGenAction* codeGenAction = nullptr;
+    std::unique_ptr<FrontendAction> act;
+
+    {
+        // If we are going to just emit IR, we need to have access to the underlying type
+        if (action == frontend::ActionKind::EmitLLVMOnly)
+        {
+            EmitLLVMOnlyAction* llvmOnlyAction = new EmitLLVMOnlyAction(llvmContext);
+            codeGenAction = llvmOnlyAction;
+            // Make act the owning ptr
+            act = std::unique_ptr<FrontendAction>(llvmOnlyAction);
+        }
+        else
+        {
+            act = CreateFrontendAction(*clang);
+        }
+
+        if (!act)
+        {
+            return SLANG_FAIL;
+        }
+
+        const bool compileSucceeded = clang->ExecuteAction(*act);
+
+        // If the compilation failed make sure, we have an error
+        if (!compileSucceeded)
+        {
+            diagnostics->requireErrorDiagnostic();
+        }
+        
+        if (!compileSucceeded || diagsBuffer.hasError() || _shouldStop(budget, diagnostics))
+        {
+            return SLANG_OK;
+        }
+    }
+
+    // The source has been checked, and there is no module
+    if (action == frontend::ActionKind::ParseSyntaxOnly)
+    {
+        return SLANG_OK;
+    }
+
+    std::unique_ptr<llvm::Module> module;
+
+    switch (action)
+    {
+        case frontend::ActionKind::EmitLLVM:
+        {
+            // LLVM output is text, that must be zero terminated
+            output.push_back(char(0));
+
+            StringRef identifier;
+            StringRef data(output.begin(), output.size() - 1);
+
+            MemoryBufferRef memoryBufferRef(data, identifier);
+
+            SMDiagnostic err;
+            module = llvm::parseIR(memoryBufferRef, err, *llvmContext);
+            break;
+        }
+        case frontend::ActionKind::EmitBC:
+        {
+            StringRef identifier;
+            StringRef data(output.begin(), output.size());
+
+            MemoryBufferRef memoryBufferRef(data, identifier);
+
+            SMDiagnostic err;
+            module = llvm::parseIR(memoryBufferRef, err, *llvmContext);
+            break;
+        }
+        case frontend::ActionKind::EmitLLVMOnly:
+        {
+            // Get the module produced by the action
+            module = codeGenAction->takeModule();
+            break;
+        }
+    }
+
+    if (request->isLibrary)
+    {
+        // Inline functions that are unused would otherwise be removed by optimization
+        for (Function& func : *module)
+        {
+            if (func.hasLinkOnceODRLinkage())
+            {
+                func.setLinkage(GlobalValue::WeakODRLinkage);
+            }
+        }
+    }
+
+    if (request->runtimeSymbols && SLANG_FAILED(_linkRuntimeBitcode(*module, *request->runtimeSymbols, request->defines, floatingPointMode)))
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to link runtime bitcode");
+        return SLANG_OK;
+    }
+
+    // Done first, so no time is spent on code that isn't used
+    if (!request->exportNames.empty())
+    {
+        _internalizeAllExcept(*module, request->exportNames);
+    }
+
+    switch (llvmOptions.profileMode)
+    {
+        case LLVMCompileOptions::ProfileMode::Instrument:
+        {
+            _instrumentBranches(*module, outBranchProfileLayout);
+            break;
+        }
+        case LLVMCompileOptions::ProfileMode::Use:
+        {
+            _applyBranchProfile(*module, branchProfile);
+            break;
+        }
+        default: break;
+    }
+
+    if (llvmOptions.vectorizeGroups)
+    {
+        _markGroupLoopsForVectorization(*module);
+    }
+
+    if (llvmOptions.multiversionLevels && !specialization)
+    {
+        _multiversionFunctions(*module, llvmOptions.multiversionLevels);
+    }
+
+    if (specialization && SLANG_FAILED(_prepareSpecialization(*module, *specialization)))
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Unable to find the function to specialize");
+        return SLANG_OK;
+    }
+
+    const uint32_t vectorizeWidth = llvmOptions.useTuningConfig ? llvmOptions.tuningConfig.vectorizeWidth : 0;
+    // A specialization is only used by the artifact it was made from, so is never linked. The bitcode of a library is
+    // only linked for inlining, so is fully optimized.
+    const auto pipeline = (llvmOptions.keepBitcode && !specialization && !request->isLibrary) ? OptimizationPipeline::PreLink : OptimizationPipeline::Default;
+
+    // Remarks are only reported whilst optimizing, as the module is generated and checked before
+    const bool reportRemarks = !request->remarksFilter.empty();
+    std::string remarks;
+    raw_string_ostream remarksStream(remarks);
+    std::unique_ptr<DiagnosticHandler> previousHandler;
+    if (reportRemarks)
+    {
+        // Writes the remarks of the passes matching the filter as YAML
+        if (auto err = setupLLVMOptimizationRemarks(*llvmContext, remarksStream, request->remarksFilter, "yaml", false))
+        {
+            consumeError(std::move(err));
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Invalid remarks filter");
+            return SLANG_OK;
+        }
+        previousHandler = llvmContext->getDiagnosticHandler();
+        llvmContext->setDiagnosticHandler(std::make_unique<RemarkDiagnosticHandler>(request->remarksFilter, &diagsBuffer), true);
+    }
+
+    // Reported once the remarks are no longer being written
+    Error optimizeErr = useOwnPipeline ? _optimizeModule(*module, invocation.getCodeGenOpts(), budget, specialization, vectorizeWidth, pipeline, llvmOptions.pipelineProfile, request->passPipeline) : Error::success();
+
+    if (reportRemarks)
+    {
+        llvmContext->setDiagnosticHandler(std::move(previousHandler), true);
+        llvmContext->setLLVMRemarkStreamer(nullptr);
+        llvmContext->setMainRemarkStreamer(nullptr);
+
+        if (outRemarks)
+        {
+            *outRemarks = std::move(remarksStream.str());
+        }
+    }
+
+    if (optimizeErr)
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Invalid pass pipeline", std::move(optimizeErr));
+        return SLANG_OK;
+    }
+
+    if (_shouldStop(budget, diagnostics))
+    {
+        return SLANG_OK;
+    }
+
+    if (llvmOptions.instrumentFunctions && !specialization)
+    {
+        _instrumentFunctionStats(*module);
+    }
+
+    outModule = std::move(module);
+    return SLANG_OK;
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Compile stats !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+void* LLVMCompileStats::getInterface(const Guid& guid)
+{
+    if (guid == ISlangUnknown::getTypeGuid() ||
+        guid == ICastable::getTypeGuid() ||
+        guid == ILLVMCompileStats::getTypeGuid())
+    {
+        return static_cast<ILLVMCompileStats*>(this);
+    }
+    return nullptr;
+}
+
+void* LLVMCompileStats::castAs(const Guid& guid)
+{
+    return getInterface(guid);
+}
+
+SlangResult LLVMCompileStats::getFunctionAt(Index index, LLVMFunctionCompileStats* outStats)
+{
+    if (index < 0 || index >= Index(functions.size()))
+    {
+        return SLANG_E_INVALID_ARG;
+    }
+
+    const FunctionInfo& function = functions[size_t(index)];
+    outStats->name = function.name.c_str();
+    outStats->instructionCount = function.instructionCount;
+    outStats->basicBlockCount = function.basicBlockCount;
+    outStats->loopCount = function.loopCount;
+    outStats->codeSize = function.codeSize;
+    outStats->spillCount = function.spillCount;
+    return SLANG_OK;
+}
+
+SlangResult LLVMCompileStats::getStatisticAt(Index index, LLVMStatistic* outStatistic)
+{
+    if (index < 0 || index >= Index(statistics.size()))
+    {
+        return SLANG_E_INVALID_ARG;
+    }
+
+    const auto& statistic = statistics[size_t(index)];
+    outStatistic->name = statistic.first.c_str();
+    outStatistic->value = statistic.second;
+    return SLANG_OK;
+}
+
+void LLVMCompileStats::addFunction(FunctionInfo&& function)
+{
+    m_functionIndices[function.name] = functions.size();
+    functions.push_back(std::move(function));
+}
+
+LLVMCompileStats::FunctionInfo* LLVMCompileStats::findFunction(StringRef name)
+{
+    auto it = m_functionIndices.find(name);
+    return (it != m_functionIndices.end()) ? &functions[it->second] : nullptr;
+}
+
+// Installed on the LLVMContext whilst code is generated, to count the spills and reloads the register allocator reports
+class SpillRemarkHandler : public DiagnosticHandler
+{
+public:
+    SpillRemarkHandler(LLVMCompileStats* stats):
+        m_stats(stats)
+    {
+    }
+
+    bool handleDiagnostics(const DiagnosticInfo& info) override
+    {
+        auto remark = dyn_cast<DiagnosticInfoOptimizationBase>(&info);
+        if (!remark)
+        {
+            // Let the context handle anything else
+            return false;
+        }
+
+        // LLVM 14 onwards reports the whole function after its loops. Before that only loops are reported, each including
+        // the loops in it, so the largest is used.
+        const StringRef remarkName = remark->getRemarkName();
+        const bool isFunction = (remarkName == "SpillReloadCopies");
+        if (!isFunction && remarkName != "LoopSpillReloadCopies")
+        {
+            return true;
+        }
+
+        uint32_t count = 0;
+        for (const auto& arg : remark->getArgs())
+        {
+            uint32_t value = 0;
+            if ((arg.Key == "NumSpills" || arg.Key == "NumReloads" || arg.Key == "NumFoldedSpills" || arg.Key == "NumFoldedReloads") &&
+                !StringRef(arg.Val).getAsInteger(10, value))
+            {
+                count += value;
+            }
+        }
+
+        if (auto function = m_stats->findFunction(remark->getFunction().getName()))
+        {
+            function->spillCount = isFunction ? count : std::max(function->spillCount, count);
+        }
+        return true;
+    }
+
+    bool isMissedOptRemarkEnabled(StringRef passName) const override { return passName == "regalloc"; }
+    bool isAnyRemarkEnabled() const override { return true; }
+
+protected:
+    LLVMCompileStats* m_stats;
+};
+
+// Only statistics that are registered (when first incremented) whilst enabled are reported
+static void _enableStatistics()
+{
+    static const bool enabled = (EnableStatistics(false), true);
+    SLANG_UNUSED(enabled);
+}
+
+// Gets the values of LLVM's statistics, keyed by "<pass>.<name>". There are none unless LLVM was built with statistics.
+static void _getStatistics(StringMap<uint64_t>& outStatistics)
+{
+    std::string text;
+    raw_string_ostream stream(text);
+    PrintStatisticsJSON(stream);
+    stream.flush();
+
+    auto value = json::parse(text);
+    if (!value)
+    {
+        consumeError(value.takeError());
+        return;
+    }
+
+    if (const json::Object* object = value->getAsObject())
+    {
+        for (const auto& entry : *object)
+        {
+            // Also holds the timers of any timed passes, which are not counts
+            if (auto count = entry.second.getAsInteger())
+            {
+                outStatistics[StringRef(entry.first)] = uint64_t(*count);
+            }
+        }
+    }
+}
+
+// Adds the statistics that have been incremented since before was taken
+static void _addStatistics(const StringMap<uint64_t>& before, LLVMCompileStats* stats)
+{
+    StringMap<uint64_t> after;
+    _getStatistics(after);
+
+    for (const auto& entry : after)
+    {
+        const uint64_t previousValue = before.lookup(entry.getKey());
+        if (entry.getValue() > previousValue)
+        {
+            stats->statistics.push_back(std::make_pair(entry.getKey().str(), entry.getValue() - previousValue));
+        }
+    }
+    std::sort(stats->statistics.begin(), stats->statistics.end());
+}
+
+// Adds the IR stats of each function defined in the module
+static void _addIRStats(llvm::Module& module, LLVMCompileStats* stats)
+{
+    for (Function& func : module)
+    {
+        if (func.isDeclaration())
+        {
+            continue;
+        }
+
+        DominatorTree dominatorTree(func);
+        LoopInfo loopInfo(dominatorTree);
+
+        LLVMCompileStats::FunctionInfo function;
+        function.name = func.getName().str();
+        function.instructionCount = uint32_t(func.getInstructionCount());
+        function.basicBlockCount = uint32_t(func.size());
+        function.loopCount = uint32_t(loopInfo.getLoopsInPreorder().size());
+        stats->addFunction(std::move(function));
+    }
+}
+
+// Sets the code size of each function with stats from the sizes of the symbols in the object file
+static void _addCodeStats(StringRef object, const DataLayout& dataLayout, LLVMCompileStats* stats)
+{
+    auto objectFile = object::ObjectFile::createObjectFile(MemoryBufferRef(object, "object"));
+    if (!objectFile)
+    {
+        consumeError(objectFile.takeError());
+        return;
+    }
+
+    // Symbols may have a prefix (such as '_' on macOS) that isn't part of the function name
+    const char globalPrefix = dataLayout.getGlobalPrefix();
+
+    for (const auto& symbolSize : object::computeSymbolSizes(**objectFile))
+    {
+        const object::SymbolRef& symbol = symbolSize.first;
+
+        auto type = symbol.getType();
+        if (!type || *type != object::SymbolRef::ST_Function)
+        {
+            consumeError(type.takeError());
+            continue;
+        }
+
+        auto nameExpected = symbol.getName();
+        if (!nameExpected)
+        {
+            consumeError(nameExpected.takeError());
+            continue;
+        }
+
+        StringRef name = *nameExpected;
+        if (globalPrefix && name.startswith(StringRef(&globalPrefix, 1)))
+        {
+            name = name.drop_front();
+        }
+
+        if (auto function = stats->findFunction(name))
+        {
+            function->codeSize = uint32_t(symbolSize.second);
+        }
+    }
+}
+
+// Generates code as the JIT's compiler does, adding the stats of the functions of each module compiled
+class StatsIRCompiler : public IRCompileLayer::IRCompiler
+{
+public:
+    typedef IRCompileLayer::IRCompiler Super;
+
+    Expected<std::unique_ptr<MemoryBuffer>> operator()(llvm::Module& module) override
+    {
+        _addIRStats(module, m_stats);
+
+        LLVMContext& llvmContext = module.getContext();
+        std::unique_ptr<DiagnosticHandler> previousHandler = llvmContext.getDiagnosticHandler();
+        llvmContext.setDiagnosticHandler(std::make_unique<SpillRemarkHandler>(m_stats), true);
+
+        auto objectExpected = (*m_compiler)(module);
+
+        llvmContext.setDiagnosticHandler(std::move(previousHandler), true);
+
+        if (objectExpected)
+        {
+            _addCodeStats((*objectExpected)->getBuffer(), module.getDataLayout(), m_stats);
+        }
+        return objectExpected;
+    }
+
+    StatsIRCompiler(std::unique_ptr<IRCompileLayer::IRCompiler> compiler, LLVMCompileStats* stats):
+        Super(compiler->getManglingOptions()),
+        m_compiler(std::move(compiler)),
+        m_stats(stats)
+    {
+    }
+
+protected:
+    std::unique_ptr<IRCompileLayer::IRCompiler> m_compiler;
+    ComPtr<LLVMCompileStats> m_stats;
+};
+
+// Creates the compiler a JIT uses to generate code for targetMachineBuilder, which is the same as LLJIT's own unless
+// stats is set, when the stats of the code it generates are added to stats
+static Expected<std::unique_ptr<IRCompileLayer::IRCompiler>> _createIRCompiler(JITTargetMachineBuilder targetMachineBuilder, LLVMCompileStats* stats)
+{
+    auto targetMachine = targetMachineBuilder.createTargetMachine();
+    if (!targetMachine)
+    {
+        return targetMachine.takeError();
+    }
+
+    std::unique_ptr<IRCompileLayer::IRCompiler> compiler = std::make_unique<TMOwningSimpleCompiler>(std::move(*targetMachine));
+    if (stats)
+    {
+        return std::make_unique<StatsIRCompiler>(std::move(compiler), stats);
+    }
+    return compiler;
+}
+
+// Generates an object file for the module with the compiler a JIT for the host would use. If stats is set the stats of
+// the module's functions are added to it.
+static SlangResult _emitObject(llvm::Module& module, LLVMCompileStats* stats, SmallVectorImpl<char>& outObject)
+{
+    auto targetMachineBuilder = JITTargetMachineBuilder::detectHost();
+    if (!targetMachineBuilder)
+    {
+        consumeError(targetMachineBuilder.takeError());
+        return SLANG_FAIL;
+    }
+
+    auto compiler = _createIRCompiler(std::move(*targetMachineBuilder), stats);
+    if (!compiler)
+    {
+        consumeError(compiler.takeError());
+        return SLANG_FAIL;
+    }
+
+    auto objectExpected = (**compiler)(module);
+    if (!objectExpected)
+    {
+        consumeError(objectExpected.takeError());
+        return SLANG_FAIL;
+    }
+
+    const StringRef object = (*objectExpected)->getBuffer();
+    outObject.assign(object.begin(), object.end());
+    return SLANG_OK;
+}
+
+// Adds the stats to the artifact as an associated artifact
+static void _addCompileStats(IArtifact* artifact, LLVMCompileStats* stats)
+{
+    auto statsArtifact = ArtifactUtil::createArtifact(ArtifactDesc::make(ArtifactKind::Instance, ArtifactPayload::Metadata));
+    statsArtifact->addRepresentation(stats);
+    artifact->addAssociated(statsArtifact);
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Profiler support !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+/* Writes the address, size and name of each function loaded by a JIT to /tmp/perf-<pid>.map, which is where perf looks
+for the symbols of code that isn't in a file. The file is shared by all of the JITs of the process. Entries are never
+removed, so samples may be attributed to a function whose memory has since been reused. */
+class PerfMapListener : public JITEventListener
+{
+public:
+    virtual void notifyObjectLoaded(ObjectKey key, const object::ObjectFile& obj, const RuntimeDyld::LoadedObjectInfo& info) override;
+
+protected:
+    std::mutex m_mutex;
+    std::unique_ptr<raw_fd_ostream> m_stream;           ///< Opened when the first object is loaded
+};
+
+void PerfMapListener::notifyObjectLoaded(ObjectKey key, const object::ObjectFile& obj, const RuntimeDyld::LoadedObjectInfo& info)
+{
+    SLANG_UNUSED(key);
+
+    // Has the addresses the code was loaded at
+    object::OwningBinary<object::ObjectFile> debugObject = info.getObjectForDebug(obj);
+    if (!debugObject.getBinary())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_stream)
+    {
+        const std::string path = "/tmp/perf-" + std::to_string(sys::Process::getProcessId()) + ".map";
+
+        std::error_code errorCode;
+        m_stream = std::make_unique<raw_fd_ostream>(path, errorCode, sys::fs::OF_Append);
+        if (errorCode)
+        {
+            m_stream.reset();
+            return;
+        }
+    }
+
+    for (const auto& symbolSize : object::computeSymbolSizes(*debugObject.getBinary()))
+    {
+        const object::SymbolRef& symbol = symbolSize.first;
+
+        auto type = symbol.getType();
+        if (!type || *type != object::SymbolRef::ST_Function)
+        {
+            consumeError(type.takeError());
+            continue;
+        }
+
+        auto name = symbol.getName();
+        auto address = symbol.getAddress();
+        if (!name || !address)
+        {
+            consumeError(name.takeError());
+            consumeError(address.takeError());
+            continue;
+        }
+
+        *m_stream << format_hex_no_prefix(*address, 1) << " " << format_hex_no_prefix(symbolSize.second, 1) << " " << *name << "\n";
+    }
+
+    // perf may read the file whilst the process is running
+    m_stream->flush();
+}
+
+// Register the listeners that make code loaded by the layer visible to profilers
+static void _registerProfilerListeners(RTDyldObjectLinkingLayer& layer)
+{
+#if SLANG_LINUX_FAMILY
+    // Never freed, as JITs may be destroyed after statics are
+    static PerfMapListener* perfMapListener = new PerfMapListener;
+    layer.registerJITEventListener(*perfMapListener);
+#endif
+
+    // Writes jitdump files, including the line tables. Null unless LLVM was built with LLVM_USE_PERF.
+    if (JITEventListener* perfListener = JITEventListener::createPerfJITEventListener())
+    {
+        layer.registerJITEventListener(*perfListener);
+    }
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! JIT !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+// Get the name of a symbol as seen by the JIT
+static std::string _getMangledName(const char* name, const DataLayout& dataLayout)
+{
+    std::string mangledName;
+    raw_string_ostream stream(mangledName);
+    Mangler::getNameWithPrefix(stream, name, dataLayout);
+    stream.flush();
+    return mangledName;
+}
+
+// Get the data layout of code JIT'd for the host
+static Expected<DataLayout> _getHostDataLayout()
+{
+    auto targetMachineBuilder = JITTargetMachineBuilder::detectHost();
+    if (!targetMachineBuilder)
+    {
+        return targetMachineBuilder.takeError();
+    }
+    return targetMachineBuilder->getDefaultDataLayoutForTarget();
+}
 
-// These are only the functions that cannot be implemented with 'reasonable performance' in the prelude.
-// It is assumed that calling from JIT to C function whilst not super expensive, is an issue. 
+// Get the symbols for the runtime functions made available to JIT'd code. The names are mangled once, as every JIT
+// targets the host and so has the same data layout.
+static const std::vector<RuntimeSymbol>& _getRuntimeSymbols(const DataLayout& dataLayout)
+{
+    static const std::vector<RuntimeSymbol> symbols = [&dataLayout]()
+    {
+        std::vector<RuntimeSymbol> runtimeSymbols;
 
-// name, cppName, retType, paramTypes
-#define SLANG_LLVM_FUNCS(x) \
-    x(F64_ceil, ceil, double, (double)) \
-    x(F64_floor, floor, double, (double)) \
-    x(F64_round, round, double, (double)) \
-    x(F64_abs, fabs, double, (double)) \
-    x(F64_sin, sin, double, (double)) \
-    x(F64_cos, cos, double, (double)) \
-    x(F64_tan, tan, double, (double)) \
-    x(F64_asin, asin, double, (double)) \
-    x(F64_acos, acos, double, (double)) \
-    x(F64_atan, atan, double, (double)) \
-    x(F64_sinh, sinh, double, (double)) \
-    x(F64_cosh, cosh, double, (double)) \
-    x(F64_tanh, tanh, double, (double)) \
-    x(F64_log2, log2, double, (double)) \
-    x(F64_log, log, double, (double)) \
-    x(F64_log10, log10, double, (double)) \
-    x(F64_exp2, exp2, double, (double)) \
-    x(F64_exp, exp, double, (double)) \
-    x(F64_fabs, fabs, double, (double)) \
-    x(F64_trunc, trunc, double, (double)) \
-    x(F64_sqrt, sqrt, double, (double)) \
-    \
-    x(F64_isnan, SLANG_LLVM_STD isnan, bool, (double)) \
-    x(F64_isfinite, SLANG_LLVM_STD isfinite, bool, (double)) \
-    x(F64_isinf, SLANG_LLVM_STD isinf, bool, (double)) \
-    \
-    x(F64_atan2, atan2, double, (double, double)) \
-    \
-    x(F64_frexp, F64_frexp, double, (double, int*)) \
-    x(F64_pow, pow, double, (double, double)) \
-    \
-    x(F64_modf, modf, double, (double, double*)) \
-    x(F64_fmod, fmod, double, (double, double)) \
-    x(F64_remainder, remainder, double, (double, double)) \
-    \
-    x(F32_ceil, ceilf, float, (float)) \
-    x(F32_floor, floorf, float, (float)) \
-    x(F32_round, roundf, float, (float)) \
-    x(F32_abs, fabsf, float, (float)) \
-    x(F32_sin, sinf, float, (float)) \
-    x(F32_cos, cosf, float, (float)) \
-    x(F32_tan, tanf, float, (float)) \
-    x(F32_asin, asinf, float, (float)) \
-    x(F32_acos, acosf, float, (float)) \
-    x(F32_atan, atanf, float, (float)) \
-    x(F32_sinh, sinhf, float, (float)) \
-    x(F32_cosh, coshf, float, (float)) \
-    x(F32_tanh, tanhf, float, (float)) \
-    x(F32_log2, log2f, float, (float)) \
-    x(F32_log, logf, float, (float)) \
-    x(F32_log10, log10f, float, (float)) \
-    x(F32_exp2, exp2f, float, (float)) \
-    x(F32_exp, expf, float, (float)) \
-    x(F32_fabs, fabsf, float, (float)) \
-    x(F32_trunc, truncf, float, (float)) \
-    x(F32_sqrt, sqrtf, float, (float)) \
-    \
-    x(F32_isnan, SLANG_LLVM_STD isnan, bool, (float)) \
-    x(F32_isfinite, SLANG_LLVM_STD isfinite, bool, (float)) \
-    x(F32_isinf, SLANG_LLVM_STD isinf, bool, (float)) \
-    \
-    x(F32_atan2, atan2f, float, (float, float)) \
-    \
-    x(F32_frexp, F32_frexp, float, (float, int*)) \
-    x(F32_pow, powf, float, (float, float)) \
-    \
-    x(F32_modf, modff, float, (float, float*)) \
-    x(F32_fmod, fmodf, float, (float, float)) \
-    x(F32_remainder, remainderf, float, (float, float)) \
-    \
-    x(assertFailed, assertFailed, void, (const char*)) \
-    \
-    x(memcpy, memcpy, void*, (void*, const void*, size_t)) \
-    x(memmove, memmove, void*, (void*, const void*, size_t)) \
-    x(memcmp, memcmp, int, (const void*, const void*, size_t)) \
-    x(memset, memset, void*, (void*, int, size_t)) 
+        auto add = [&](const char* name, NameAndFunc::Func func)
+        {
+            runtimeSymbols.push_back(RuntimeSymbol{ name, _getMangledName(name, dataLayout), func });
+        };
 
-#if SLANG_OSX
-#   define SLANG_PLATFORM_FUNCS(x) \
-    x(memset_pattern4, memset_pattern4, void, (void*, const void*, size_t)) \
-    x(memset_pattern8, memset_pattern8, void, (void*, const void*, size_t)) \
-    x(memset_pattern16, memset_pattern16, void, (void*, const void*, size_t)) \
-    \
-    x(__bzero, OSXSpecific::bzero, void, (void*, size_t))
-#endif
+        static const NameAndFunc funcs[] =
+        {
+            SLANG_LLVM_FUNCS(SLANG_LLVM_FUNC)
+            SLANG_PLATFORM_FUNCS(SLANG_LLVM_FUNC)
+        };
 
-#if SLANG_WINDOWS_FAMILY 
-#   if SLANG_PROCESSOR_X86
-#       define SLANG_PLATFORM_FUNCS(x) \
-            x(_chkstk, _chkstk, void, ()) 
-#   else
-#       define SLANG_PLATFORM_FUNCS(x) \
-            x(__chkstk, __chkstk, void, ()) 
-#   endif
+        for (auto& func : funcs)
+        {
+            add(func.name, func.func);
+        }
+
+#if SLANG_PTR_IS_32 && SLANG_VC
+        {
+            // https://docs.microsoft.com/en-us/windows/win32/devnotes/-win32-alldiv
+            add("_alldiv", NameAndFunc::Func(WinSpecific::_alldiv));
+            add("_allrem", NameAndFunc::Func(WinSpecific::_allrem));
+            add("_aullrem", NameAndFunc::Func(WinSpecific::_aullrem));
+            add("_aulldiv", NameAndFunc::Func(WinSpecific::_aulldiv));
+        }
 #endif
+        return runtimeSymbols;
+    }();
+
+    return symbols;
+}
+
+SlangResult createJIT(bool reduceOptimization, bool profilerSupport, LLVMCompileStats* compileStats, const RuntimeSymbolTable* runtimeSymbols, IArtifactDiagnostics* diagnostics, std::unique_ptr<LLJIT>& outJIT, JITDylib*& outRuntimeLib)
+{
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    {
+        // Create the JIT
+
+        LLJITBuilder jitBuilder;
+
+        if (profilerSupport)
+        {
+            // As the default LLJIT object layer, but with the listeners registered
+            jitBuilder.setObjectLinkingLayerCreator([](ExecutionSession& es, const Triple& triple) -> Expected<std::unique_ptr<ObjectLayer>>
+            {
+                auto layer = std::make_unique<RTDyldObjectLinkingLayer>(es, []() { return std::make_unique<SectionMemoryManager>(); });
+                if (triple.isOSBinFormatCOFF())
+                {
+                    layer->setOverrideObjectFlagsWithResponsibilityFlags(true);
+                    layer->setAutoClaimResponsibilityForObjectSymbols(true);
+                }
+                _registerProfilerListeners(*layer);
+                return std::unique_ptr<ObjectLayer>(std::move(layer));
+            });
+        }
+
+        if (reduceOptimization)
+        {
+            // Generate the code as quickly as possible
+            auto targetMachineBuilder = JITTargetMachineBuilder::detectHost();
+            if (targetMachineBuilder)
+            {
+                targetMachineBuilder->setCodeGenOptLevel(CodeGenOpt::None);
+                jitBuilder.setJITTargetMachineBuilder(std::move(*targetMachineBuilder));
+            }
+            else
+            {
+                // Just use the default
+                consumeError(targetMachineBuilder.takeError());
+            }
+        }
+
+        if (compileStats)
+        {
+            // Passed the target machine builder the JIT uses, so the stats are of the code the JIT runs
+            ComPtr<LLVMCompileStats> stats(compileStats);
+            jitBuilder.setCompileFunctionCreator([stats](JITTargetMachineBuilder targetMachineBuilder)
+            {
+                return _createIRCompiler(std::move(targetMachineBuilder), stats);
+            });
+        }
+
+        Expected<std::unique_ptr< llvm::orc::LLJIT>> expectJit = jitBuilder.create();
+        if (!expectJit)
+        {
+            /* JS: NOTE!
+            
+            It is worth saying there can be some odd issues around creating the JIT - if LLVM-C is linked against.
+            
+            If it is then LLVM will likely startup saying LLVM-C isn't found.
+            BUT if you have LLVM *installed* on your system (as is reasonable to do from a LLVM distro, then
+            at startup it *MIGHT* find a LLVM-C dll in that installation (ie nothing to do with the version of LLVM
+            linked with). This will likely lead to an odd error saying the 'triple can't be found' and that no
+            targets are registered.
+
+            Also note that the behavior *may* be different with Debug/Release - because of how the linked resolves symbols
+            that are multiply defined.
+
+            If there are problems creating the JIT, check that LLVM-C is not linked against (it should be disabled in the premake).
+            */
+
+            auto err = expectJit.takeError();
+
+            std::string jitErrorString;
+            llvm::raw_string_ostream jitErrorStream(jitErrorString);
+
+            jitErrorStream << err;
+
+            StringBuilder buf;
+            buf << "Unable to create JIT engine: " << jitErrorString.c_str();
+
+            // Add the error
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Link, buf.getBuffer());
+            return SLANG_FAIL;
+        }
+        jit = std::move(*expectJit);
+    }
+
+    // Used the following link to test this out
+    // https://www.llvm.org/docs/ORCv2.html
+    // https://www.llvm.org/docs/ORCv2.html#processandlibrarysymbols
+
+    auto& es = jit->getExecutionSession();
+
+    // The name of the lib must be unique. Should be here as we are only thing adding libs
+    auto stdcLibExpected = es.createJITDylib("stdc");
+    if (!stdcLibExpected)
+    {
+        consumeError(stdcLibExpected.takeError());
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to create JIT runtime library");
+        return SLANG_FAIL;
+    }
+
+    auto& stdcLib = *stdcLibExpected;
+
+    // Add all the symbolmap
+    SymbolMap symbolMap;
+    const auto& symbols = runtimeSymbols ? runtimeSymbols->symbols : _getRuntimeSymbols(jit->getDataLayout());
+    for (const auto& symbol : symbols)
+    {
+        symbolMap.insert(std::make_pair(es.intern(symbol.mangledName), JITEvaluatedSymbol::fromPointer(symbol.func)));
+    }
+
+    if (auto err = stdcLib.define(absoluteSymbols(symbolMap)))
+    {
+        consumeError(std::move(err));
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to create JIT runtime library");
+        return SLANG_FAIL;
+    }
+
+    outJIT = std::move(jit);
+    outRuntimeLib = &stdcLib;
+    return SLANG_OK;
+}
+
+SlangResult SharedJIT::createDylib(IArtifactDiagnostics* diagnostics, std::shared_ptr<LLJIT>& outJIT, JITDylib*& outDylib)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_jit)
+    {
+        std::unique_ptr<LLJIT> jit;
+        SLANG_RETURN_ON_FAIL(createJIT(false, false, nullptr, m_runtimeSymbols, diagnostics, jit, m_runtimeLib));
+        m_jit = std::move(jit);
+    }
+
+    // Names must be unique within the JIT
+    std::string name = "compilation" + std::to_string(m_dylibCount++);
+
+    auto dylibExpected = m_jit->createJITDylib(std::move(name));
+    if (!dylibExpected)
+    {
+        consumeError(dylibExpected.takeError());
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to create JIT library");
+        return SLANG_FAIL;
+    }
+
+    JITDylib& dylib = *dylibExpected;
+    // Required or the runtime symbols won't be found
+    dylib.addToLinkOrder(*m_runtimeLib);
+
+    outJIT = m_jit;
+    outDylib = &dylib;
+    return SLANG_OK;
+}
+
+/* Creates an artifact for the request holding a JIT, with the code for the request added by addCode.
+If sharedJIT is set the code is added to a JITDylib of the shared JIT, otherwise a JIT is created just for this artifact.
+If compileStats is set the JIT adds the stats of the IR modules it generates code for to it, so a shared JIT isn't used.
+The library's dispatch runs groups on the threads of dispatchThreadPool. */
+static SlangResult _createJITArtifact(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, IArtifactDiagnostics* diagnostics, bool reduceOptimization, LLVMCompileStats* compileStats, SharedJIT* sharedJIT, DispatchThreadPool* dispatchThreadPool, function_ref<Error(LLJIT& jit, JITDylib& dylib)> addCode, BranchProfileLayout&& branchProfileLayout, ISlangBlob* bitcode, IArtifact** outArtifact)
+{
+    switch (request->targetType)
+    {
+        // TODO(JS): Shared library may not be appropriate, but as long as the 'shared library' is never accessed as a blob
+        // all is good.
+        case SLANG_SHADER_SHARED_LIBRARY:
+
+        // TODO(JS):
+        // Hmm. What does this even mean?
+        // I guess the idea is it's 'SHADER' style, but is runnable on the host. 
+        case SLANG_SHADER_HOST_CALLABLE:
+        {
+            std::shared_ptr<LLJIT> jit;
+            JITDylib* dylib = nullptr;
+
+            // A shared JIT always uses the default code generation settings, and has no profiler support or stats
+            if (sharedJIT && !reduceOptimization && !llvmOptions.profilerSupport && !compileStats)
+            {
+                if (SLANG_FAILED(sharedJIT->createDylib(diagnostics, jit, dylib)))
+                {
+                    return _createFailedArtifact(diagnostics, outArtifact);
+                }
+            }
+            else
+            {
+                std::unique_ptr<LLJIT> ownedJIT;
+                JITDylib* runtimeLib = nullptr;
+                if (SLANG_FAILED(createJIT(reduceOptimization, llvmOptions.profilerSupport, compileStats, request->runtimeSymbols, diagnostics, ownedJIT, runtimeLib)))
+                {
+                    return _createFailedArtifact(diagnostics, outArtifact);
+                }
+
+                // Required or the symbols won't be found
+                dylib = &ownedJIT->getMainJITDylib();
+                dylib->addToLinkOrder(*runtimeLib);
+
+                jit = std::move(ownedJIT);
+            }
+
+            if (auto err = addCode(*jit, *dylib))
+            {
+                _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to add code to JIT", std::move(err));
+                return _createFailedArtifact(diagnostics, outArtifact);
+            }
+
+            if (auto err = jit->initialize(*dylib))
+            {
+                _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to initialize JIT code", std::move(err));
+                return _createFailedArtifact(diagnostics, outArtifact);
+            }
+
+            // Select the variants of multiversioned code, however it was added. The code (such as that produced by
+            // linking) may be multiversioned without the options asking for it, so it's always looked for. The lookup is
+            // weak, as the function is only defined if something was multiversioned.
+            {
+                const auto initName = jit->mangleAndIntern(kMultiversionInitName);
+                SymbolLookupSet symbols(initName, SymbolLookupFlags::WeaklyReferencedSymbol);
+                auto initExpected = jit->getExecutionSession().lookup(makeJITDylibSearchOrder(dylib), std::move(symbols));
+                if (!initExpected)
+                {
+                    _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to initialize multiversioned code", initExpected.takeError());
+                    return _createFailedArtifact(diagnostics, outArtifact);
+                }
+                auto found = initExpected->find(initName);
+                if (found != initExpected->end())
+                {
+                    ((void (*)())found->second.getAddress())();
+                }
+            }
+
+            const uint64_t* branchCounters = nullptr;
+            if (llvmOptions.profileMode == LLVMCompileOptions::ProfileMode::Instrument)
+            {
+                auto countersExpected = jit->lookup(*dylib, kBranchCountersName);
+                if (!countersExpected)
+                {
+                    _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to find branch counters", countersExpected.takeError());
+                    return _createFailedArtifact(diagnostics, outArtifact);
+                }
+                branchCounters = (const uint64_t*)countersExpected->getAddress();
+            }
+
+            LLVMFunctionStats* functionStats = nullptr;
+            Count functionStatsCount = 0;
+            if (llvmOptions.instrumentFunctions)
+            {
+                auto statsExpected = jit->lookup(*dylib, kFunctionStatsName);
+                if (!statsExpected)
+                {
+                    _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to find function stats", statsExpected.takeError());
+                    return _createFailedArtifact(diagnostics, outArtifact);
+                }
+                auto countExpected = jit->lookup(*dylib, kFunctionStatsCountName);
+                if (!countExpected)
+                {
+                    _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to find function stats", countExpected.takeError());
+                    return _createFailedArtifact(diagnostics, outArtifact);
+                }
+                functionStats = (LLVMFunctionStats*)statsExpected->getAddress();
+                functionStatsCount = Count(*(const uint64_t*)countExpected->getAddress());
+            }
+
+            // Create the shared library
+            ComPtr<LLVMJITSharedLibrary> sharedLibrary(new LLVMJITSharedLibrary(std::move(jit), dylib, request));
+            sharedLibrary->setFunctionStats(functionStats, functionStatsCount);
+            sharedLibrary->setDispatchThreadPool(dispatchThreadPool);
+            sharedLibrary->setBitcode(bitcode);
+            sharedLibrary->setCompileOptions(llvmOptions);
+
+            if (branchCounters)
+            {
+                sharedLibrary->setBranchProfile(std::move(branchProfileLayout), branchCounters);
+            }
+
+            // Work out the ArtifactDesc 
+            const auto targetDesc = ArtifactDescUtil::makeDescForCompileTarget(request->targetType);
+
+            auto artifact = ArtifactUtil::createArtifact(targetDesc);
+            ArtifactUtil::addAssociated(artifact, diagnostics);
+
+            artifact->addRepresentation(sharedLibrary);
+
+            *outArtifact = artifact.detach();
+            return SLANG_OK;
+        }
+    }
+
+    return SLANG_FAIL;
+}
+
+// Returns the first variable internal to module that is used, or nullptr if there isn't one
+static const GlobalVariable* _findUsedInternalVariable(const llvm::Module& module)
+{
+    for (const GlobalVariable& variable : module.globals())
+    {
+        if (variable.hasLocalLinkage() && !variable.isConstant() && !variable.use_empty())
+        {
+            return &variable;
+        }
+    }
+    return nullptr;
+}
+
+// Compiles the specialization of the function from the request, adding the code to a new JITDylib in jit that links
+// against libraryDylib (and so everything it links against). Errors are added to diagnostics.
+static SlangResult _compileSpecialization(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const FunctionSpecialization& specialization, LLJIT& jit, JITDylib& libraryDylib, IArtifactDiagnostics* diagnostics, void*& outFunc)
+{
+    CompileBudget budget;
+
+    std::unique_ptr<LLVMContext> llvmContext = std::make_unique<LLVMContext>();
+    std::unique_ptr<llvm::Module> module;
+    BranchProfileLayout branchProfileLayout;
 
-#ifndef SLANG_PLATFORM_FUNCS
-#   define SLANG_PLATFORM_FUNCS(x)
-#endif
+    SLANG_RETURN_ON_FAIL(_compileModule(request, llvmOptions, &specialization, budget, diagnostics, llvmContext.get(), module, branchProfileLayout, nullptr));
+    if (!module)
+    {
+        if (!_hasError(diagnostics))
+        {
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Unable to compile the specialization");
+        }
+        return SLANG_FAIL;
+    }
 
-static int _getOptimizationLevel(DownstreamCompileOptions::OptimizationLevel level)
-{
-    typedef DownstreamCompileOptions::OptimizationLevel OptimizationLevel;
-    switch (level)
+    if (const GlobalVariable* variable = _findUsedInternalVariable(*module))
     {
-        case OptimizationLevel::None:     return 0;
-        default:
-        case OptimizationLevel::Default:  return 1;
-        case OptimizationLevel::High:     return 2;
-        case OptimizationLevel::Maximal:  return 3;
+        const std::string text = "Unable to specialize, as the function uses '" + variable->getName().str() + "', which is internal to the library";
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, text.c_str());
+        return SLANG_FAIL;
     }
-}
 
-static SlangResult _initLLVM()
-{
-    // Initialize targets first, so that --version shows registered targets.
-#if 0
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmPrinters();
-    llvm::InitializeAllAsmParsers();
-#else
-    // Just initialize items needed for this target.
+    // Names must be unique within the JIT, which may be shared
+    static std::atomic<uint64_t> specializationCount{ 0 };
+    auto dylibExpected = jit.createJITDylib("specialization" + std::to_string(specializationCount++));
+    if (!dylibExpected)
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to create JITDylib", dylibExpected.takeError());
+        return SLANG_FAIL;
+    }
+    JITDylib& dylib = *dylibExpected;
 
-    llvm::InitializeNativeTarget();
-    llvm::InitializeNativeTargetAsmPrinter();
-    llvm::InitializeNativeTargetAsmParser();
+    // The library comes first, so the variables resolve to those it defines
+    libraryDylib.withLinkOrderDo([&](const JITDylibSearchOrder& libraryLinkOrder)
+    {
+        JITDylibSearchOrder linkOrder;
+        linkOrder.push_back(std::make_pair(&libraryDylib, JITDylibLookupFlags::MatchExportedSymbolsOnly));
+        linkOrder.insert(linkOrder.end(), libraryLinkOrder.begin(), libraryLinkOrder.end());
+        dylib.setLinkOrder(std::move(linkOrder));
+    });
 
-    llvm::InitializeNativeTargetDisassembler();
-#endif
+    if (auto err = jit.addIRModule(dylib, ThreadSafeModule(std::move(module), std::move(llvmContext))))
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to add code to JIT", std::move(err));
+        return SLANG_FAIL;
+    }
+    if (auto err = jit.initialize(dylib))
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to initialize JIT code", std::move(err));
+        return SLANG_FAIL;
+    }
 
-    // Set an error handler, so that any LLVM backend diagnostics go through our
-    // error handler.
-    //llvm::install_fatal_error_handler(_llvmErrorHandler, static_cast<void*>(&clang->getDiagnostics()));
-    // NOTE! Can only be set once.
-    llvm::install_fatal_error_handler(_llvmErrorHandler, nullptr);
+    auto funcExpected = jit.lookup(dylib, specialization.functionName);
+    if (!funcExpected)
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to find the specialized function", funcExpected.takeError());
+        return SLANG_FAIL;
+    }
 
+    outFunc = (void*)funcExpected->getAddress();
     return SLANG_OK;
 }
 
-
-bool LLVMDownstreamCompiler::canConvert(const ArtifactDesc& from, const ArtifactDesc& to)
+SlangResult LLVMJITSharedLibrary::specialize(const char* name, const LLVMSpecializationValue* values, Count valueCount, void** outFunc, IArtifactDiagnostics** outDiagnostics)
 {
-    return false;
-}
+    if (outDiagnostics)
+    {
+        *outDiagnostics = nullptr;
+    }
+    if (!name || (valueCount > 0 && !values))
+    {
+        return SLANG_E_INVALID_ARG;
+    }
 
-SlangResult LLVMDownstreamCompiler::convert(IArtifact* from, const ArtifactDesc& to, IArtifact** outArtifact)
-{
-    return SLANG_E_NOT_IMPLEMENTED;
-}
+    // Linked code has no source to compile a specialization from
+    if (!m_request->sourceBlob)
+    {
+        return SLANG_E_NOT_AVAILABLE;
+    }
 
-SlangResult LLVMDownstreamCompiler::getVersionString(slang::IBlob** outVersionString)
-{
-    StringBuilder versionString;
-    // Append the version
-    m_desc.version.append(versionString);
+    FunctionSpecialization specialization;
+    specialization.functionName = name;
+    for (Index i = 0; i < valueCount; ++i)
+    {
+        const auto& value = values[i];
+        specialization.values.push_back(FunctionSpecialization::BoundValue{ value.parameterIndex, value.offset, std::string((const char*)value.data, value.size) });
+    }
 
-    // Really we should have a hash to identify the specific version.
-    // For now we'll fall back to just using the timestamp
+    const std::string key = specialization.getKey();
+    {
+        std::lock_guard<std::mutex> lock(m_specializationsMutex);
+        auto it = m_specializations.find(key);
+        if (it != m_specializations.end())
+        {
+            *outFunc = it->second;
+            return SLANG_OK;
+        }
+    }
 
+    // Compiled outside of the lock, so specializations can be compiled concurrently
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
+    void* func = nullptr;
+    const SlangResult res = _compileSpecialization(m_request, _getSpecializationOptions(m_llvmOptions), specialization, *m_jit, *m_dylib, diagnostics, func);
+    if (outDiagnostics)
     {
-        // If we don't have the commitHash, we use the library timestamp, to uniquely identify.
-        versionString << " " << SharedLibraryUtils::getSharedLibraryTimestamp((void*)createLLVMDownstreamCompiler_V4);
+        *outDiagnostics = diagnostics.detach();
     }
+    SLANG_RETURN_ON_FAIL(res);
 
-    *outVersionString = StringBlob::moveCreate(versionString).detach();
+    std::lock_guard<std::mutex> lock(m_specializationsMutex);
+    // If another thread compiled the same specialization at the same time, use the first one
+    *outFunc = m_specializations.try_emplace(key, func).first->second;
     return SLANG_OK;
 }
 
-void* LLVMDownstreamCompiler::castAs(const Guid& guid)
+// Get the module as bitcode
+static ComPtr<ISlangBlob> _writeBitcode(const llvm::Module& module)
 {
-    if (auto ptr = getInterface(guid))
+    SmallVector<char, 0> bitcode;
+    raw_svector_ostream stream(bitcode);
+    WriteBitcodeToFile(module, stream);
+    return RawBlob::create(bitcode.data(), bitcode.size());
+}
+
+// Checks the source is valid without generating any code, outputting an artifact that only holds the diagnostics
+static SlangResult _validate(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, IArtifact** outArtifact)
+{
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
+
+    LLVMContext llvmContext;
+    std::unique_ptr<llvm::Module> module;
+    BranchProfileLayout branchProfileLayout;
+    SLANG_RETURN_ON_FAIL(_compileModule(request, llvmOptions, nullptr, budget, diagnostics, &llvmContext, module, branchProfileLayout, nullptr));
+
+    if (_hasError(diagnostics))
     {
-        return ptr;
+        return _createFailedArtifact(diagnostics, outArtifact);
     }
-    return getObject(guid);
+    return _createDiagnosticsArtifact(diagnostics, outArtifact);
 }
 
-void* LLVMDownstreamCompiler::getInterface(const Guid& guid)
+// Gets the names of the symbols module defines that can be looked up
+static void _getDefinedSymbolNames(const llvm::Module& module, std::vector<std::string>& outNames)
 {
-    if (guid == ISlangUnknown::getTypeGuid() ||
-        guid == ICastable::getTypeGuid() ||
-        guid == IDownstreamCompiler::getTypeGuid())
+    for (const GlobalValue& globalValue : module.global_values())
     {
-        return static_cast<IDownstreamCompiler*>(this);
+        if (!globalValue.isDeclaration() && !globalValue.hasLocalLinkage())
+        {
+            outNames.push_back(globalValue.getName().str());
+        }
     }
-    return nullptr;
 }
 
-void* LLVMDownstreamCompiler::getObject(const Guid& guid)
+// The JIT generates the code of a module when one of its symbols is first looked up. Looking up all of the names
+// (those from _getDefinedSymbolNames) generates it now.
+static Error _materializeSymbols(LLJIT& jit, JITDylib& dylib, const std::vector<std::string>& names)
 {
-    SLANG_UNUSED(guid);
-    return nullptr;
+    SymbolLookupSet symbols;
+    for (const auto& name : names)
+    {
+        // Weak, as a symbol can be removed by optimization after the names are taken
+        symbols.add(jit.mangleAndIntern(name), SymbolLookupFlags::WeaklyReferencedSymbol);
+    }
+    return jit.getExecutionSession().lookup(makeJITDylibSearchOrder(&dylib), std::move(symbols)).takeError();
 }
 
-SlangResult LLVMDownstreamCompiler::compile(const CompileOptions& inOptions, IArtifact** outArtifact)
+SlangResult LLVMDownstreamCompiler::_compile(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, SharedJIT* sharedJIT, IArtifact** outArtifact)
 {
-    if (!isVersionCompatible(inOptions))
+    if (llvmOptions.useAutotunedConfig && !llvmOptions.useTuningConfig)
     {
-        // Not possible to compile with this version of the interface.
-        return SLANG_E_NOT_IMPLEMENTED;
+        // If the source has been autotuned, compile with the configuration that was found
+        LLVMTuningConfig tuningConfig;
+        if (_findTuningConfig(request, llvmOptions, tuningConfig))
+        {
+            // Precise was asked for, so must not be replaced whatever was fastest
+            if (request->floatingPointMode == DownstreamCompileOptions::FloatingPointMode::Precise)
+            {
+                tuningConfig.floatingPointMode = DownstreamCompileOptions::FloatingPointMode::Precise;
+            }
+
+            LLVMCompileOptions tunedOptions = llvmOptions;
+            tunedOptions.useTuningConfig = true;
+            tunedOptions.tuningConfig = tuningConfig;
+            return _compile(request, tunedOptions, budget, sharedJIT, outArtifact);
+        }
     }
 
-    CompileOptions options = getCompatibleVersion(&inOptions);
+    if (llvmOptions.syntaxOnly)
+    {
+        return _validate(request, llvmOptions, budget, outArtifact);
+    }
 
-    // Currently supports single source file
-    if (options.sourceArtifacts.count != 1)
+    if (llvmOptions.compileOutOfProcess)
     {
-        return SLANG_FAIL;
+        return _compileOutOfProcess(request, llvmOptions, budget, sharedJIT, outArtifact);
     }
-    IArtifact* sourceArtifact = options.sourceArtifacts[0];
 
-    _ensureSufficientStack();
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
 
-    static const SlangResult initLLVMResult = _initLLVM();
-    SLANG_RETURN_ON_FAIL(initLLVMResult);
+    std::unique_ptr<LLVMContext> llvmContext = std::make_unique<LLVMContext>();
+    std::unique_ptr<llvm::Module> module;
+    BranchProfileLayout branchProfileLayout;
+    std::string remarks;
 
-    std::unique_ptr<CompilerInstance> clang(new CompilerInstance());
-    IntrusiveRefCntPtr<DiagnosticIDs> diagID(new DiagnosticIDs());
+    ComPtr<LLVMCompileStats> compileStats;
+    StringMap<uint64_t> statisticsBefore;
+    if (llvmOptions.compileStats)
+    {
+        compileStats = new LLVMCompileStats;
+        _enableStatistics();
+        _getStatistics(statisticsBefore);
+    }
 
-    // Register the support for object-file-wrapped Clang modules.
-    auto pchOps = clang->getPCHContainerOperations();
-    pchOps->registerWriter(std::make_unique<ObjectFilePCHContainerWriter>());
-    pchOps->registerReader(std::make_unique<ObjectFilePCHContainerReader>());
+    SLANG_RETURN_ON_FAIL(_compileModule(request, llvmOptions, nullptr, budget, diagnostics, llvmContext.get(), module, branchProfileLayout, &remarks));
+    if (!module)
+    {
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-    IntrusiveRefCntPtr<DiagnosticOptions> diagOpts = new DiagnosticOptions();
+    // If we are here and out of time, the action must be to reduce optimization
+    const bool reduceOptimization = budget.isExpired();
+    if (reduceOptimization)
+    {
+        ArtifactDiagnostic diagnostic;
+        diagnostic.severity = ArtifactDiagnostic::Severity::Warning;
+        diagnostic.stage = ArtifactDiagnostic::Stage::Compile;
+        diagnostic.text = TerminatedCharSlice("Compilation exceeded its time budget, optimization was reduced");
+        diagnostics->add(diagnostic);
+    }
 
-    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
+    // Kept before the module is handed to the JIT
+    ComPtr<ISlangBlob> bitcode;
+    if (llvmOptions.keepBitcode || llvmOptions.keepRepresentations)
+    {
+        bitcode = _writeBitcode(*module);
+    }
 
-    
-    // TODO(JS): We might just want this to talk directly to the listener.
-    // For now we just buffer up. 
-    BufferedDiagnosticConsumer diagsBuffer(diagnostics);
+    // Done after keeping the bitcode, such that it still holds the functions taken from the module
+    // If the compilation fails, the functions are released with sharedFunctions
+    RefPtr<SharedFunctions> sharedFunctions;
+    std::vector<std::pair<std::string, void*>> sharedSymbols;
+    if (llvmOptions.shareFunctions || llvmOptions.incremental)
+    {
+        RefPtr<FunctionStore> functionStore = _getFunctionStore(request->runtimeSymbols);
+        if (SLANG_FAILED(functionStore->shareFunctions(*module, llvmOptions.incremental, sharedSymbols, sharedFunctions)))
+        {
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to share functions");
+            return _createFailedArtifact(diagnostics, outArtifact);
+        }
+    }
 
-    IntrusiveRefCntPtr<DiagnosticsEngine> diags = new DiagnosticsEngine(diagID, diagOpts, &diagsBuffer, false);
+    // If the compilation has a budget the code is generated before the budget is checked for the last time, rather
+    // than when the code is first used. The code size and spills are only known once code is generated, so stats also
+    // need the code to be generated now.
+    std::vector<std::string> definedNames;
+    if (budget.hasLimit() || compileStats)
+    {
+        _getDefinedSymbolNames(*module, definedNames);
+    }
 
-    ComPtr<ISlangBlob> sourceBlob;
-    SLANG_RETURN_ON_FAIL(sourceArtifact->loadBlob(ArtifactKeep::Yes, sourceBlob.writeRef()));
+    auto addModule = [&](LLJIT& jit, JITDylib& dylib) -> Error
+    {
+        if (sharedSymbols.size())
+        {
+            SymbolMap symbolMap;
+            for (const auto& symbol : sharedSymbols)
+            {
+                symbolMap.insert(std::make_pair(jit.mangleAndIntern(symbol.first), JITEvaluatedSymbol::fromPointer(symbol.second)));
+            }
+            if (auto err = dylib.define(absoluteSymbols(symbolMap)))
+            {
+                return err;
+            }
+        }
+        if (auto err = jit.addIRModule(dylib, ThreadSafeModule(std::move(module), std::move(llvmContext))))
+        {
+            return err;
+        }
+        return definedNames.size() ? _materializeSymbols(jit, dylib, definedNames) : Error::success();
+    };
 
-    const auto sourceSlice = StringUtil::getSlice(sourceBlob);
-    StringRef sourceStringRef(sourceSlice.begin(), sourceSlice.getLength());
+    SLANG_RETURN_ON_FAIL(_createJITArtifact(request, llvmOptions, diagnostics, reduceOptimization, compileStats, sharedJIT, m_dispatchThreadPool, addModule, std::move(branchProfileLayout), bitcode, outArtifact));
 
-    auto sourceBuffer = llvm::MemoryBuffer::getMemBuffer(sourceStringRef);
+    // Code generation can't be interrupted, so all that can be done is to fail if it went over budget
+    if (budget.hasLimit() && _shouldStop(budget, diagnostics))
+    {
+        (*outArtifact)->release();
+        *outArtifact = nullptr;
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-    auto& invocation = clang->getInvocation();
+    if (compileStats)
+    {
+        _addStatistics(statisticsBefore, compileStats);
+        _addCompileStats(*outArtifact, compileStats);
+    }
 
-    std::string verboseOutputString;
+    if (LLVMJITSharedLibrary* sharedLibrary = LLVMJITSharedLibrary::getFromArtifact(*outArtifact))
+    {
+        // The code calls functions in the store, so the library keeps them (and the store) alive
+        sharedLibrary->setSharedFunctions(sharedFunctions);
 
-    // Capture all of the verbose output into a buffer, so not writen to stdout
-    clang->setVerboseOutputStream(std::make_unique<llvm::raw_string_ostream>(verboseOutputString));
+        if (request->remarksFilter.size())
+        {
+            sharedLibrary->setRemarks(RawBlob::create(remarks.data(), remarks.size()));
+        }
+    }
+    return SLANG_OK;
+}
 
-    SmallVector<char> output;
-    clang->setOutputStream(std::make_unique<llvm::raw_svector_ostream>(output));
+/* !!!!!!!!!!!!!!!!!!!!! Function store !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-    frontend::ActionKind action = frontend::ActionKind::EmitLLVMOnly;
+RefPtr<FunctionStore> LLVMDownstreamCompiler::_getFunctionStore(RuntimeSymbolTable* runtimeSymbols)
+{
+    std::lock_guard<std::mutex> lock(m_functionStoreMutex);
 
-    // EmitCodeGenOnly doesn't appear to actually emit anything
-    // EmitLLVM outputs LLVM assembly
-    // EmitLLVMOnly doesn't 'emit' anything, but the IR that is produced is accessible, from the 'action'.
+    // Stored functions may call runtime functions, so can only be shared by compilations with the same runtime symbols.
+    // The previous store is freed with the last library that uses it.
+    if (!m_functionStore || m_functionStore->getRuntimeSymbols() != runtimeSymbols)
+    {
+        m_functionStore = new FunctionStore(runtimeSymbols);
+    }
+    return m_functionStore;
+}
 
-    action = frontend::ActionKind::EmitLLVMOnly;
+/* !!!!!!!!!!!!!!!!!!!!! Link time optimization !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-    //action = frontend::ActionKind::EmitBC;
-    //action = frontend::ActionKind::EmitLLVM;
-    // 
-    //action = frontend::ActionKind::EmitCodeGenOnly;
-    //action = frontend::ActionKind::EmitObj;
-    //action = frontend::ActionKind::EmitAssembly;
+/* Artifacts compiled with keepBitcode hold their module after the pre-link optimization pipeline, which leaves
+optimizations that benefit from seeing the whole program (such as inlining across modules) until link time. Linking
+combines the modules into one, internalizes everything that doesn't need to be exported, and runs the full LTO
+pipeline over the merged module, which inlines across the original modules and removes whatever is no longer used.
+This is full rather than ThinLTO: there are no module summaries or function importing, as every module is already in
+the process. */
 
-    Language language;
-    LangStandard::Kind langStd;
-    switch (options.sourceLanguage)
+SlangResult LLVMDownstreamCompiler::link(const LLVMLinkDesc& desc, IArtifact** outArtifact)
+{
+    if (desc.artifactCount <= 0 || !desc.artifacts || (desc.exportNameCount > 0 && !desc.exportNames))
     {
-        case SLANG_SOURCE_LANGUAGE_CPP:
-        {
-            language = Language::CXX;
-            langStd = LangStandard::Kind::lang_cxx17;
-            break;
-        }
-        case SLANG_SOURCE_LANGUAGE_C:
-        {
-            language = Language::C;
-            langStd = LangStandard::Kind::lang_c17;
-            break;
-        }
-        default:
+        return SLANG_E_INVALID_ARG;
+    }
+
+    // Check everything can be linked before doing any work
+    std::vector<LLVMJITSharedLibrary*> libraries;
+    for (Index i = 0; i < desc.artifactCount; ++i)
+    {
+        LLVMJITSharedLibrary* library = LLVMJITSharedLibrary::getFromArtifact(desc.artifacts[i]);
+        if (!library || !library->getBitcode())
         {
-            return SLANG_E_NOT_AVAILABLE;
+            return SLANG_E_INVALID_ARG;
         }
+        libraries.push_back(library);
     }
 
-    const InputKind inputKind(language, InputKind::Format::Source);
+    SLANG_RETURN_ON_FAIL(_ensureLLVMInitialized());
 
-    {
-        auto& opts = invocation.getFrontendOpts();
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
 
-        // Add the source
-        // TODO(JS): For the moment this kind of include does *NOT* show a input source filename
-        // not super surprising as one isn't set, but it's not clear how one would be set when the input is a memory buffer.
-        // For Slang usage, this probably isn't an issue, because it's *output* typically holds #line directives.
-        {
-            
-            FrontendInputFile inputFile(*sourceBuffer, inputKind);
-            opts.Inputs.push_back(inputFile);
-        }
+    std::unique_ptr<LLVMContext> llvmContext = std::make_unique<LLVMContext>();
+    // Takes the target and data layout of the first module linked into it
+    std::unique_ptr<llvm::Module> module = std::make_unique<llvm::Module>("linked", *llvmContext);
 
-        opts.ProgramAction = action;
-    }
+    // Optimize as much as the most optimized artifact was
+    auto optimizationLevel = DownstreamCompileOptions::OptimizationLevel::None;
 
+    Linker linker(*module);
+    int multiversionInitCount = 0;
+    for (LLVMJITSharedLibrary* library : libraries)
     {
-        auto& opts = invocation.getPreprocessorOpts();
+        ISlangBlob* bitcode = library->getBitcode();
+        const StringRef bitcodeData((const char*)bitcode->getBufferPointer(), bitcode->getBufferSize());
 
-        // Add definition so that 'LLVM/Clang' compilations can be recognized
-        opts.addMacroDef("SLANG_LLVM");
+        auto srcExpected = parseBitcodeFile(MemoryBufferRef(bitcodeData, "artifact bitcode"), *llvmContext);
+        if (!srcExpected)
+        {
+            consumeError(srcExpected.takeError());
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to read the bitcode of an artifact");
+            return _createFailedArtifact(diagnostics, outArtifact);
+        }
 
-        for (const auto& define : options.defines)
+        // Each multiversioned artifact has its own init function, which are all called by one for the linked module
+        if (llvm::Function* initFunc = (*srcExpected)->getFunction(kMultiversionInitName))
         {
-            const Index index = asStringSlice(define.nameWithSig).indexOf('(');
-            if (index >= 0)
-            {
-                // Interface does not support having a signature.
-                return SLANG_E_NOT_AVAILABLE;
-            }
+            initFunc->setName(std::string(kMultiversionInitName) + "." + std::to_string(multiversionInitCount++));
+        }
 
-            // TODO(JS): NOTE! The options do not support setting a *value* just that a macro is defined.
-            // So strictly speaking, we should probably have a warning/error if the value is not appropriate
-            opts.addMacroDef(define.nameWithSig.begin());
+        // Returns true on failure, such as if a symbol is defined by more than one artifact
+        if (linker.linkInModule(std::move(*srcExpected)))
+        {
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to link the artifacts");
+            return _createFailedArtifact(diagnostics, outArtifact);
         }
+
+        optimizationLevel = std::max(optimizationLevel, library->getCompileRequest()->optimizationLevel);
     }
 
+    if (multiversionInitCount > 0)
+    {
+        _combineMultiversionInits(*module, multiversionInitCount);
+    }
 
-    llvm::Triple targetTriple;
+    if (desc.exportNameCount > 0)
     {
-        auto& opts = invocation.getTargetOpts();
+        StringSet<> exportNames;
+        for (Index i = 0; i < desc.exportNameCount; ++i)
+        {
+            exportNames.insert(desc.exportNames[i]);
+        }
+        if (multiversionInitCount > 0)
+        {
+            exportNames.insert(kMultiversionInitName);
+        }
 
-        opts.Triple = LLVM_DEFAULT_TARGET_TRIPLE;
+        _internalizeAllExcept(*module, exportNames);
+    }
 
-        // A code model isn't set by default, "default" seems to fit the bill here 
-        opts.CodeModel = "default";
+    CodeGenOptions codeGenOpts;
+    codeGenOpts.OptimizationLevel = _getOptimizationLevel(optimizationLevel);
 
-        targetTriple = llvm::Triple(opts.Triple);
+    CompileBudget budget;
+    if (auto err = _optimizeModule(*module, codeGenOpts, budget, nullptr, 0, OptimizationPipeline::Link, LLVMCompileOptions::PipelineProfile::Default, StringRef()))
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to optimize the linked module", std::move(err));
+        return _createFailedArtifact(diagnostics, outArtifact);
     }
 
+    // The linked code has no source, so can only be used as is
+    RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+    request->optimizationLevel = optimizationLevel;
+    request->targetType = libraries[0]->getCompileRequest()->targetType;
+    request->runtimeSymbols = _getRuntimeSymbolTable();
+
+    auto addModule = [&](LLJIT& jit, JITDylib& dylib) -> Error
     {
-        auto opts = invocation.getLangOpts();
+        return jit.addIRModule(dylib, ThreadSafeModule(std::move(module), std::move(llvmContext)));
+    };
 
-        std::vector<std::string> includes;
-        for (const auto& includePath : options.includePaths)
-        {
-            includes.push_back(includePath.begin());
-        }
+    const LLVMCompileOptions llvmOptions;
+    return _createJITArtifact(request, llvmOptions, diagnostics, false, nullptr, nullptr, m_dispatchThreadPool, addModule, BranchProfileLayout(), nullptr, outArtifact);
+}
 
-        clang::CompilerInvocation::setLangDefaults(*opts, inputKind, targetTriple, includes, langStd);
+/* !!!!!!!!!!!!!!!!!!!!! Runtime symbol registration !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-        if (options.floatingPointMode == DownstreamCompileOptions::FloatingPointMode::Fast)
+// Create a table holding the contents of table, or just the built in runtime functions if table is null
+static RefPtr<RuntimeSymbolTable> _cloneRuntimeSymbolTable(const RuntimeSymbolTable* table, const DataLayout& dataLayout)
+{
+    RefPtr<RuntimeSymbolTable> clone(new RuntimeSymbolTable);
+    if (table)
+    {
+        clone->symbols = table->symbols;
+        clone->symbolNames = table->symbolNames;
+        clone->bitcodeModules = table->bitcodeModules;
+        clone->libraries = table->libraries;
+    }
+    else
+    {
+        clone->symbols = _getRuntimeSymbols(dataLayout);
+        for (const auto& symbol : clone->symbols)
         {
-            opts->FastMath = true;
+            clone->symbolNames.insert(symbol.name);
         }
     }
+    return clone;
+}
+
+// Add the symbol to table, replacing any symbol with the same name
+static void _addRuntimeSymbol(RuntimeSymbolTable& table, const char* name, void* address, const DataLayout& dataLayout)
+{
+    const auto func = reinterpret_cast<RuntimeSymbol::Func>(address);
+    std::string mangledName = _getMangledName(name, dataLayout);
 
+    auto it = std::find_if(table.symbols.begin(), table.symbols.end(), [&](const RuntimeSymbol& symbol) { return symbol.mangledName == mangledName; });
+    if (it != table.symbols.end())
     {
-        auto& opts = invocation.getHeaderSearchOpts();
+        it->func = func;
+    }
+    else
+    {
+        table.symbols.push_back(RuntimeSymbol{ name, std::move(mangledName), func });
+        table.symbolNames.insert(name);
+    }
+}
 
-        // These only work if the resource directory is setup (or a virtual file system points to it)
-        opts.UseBuiltinIncludes = true;
-        opts.UseStandardSystemIncludes = true;
-        opts.UseStandardCXXIncludes = true;
+RefPtr<RuntimeSymbolTable> LLVMDownstreamCompiler::_getRuntimeSymbolTable()
+{
+    std::lock_guard<std::mutex> lock(m_runtimeSymbolsMutex);
+    return m_runtimeSymbols;
+}
 
-        /// Use libc++ instead of the default libstdc++.
-        //opts.UseLibcxx = true;
+SlangResult LLVMDownstreamCompiler::registerSymbol(const char* name, void* address)
+{
+    if (!name || name[0] == 0 || !address)
+    {
+        return SLANG_E_INVALID_ARG;
     }
 
+    SLANG_RETURN_ON_FAIL(_ensureLLVMInitialized());
 
+    auto dataLayout = _getHostDataLayout();
+    if (!dataLayout)
     {
-        auto& opts = invocation.getCodeGenOpts();
+        consumeError(dataLayout.takeError());
+        return SLANG_FAIL;
+    }
 
-        // Set to -O optimization level
-        opts.OptimizationLevel = _getOptimizationLevel(options.optimizationLevel);
+    std::lock_guard<std::mutex> lock(m_runtimeSymbolsMutex);
 
-        // Copy over the targets CodeModel
-        opts.CodeModel = invocation.getTargetOpts().CodeModel;
+    // The current table may be in use by compilations, so register in a copy
+    RefPtr<RuntimeSymbolTable> table = _cloneRuntimeSymbolTable(m_runtimeSymbols, *dataLayout);
+    _addRuntimeSymbol(*table, name, address, *dataLayout);
+
+    m_runtimeSymbols = table;
+    return SLANG_OK;
+}
+
+SlangResult LLVMDownstreamCompiler::registerBitcode(ISlangBlob* bitcode)
+{
+    if (!bitcode)
+    {
+        return SLANG_E_INVALID_ARG;
     }
 
-    //const llvm::opt::OptTable& opts = clang::driver::getDriverOptTable();
+    SLANG_RETURN_ON_FAIL(_ensureLLVMInitialized());
 
-    // TODO(JS): Need a way to find in system search paths, for now we just don't bother
-    //
-    // The system search paths are for includes for compiler intrinsics it seems. 
-    // Infer the builtin include path if unspecified.
-#if 0
+    std::string bytes((const char*)bitcode->getBufferPointer(), bitcode->getBufferSize());
+
+    // Check it can be read now, rather than failing every compilation
+    auto modules = getBitcodeModuleList(MemoryBufferRef(bytes, "runtime bitcode"));
+    if (!modules)
     {
-        auto& searchOpts = clang->getHeaderSearchOpts();
-        if (searchOpts.UseBuiltinIncludes && searchOpts.ResourceDir.empty())
-        {
-            // TODO(JS): Hack - hard coded path such that we can test out the
-            // resource directory functionality.
+        consumeError(modules.takeError());
+        return SLANG_E_INVALID_ARG;
+    }
 
-            StringRef binaryPath = "F:/dev/llvm-12.0/llvm-project-llvmorg-12.0.1/build.vs/Release/bin";
+    auto dataLayout = _getHostDataLayout();
+    if (!dataLayout)
+    {
+        consumeError(dataLayout.takeError());
+        return SLANG_FAIL;
+    }
 
-            // Dir is bin/ or lib/, depending on where BinaryPath is.
+    std::lock_guard<std::mutex> lock(m_runtimeSymbolsMutex);
 
-            // On Windows, libclang.dll is in bin/.
-            // On non-Windows, libclang.so/.dylib is in lib/.
-            // With a static-library build of libclang, LibClangPath will contain the
-            // path of the embedding binary, which for LLVM binaries will be in bin/.
-            // ../lib gets us to lib/ in both cases.
-            SmallString<128> path = llvm::sys::path::parent_path(binaryPath);
-            llvm::sys::path::append(path, Twine("lib") + CLANG_LIBDIR_SUFFIX, "clang", CLANG_VERSION_STRING);
+    RefPtr<RuntimeSymbolTable> table = _cloneRuntimeSymbolTable(m_runtimeSymbols, *dataLayout);
+    table->bitcodeModules.push_back(std::move(bytes));
 
-            searchOpts.ResourceDir = path.c_str();
-        }
+    m_runtimeSymbols = table;
+    return SLANG_OK;
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! Libraries !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+SlangResult LLVMDownstreamCompiler::compileLibrary(const CompileOptions& inOptions, IArtifact** outArtifact)
+{
+    if (!isVersionCompatible(inOptions))
+    {
+        // Not possible to compile with this version of the interface.
+        return SLANG_E_NOT_IMPLEMENTED;
     }
-#endif
 
-    // Create the actual diagnostics engine.
-    clang->createDiagnostics();
-    clang->setDiagnostics(diags.get());
+    CompileOptions options = getCompatibleVersion(&inOptions);
 
-    if (!clang->hasDiagnostics())
-        return SLANG_FAIL;
+    // The bitcode is needed by registerLibrary
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.keepBitcode = true;
 
-    //
-    clang->createFileManager();
-    clang->createSourceManager(clang->getFileManager());
+    CompileBudget budget;
+    budget.init(llvmOptions);
 
-    
-    std::unique_ptr<LLVMContext> llvmContext = std::make_unique<LLVMContext>();
+    RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+    SLANG_RETURN_ON_FAIL(request->init(options));
+    request->runtimeSymbols = _getRuntimeSymbolTable();
+    request->isLibrary = true;
 
-    clang::CodeGenAction* codeGenAction = nullptr;
-    std::unique_ptr<FrontendAction> act;
+    return _compile(request, llvmOptions, budget, nullptr, outArtifact);
+}
 
+// Returns true if func uses a global variable defined in its module that can be changed. Compilations that inlined
+// such a function would use their own copy of the variable, rather than that of the library.
+static bool _usesMutableGlobals(Function& func)
+{
+    SetVector<GlobalValue*> globals;
+    for (Instruction& inst : instructions(func))
     {
-        // If we are going to just emit IR, we need to have access to the underlying type
-        if (action == frontend::ActionKind::EmitLLVMOnly)
-        {
-            EmitLLVMOnlyAction* llvmOnlyAction = new EmitLLVMOnlyAction(llvmContext.get());
-            codeGenAction = llvmOnlyAction;
-            // Make act the owning ptr
-            act = std::unique_ptr<FrontendAction>(llvmOnlyAction);
-        }
-        else
-        {
-            act = CreateFrontendAction(*clang);
-        }
-
-        if (!act)
+        for (Value* operand : inst.operands())
         {
-            return SLANG_FAIL;
+            findReferencedGlobals(operand, globals);
         }
+    }
 
-        const bool compileSucceeded = clang->ExecuteAction(*act);
-
-        // If the compilation failed make sure, we have an error
-        if (!compileSucceeded)
+    for (GlobalValue* globalValue : globals)
+    {
+        auto variable = dyn_cast<GlobalVariable>(globalValue);
+        if (variable && !variable->isDeclaration() && !variable->isConstant())
         {
-            diagnostics->requireErrorDiagnostic();
+            return true;
         }
-        
-        if (!compileSucceeded || diagsBuffer.hasError())
-        {
-            diagnostics->setResult(SLANG_FAIL);
-
-            auto artifact = ArtifactUtil::createArtifact(ArtifactDesc::make(ArtifactKind::None, ArtifactPayload::None));
-            ArtifactUtil::addAssociated(artifact, diagnostics);
+    }
+    return false;
+}
 
-            *outArtifact = artifact.detach();
-            return SLANG_OK;
-        }
+SlangResult LLVMDownstreamCompiler::registerLibrary(IArtifact* artifact)
+{
+    LLVMJITSharedLibrary* library = artifact ? LLVMJITSharedLibrary::getFromArtifact(artifact) : nullptr;
+    if (!library || !library->getBitcode() || !library->getCompileRequest()->isLibrary)
+    {
+        return SLANG_E_INVALID_ARG;
     }
 
-    std::unique_ptr<llvm::Module> module;
+    SLANG_RETURN_ON_FAIL(_ensureLLVMInitialized());
 
-    switch (action)
+    auto dataLayout = _getHostDataLayout();
+    if (!dataLayout)
     {
-        case frontend::ActionKind::EmitLLVM:
-        {
-            // LLVM output is text, that must be zero terminated
-            output.push_back(char(0));
-
-            StringRef identifier;
-            StringRef data(output.begin(), output.size() - 1);
+        consumeError(dataLayout.takeError());
+        return SLANG_FAIL;
+    }
 
-            MemoryBufferRef memoryBufferRef(data, identifier);
+    // Only compilations with the same defines and floating point mode can use the library's inline functions
+    const LLVMCompileRequest* libraryRequest = library->getCompileRequest();
 
-            SMDiagnostic err;
-            module = llvm::parseIR(memoryBufferRef, err, *llvmContext);
-            break;
-        }
-        case frontend::ActionKind::EmitBC:
-        {
-            StringRef identifier;
-            StringRef data(output.begin(), output.size());
+    RuntimeLibrary runtimeLibrary;
+    runtimeLibrary.artifact = artifact;
+    runtimeLibrary.defines = libraryRequest->defines;
+    std::sort(runtimeLibrary.defines.begin(), runtimeLibrary.defines.end());
+    runtimeLibrary.floatingPointMode = libraryRequest->floatingPointMode;
 
-            MemoryBufferRef memoryBufferRef(data, identifier);
+    ISlangBlob* bitcode = library->getBitcode();
+    runtimeLibrary.bitcode.assign((const char*)bitcode->getBufferPointer(), bitcode->getBufferSize());
 
-            SMDiagnostic err;
-            module = llvm::parseIR(memoryBufferRef, err, *llvmContext);
-            break;
-        }
-        case frontend::ActionKind::EmitLLVMOnly:
+    // Find the functions that can be used in place of a compilation's own copies
+    std::vector<std::pair<std::string, void*>> symbols;
+    {
+        LLVMContext llvmContext;
+        auto moduleExpected = parseBitcodeFile(MemoryBufferRef(runtimeLibrary.bitcode, "library bitcode"), llvmContext);
+        if (!moduleExpected)
         {
-            // Get the module produced by the action
-            module = codeGenAction->takeModule();
-            break;
+            consumeError(moduleExpected.takeError());
+            return SLANG_FAIL;
         }
-    }
-
-    switch (options.targetType)
-    {
-        // TODO(JS): Shared library may not be appropriate, but as long as the 'shared library' is never accessed as a blob
-        // all is good.
-        case SLANG_SHADER_SHARED_LIBRARY:
 
-        // TODO(JS):
-        // Hmm. What does this even mean?
-        // I guess the idea is it's 'SHADER' style, but is runnable on the host. 
-        case SLANG_SHADER_HOST_CALLABLE:
+        for (Function& func : **moduleExpected)
         {
-            // Try running something in the module on the JIT
-            std::unique_ptr<llvm::orc::LLJIT> jit;
+            if (func.isDeclaration() || func.hasLocalLinkage() || _usesMutableGlobals(func))
+            {
+                continue;
+            }
+
+            void* address = library->findSymbolAddressByName(func.getName().str().c_str());
+            if (address)
             {
-                // Create the JIT
+                symbols.push_back(std::make_pair(func.getName().str(), address));
+                runtimeLibrary.functionNames.insert(func.getName());
+            }
+        }
+    }
 
-                LLJITBuilder jitBuilder;
+    std::lock_guard<std::mutex> lock(m_runtimeSymbolsMutex);
 
-                Expected<std::unique_ptr< llvm::orc::LLJIT>> expectJit = jitBuilder.create();
-                if (!expectJit)
-                {
-                    /* JS: NOTE!
-                    
-                    It is worth saying there can be some odd issues around creating the JIT - if LLVM-C is linked against.
-                    
-                    If it is then LLVM will likely startup saying LLVM-C isn't found.
-                    BUT if you have LLVM *installed* on your system (as is reasonable to do from a LLVM distro, then
-                    at startup it *MIGHT* find a LLVM-C dll in that installation (ie nothing to do with the version of LLVM
-                    linked with). This will likely lead to an odd error saying the 'triple can't be found' and that no
-                    targets are registered.
+    RefPtr<RuntimeSymbolTable> table = _cloneRuntimeSymbolTable(m_runtimeSymbols, *dataLayout);
+    for (const auto& symbol : symbols)
+    {
+        _addRuntimeSymbol(*table, symbol.first.c_str(), symbol.second, *dataLayout);
+    }
+    table->libraries.push_back(std::move(runtimeLibrary));
 
-                    Also note that the behavior *may* be different with Debug/Release - because of how the linked resolves symbols
-                    that are multiply defined.
+    m_runtimeSymbols = table;
+    return SLANG_OK;
+}
 
-                    If there are problems creating the JIT, check that LLVM-C is not linked against (it should be disabled in the premake).
-                    */
+/* !!!!!!!!!!!!!!!!!!!!! Out of process compilation !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
 
-                    auto err = expectJit.takeError();
+/* A compilation performed out of process runs the front end, optimization and code generation in a worker process
+(slang-llvm-worker). The worker sends back the diagnostics and an object file, and the object file is added to a JIT
+in this process. As the worker runs the same shared library as the host, the same code is produced as compiling in
+process. The messages are described in slang-llvm-worker-protocol.h. */
 
-                    std::string jitErrorString;
-                    llvm::raw_string_ostream jitErrorStream(jitErrorString);
+// Sends a diagnostic from a compilation in a worker process to the host
+static void _streamDiagnosticToHost(const ArtifactDiagnostic& diagnostic, void* userData)
+{
+    CompileMessageWriter writer;
+    writer.writeUInt32(uint32_t(CompileWorkerMessage::Diagnostic));
+    writeDiagnostic(writer, diagnostic);
 
-                    jitErrorStream << err;
+    // If the host has gone, the next read of a request fails
+    writeWorkerMessage((const LLVMCompileWorkerIO*)userData, writer);
+}
 
-                    ArtifactDiagnostic diagnostic;
+// Performs a compilation requested of a worker process, writing the Result message for the host. Diagnostics may be
+// streamed to the host via io whilst compiling.
+static void _compileInWorker(const LLVMCompileWorkerIO* io, StringRef requestData, CompileMessageWriter& writer)
+{
+    RefPtr<LLVMCompileRequest> request(new LLVMCompileRequest);
+    LLVMCompileOptions llvmOptions;
+    ComPtr<ISlangBlob> profileData;
+    bool streamDiagnostics = false;
 
-                    StringBuilder buf;
-                    buf << "Unable to create JIT engine: " << jitErrorString.c_str();
+    CompileMessageReader reader(requestData);
+    readCompileRequest(reader, request, llvmOptions, profileData, streamDiagnostics);
 
-                    diagnostic.severity = ArtifactDiagnostic::Severity::Error;
-                    diagnostic.stage = ArtifactDiagnostic::Stage::Link;
-                    diagnostic.text = TerminatedCharSlice(buf.getBuffer(), buf.getLength());
-                    
-                    // Add the error
-                    diagnostics->add(diagnostic);
-                    diagnostics->setResult(SLANG_FAIL);
+    if (streamDiagnostics)
+    {
+        llvmOptions.diagnosticCallback = &_streamDiagnosticToHost;
+        llvmOptions.diagnosticCallbackUserData = const_cast<LLVMCompileWorkerIO*>(io);
+    }
 
-                    auto artifact = ArtifactUtil::createArtifact(ArtifactDesc::make(ArtifactKind::None, ArtifactPayload::None));
-                    ArtifactUtil::addAssociated(artifact, diagnostics);
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
+    SmallVector<char, 0> object;
+    SmallVector<char, 0> bitcode;
+    BranchProfileLayout branchProfileLayout;
+    std::string remarks;
+    ComPtr<LLVMCompileStats> compileStats(new LLVMCompileStats);
+
+    SlangResult res = reader.isValid() ? SLANG_OK : SLANG_FAIL;
+    if (SLANG_SUCCEEDED(res))
+    {
+        // Cancellation and time budgets are handled by the host
+        CompileBudget budget;
 
-                    *outArtifact = artifact.detach();
-                    return SLANG_OK;
-                }
-                jit = std::move(*expectJit);
-            }
+        // The worker only performs one compilation at a time, so the statistics are only of this compilation
+        StringMap<uint64_t> statisticsBefore;
+        if (llvmOptions.compileStats)
+        {
+            _enableStatistics();
+            _getStatistics(statisticsBefore);
+        }
 
-            // Used the following link to test this out
-            // https://www.llvm.org/docs/ORCv2.html
-            // https://www.llvm.org/docs/ORCv2.html#processandlibrarysymbols
+        LLVMContext llvmContext;
+        std::unique_ptr<llvm::Module> module;
 
+        res = _compileModule(request, llvmOptions, nullptr, budget, diagnostics, &llvmContext, module, branchProfileLayout, &remarks);
+        if (SLANG_SUCCEEDED(res) && module && (llvmOptions.keepBitcode || llvmOptions.keepRepresentations))
+        {
+            raw_svector_ostream stream(bitcode);
+            WriteBitcodeToFile(*module, stream);
+        }
+        if (SLANG_SUCCEEDED(res) && module)
+        {
+            if (SLANG_FAILED(_emitObject(*module, llvmOptions.compileStats ? compileStats.get() : nullptr, object)))
             {
-                auto& es = jit->getExecutionSession();
+                _addError(diagnostics, ArtifactDiagnostic::Stage::Link, "Unable to generate object code");
+                object.clear();
+            }
+        }
+        if (llvmOptions.compileStats)
+        {
+            _addStatistics(statisticsBefore, compileStats);
+        }
+    }
 
-                const DataLayout& dl = jit->getDataLayout();
-                MangleAndInterner mangler(es, dl);
+    writer.writeUInt32(uint32_t(CompileWorkerMessage::Result));
+    writer.writeUInt32(uint32_t(res));
+    writeDiagnostics(writer, diagnostics);
+    writer.writeString(StringRef(object.data(), object.size()));
+    writeBranchProfileLayout(writer, branchProfileLayout);
+    writer.writeString(StringRef(bitcode.data(), bitcode.size()));
+    writer.writeString(remarks);
+    writeCompileStats(writer, *compileStats);
+}
 
-                // The name of the lib must be unique. Should be here as we are only thing adding libs
-                auto stdcLibExpected = es.createJITDylib("stdc");
+SlangResult LLVMDownstreamCompiler::_compileOutOfProcess(LLVMCompileRequest* request, const LLVMCompileOptions& llvmOptions, const CompileBudget& budget, SharedJIT* sharedJIT, IArtifact** outArtifact)
+{
+    // Needed for the JIT in this process
+    SLANG_RETURN_ON_FAIL(_ensureLLVMInitialized());
 
-                if (stdcLibExpected)
-                {
-                    auto& stdcLib = *stdcLibExpected;
+    ComPtr<IArtifactDiagnostics> diagnostics(new ArtifactDiagnostics);
 
-                    // Add all the symbolmap
-                    SymbolMap symbolMap;
+    if (_shouldStop(budget, diagnostics))
+    {
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-                    //symbolMap.insert(std::make_pair(mangler("sin"), JITEvaluatedSymbol::fromPointer(static_cast<double (*)(double)>(&sin))));
+    CompileMessageWriter writer;
+    writeCompileRequest(writer, request, llvmOptions);
 
-                    {
-                        static const NameAndFunc funcs[] =
-                        {
-                            SLANG_LLVM_FUNCS(SLANG_LLVM_FUNC)
-                            SLANG_PLATFORM_FUNCS(SLANG_LLVM_FUNC)
-                        };
+    std::unique_ptr<CompileWorkerProcess> process;
+    const SlangResult acquireResult = m_workerProcessPool.acquire(process);
+    if (SLANG_FAILED(acquireResult))
+    {
+        const char* text = (acquireResult == SLANG_E_NOT_IMPLEMENTED) ? "Compile worker process uses a different protocol version" : "Unable to start a compile worker process";
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, text);
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-                        for (auto& func : funcs)
-                        {
-                            symbolMap.insert(std::make_pair(mangler(func.name), JITEvaluatedSymbol::fromPointer(func.func)));
-                        }
-                    }
+    // Streamed diagnostics are sent to the callback as the response is waited for
+    std::string response;
+    if (SLANG_FAILED(exchangeWithWorker(*process, writer.getData(), llvmOptions, budget, response)))
+    {
+        // The worker has crashed, or is part way through a compilation, so can't be reused
+        process.reset();
+        m_workerProcessPool.release(nullptr);
 
-#if SLANG_PTR_IS_32 && SLANG_VC
-                    {
-                        // https://docs.microsoft.com/en-us/windows/win32/devnotes/-win32-alldiv
-                        symbolMap.insert(std::make_pair(mangler("_alldiv"), JITEvaluatedSymbol::fromPointer(WinSpecific::_alldiv)));
-                        symbolMap.insert(std::make_pair(mangler("_allrem"), JITEvaluatedSymbol::fromPointer(WinSpecific::_allrem)));
-                        symbolMap.insert(std::make_pair(mangler("_aullrem"), JITEvaluatedSymbol::fromPointer(WinSpecific::_aullrem)));
-                        symbolMap.insert(std::make_pair(mangler("_aulldiv"), JITEvaluatedSymbol::fromPointer(WinSpecific::_aulldiv)));
-                    }
-#endif
+        if (!_shouldStop(budget, diagnostics))
+        {
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Compile worker process terminated unexpectedly");
+        }
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-                    if (auto err = stdcLib.define(absoluteSymbols(symbolMap)))
-                    {
-                        return SLANG_FAIL;
-                    }
+    m_workerProcessPool.release(std::move(process));
 
-                    // Required or the symbols won't be found
-                    jit->getMainJITDylib().addToLinkOrder(stdcLib);
-                }
-            }
+    CompileMessageReader reader(response);
 
-            ThreadSafeModule threadSafeModule(std::move(module), std::move(llvmContext));
+    const SlangResult workerResult = SlangResult(reader.readUInt32());
+    readDiagnostics(reader, diagnostics);
+    const StringRef object = reader.readString();
+    BranchProfileLayout branchProfileLayout;
+    readBranchProfileLayout(reader, branchProfileLayout);
+    const StringRef bitcodeData = reader.readString();
+    const StringRef remarks = reader.readString();
+    ComPtr<LLVMCompileStats> compileStats(new LLVMCompileStats);
+    readCompileStats(reader, *compileStats);
 
-            if (auto err = jit->addIRModule(std::move(threadSafeModule)))
-            {
-                return SLANG_FAIL;
-            }
+    if (!reader.isValid())
+    {
+        _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Invalid response from compile worker process");
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-            if (auto err = jit->initialize(jit->getMainJITDylib()))
-            {
-                return SLANG_FAIL;
-            }
+    if (SLANG_FAILED(workerResult))
+    {
+        if (!_hasError(diagnostics))
+        {
+            _addError(diagnostics, ArtifactDiagnostic::Stage::Compile, "Compile worker process was unable to perform the compilation");
+        }
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-            // Create the shared library
-            ComPtr<ISlangSharedLibrary> sharedLibrary(new LLVMJITSharedLibrary(std::move(jit)));
+    if (object.empty())
+    {
+        return _createFailedArtifact(diagnostics, outArtifact);
+    }
 
-            // Work out the ArtifactDesc 
-            const auto targetDesc = ArtifactDescUtil::makeDescForCompileTarget(options.targetType);
+    auto addObject = [&](LLJIT& jit, JITDylib& dylib) -> Error
+    {
+        return jit.addObjectFile(dylib, MemoryBuffer::getMemBufferCopy(object));
+    };
 
-            auto artifact = ArtifactUtil::createArtifact(targetDesc);
-            ArtifactUtil::addAssociated(artifact, diagnostics);
+    ComPtr<ISlangBlob> bitcode;
+    if (llvmOptions.keepBitcode || llvmOptions.keepRepresentations)
+    {
+        bitcode = RawBlob::create(bitcodeData.data(), bitcodeData.size());
+    }
 
-            artifact->addRepresentation(sharedLibrary);
+    // The worker doesn't reduce optimization, as the time budget is only checked in this process
+    SLANG_RETURN_ON_FAIL(_createJITArtifact(request, llvmOptions, diagnostics, false, nullptr, sharedJIT, m_dispatchThreadPool, addObject, std::move(branchProfileLayout), bitcode, outArtifact));
 
-            *outArtifact = artifact.detach();
-            return SLANG_OK;
+    if (request->remarksFilter.size())
+    {
+        if (LLVMJITSharedLibrary* sharedLibrary = LLVMJITSharedLibrary::getFromArtifact(*outArtifact))
+        {
+            sharedLibrary->setRemarks(RawBlob::create(remarks.data(), remarks.size()));
         }
     }
-
-    return SLANG_FAIL;
+    if (llvmOptions.compileStats)
+    {
+        _addCompileStats(*outArtifact, compileStats);
+    }
+    return SLANG_OK;
 }
 
 } // namespace slang_llvm
@@ -1064,3 +4894,33 @@ extern "C" SLANG_DLL_EXPORT SlangResult createLLVMDownstreamCompiler_V4(const Sl
 
     return SLANG_E_NO_INTERFACE;
 }
+
+extern "C" SLANG_DLL_EXPORT SlangResult slang_llvm_runCompileWorker(const slang_llvm::LLVMCompileWorkerIO* io)
+{
+    using namespace slang_llvm;
+
+    {
+        CompileMessageWriter writer;
+        writer.writeUInt32(uint32_t(CompileWorkerMessage::Hello));
+        writer.writeUInt32(kCompileWorkerProtocolVersion);
+        SLANG_RETURN_ON_FAIL(writeWorkerMessage(io, writer));
+    }
+
+    for (;;)
+    {
+        uint32_t requestSize = 0;
+        if (SLANG_FAILED(io->read(&requestSize, sizeof(requestSize), io->userData)))
+        {
+            // The host has closed the connection
+            return SLANG_OK;
+        }
+
+        std::string request;
+        request.resize(requestSize);
+        SLANG_RETURN_ON_FAIL(io->read(&request[0], requestSize, io->userData));
+
+        CompileMessageWriter writer;
+        _compileInWorker(io, request, writer);
+        SLANG_RETURN_ON_FAIL(writeWorkerMessage(io, writer));
+    }
+}
@@ -0,0 +1,540 @@
+#ifndef SLANG_LLVM_H
+#define SLANG_LLVM_H
+
+// Interfaces and types that are specific to the slang-llvm downstream compiler.
+//
+// Everything here is accessible via `castAs` on the objects returned from slang-llvm, such that users that only
+// know about IDownstreamCompiler are unaffected.
+
+#include <slang.h>
+#include <slang-com-helper.h>
+
+#include <compiler-core/slang-downstream-compiler.h>
+#include <compiler-core/slang-artifact-associated.h>
+
+namespace slang_llvm {
+
+/* Allows compilations to be cancelled. A token can be shared between many compilations, and can be used from any thread. */
+class ILLVMCancellationToken : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0x24b4c33e, 0x164f, 0x42ff, { 0x8b, 0x2e, 0x87, 0x28, 0xa4, 0x59, 0x94, 0x17 })
+
+        /// Cancel all compilations using this token. Compilations stop at the next point they check the token.
+    virtual SLANG_NO_THROW void SLANG_MCALL cancel() = 0;
+        /// Returns true if cancel has been called
+    virtual SLANG_NO_THROW bool SLANG_MCALL isCancelled() = 0;
+};
+
+/* Settings that determine the performance of the code produced, and so can be chosen by autotuning */
+struct LLVMTuningConfig
+{
+    typedef Slang::DownstreamCompileOptions::OptimizationLevel OptimizationLevel;
+    typedef Slang::DownstreamCompileOptions::FloatingPointMode FloatingPointMode;
+
+    OptimizationLevel optimizationLevel = OptimizationLevel::Default;
+    FloatingPointMode floatingPointMode = FloatingPointMode::Default;
+
+    bool unrollLoops = false;
+    bool vectorizeLoops = false;
+    bool vectorizeSLP = false;          ///< Vectorize straight line code
+
+        /// If not 0, innermost loops are vectorized with this width
+    uint32_t vectorizeWidth = 0;
+};
+
+/* Options that control aspects of a compilation that are specific to LLVM, and so can't be expressed
+via DownstreamCompileOptions. The default constructed value produces the same results as IDownstreamCompiler::compile.
+
+Fields are only ever added at the end, and doing so increments kVersion, such that callers built against an older
+version of this header keep working. */
+struct LLVMCompileOptions
+{
+        /// The current version of the structure
+    static const uint32_t kVersion = 1;
+
+        /// The version the caller was built with. Fields added in later versions take their default values. A version
+        /// newer than slang-llvm supports fails with SLANG_E_NOT_IMPLEMENTED.
+    uint32_t version = kVersion;
+
+    enum class ProfileMode : uint8_t
+    {
+        None,               ///< Don't instrument or use a profile
+        Instrument,         ///< Instrument branches such that edge counts are collected as the code runs
+        Use,                ///< Use the profile in profileData to guide optimization
+    };
+
+    ProfileMode profileMode = ProfileMode::None;
+
+        /// Profile as produced by ILLVMJITSharedLibrary::writeProfile. Only used with ProfileMode::Use.
+    ISlangBlob* profileData = nullptr;
+
+    enum class BudgetExceededAction : uint8_t
+    {
+        Fail,               ///< The compilation fails with an error diagnostic
+        ReduceOptimization, ///< Remaining optimization passes are skipped, and the code is generated with minimal optimization
+    };
+
+        /// If set the compilation is stopped and fails when the token is cancelled
+    ILLVMCancellationToken* cancellationToken = nullptr;
+
+        /// The maximum time in milliseconds a compilation may take, measured from when it was requested. 0 means no limit.
+        /// Checked between the front end, optimization and code generation phases, and between optimization passes.
+        /// Code generation can't be interrupted. It takes place before the compilation completes (rather than when a symbol
+        /// is first looked up), and if it exceeds the budget with BudgetExceededAction::Fail the compilation fails.
+    uint32_t timeBudgetInMs = 0;
+        /// What to do if the timeBudgetInMs is exceeded
+    BudgetExceededAction budgetExceededAction = BudgetExceededAction::Fail;
+
+        /// Receives a diagnostic. The diagnostic (including its text) is only valid for the duration of the call.
+    typedef void (*DiagnosticCallback)(const Slang::ArtifactDiagnostic& diagnostic, void* userData);
+
+        /// If set, diagnostics from the front end are sent to the callback as they are produced. Only errors are also
+        /// added to the artifacts diagnostics, so memory use doesn't grow with the amount of warnings. 
+        /// The callback is made on the thread performing the compilation.
+    DiagnosticCallback diagnosticCallback = nullptr;
+    void* diagnosticCallbackUserData = nullptr;
+
+        /// The front end stops after this many errors. 0 means no limit.
+    uint32_t errorLimit = 0;
+
+        /// If set the front end, optimization and code generation take place in a worker process (slang-llvm-worker),
+        /// such that a crash or fatal LLVM error only terminates the worker. The code produced is loaded into this process.
+        /// Cancellation, and a time budget with BudgetExceededAction::Fail, are enforced by terminating the worker.
+        /// Diagnostics are sent to any diagnosticCallback as the worker produces them, on the thread waiting for the worker.
+    bool compileOutOfProcess = false;
+
+        /// If set tuningConfig replaces the optimization level and floating point mode from DownstreamCompileOptions.
+    bool useTuningConfig = false;
+    LLVMTuningConfig tuningConfig;
+
+        /// If set each exported function counts the calls to it, and the CPU cycles spent in it (including any functions
+        /// it calls). The counts are read with ILLVMJITSharedLibrary::getFunctionStatsAt.
+    bool instrumentFunctions = false;
+
+        /// If set the loop over the threads of a group in each Slang compute <entryPoint>_Group function is vectorized,
+        /// such that each SIMD lane runs a thread, using the widest vectors the host CPU supports. Control flow that
+        /// differs between threads is handled by masking. Groups whose threads may wait at a group barrier are not vectorized.
+        /// As the code is generated for the host CPU it may not run on other CPUs, so shouldn't be stored (for example with
+        /// keepBitcode) for use on another machine, unless multiversionLevels is also set.
+    bool vectorizeGroups = false;
+
+    struct MultiversionLevel
+    {
+        enum Enum : uint32_t
+        {
+            X86_64_V2 = 0x1,            ///< SSE4.2, POPCNT
+            X86_64_V3 = 0x2,            ///< AVX2, FMA, BMI2
+            X86_64_V4 = 0x4,            ///< AVX-512
+        };
+    };
+
+        /// Exported functions are additionally compiled for each MultiversionLevel set, and when the code is loaded
+        /// calls are directed to the variant for the highest level the CPU supports. Only applies to x86-64.
+        /// With vectorizeGroups, each variant is vectorized for its level rather than the host CPU.
+    uint32_t multiversionLevels = 0;
+
+        /// If set the module is optimized such that it can be linked with other modules, and the artifact keeps it as
+        /// bitcode so it can be passed to ILLVMLinkDownstreamCompiler::link. The code of the artifact itself is less
+        /// optimized than it would otherwise be. Artifacts compiled with instrumentation can't be linked together.
+    bool keepBitcode = false;
+
+        /// The names of the functions that must remain available from the artifact. Everything else is made internal and
+        /// removed if unused before optimization, such that it can be inlined freely and no code is generated for it.
+        /// If there are none, every function remains available. The names are copied, so only need to remain valid
+        /// for the call.
+    const char* const* exportNames = nullptr;
+    Slang::Count exportNameCount = 0;
+
+        /// If set, identical functions within the module are merged, and functions that are identical to those of other
+        /// compilations by the same compiler share a single copy of their code, which is freed once no artifact uses it.
+        /// Functions are identified by a hash of their optimized IR. Only internal functions that don't use mutable global
+        /// variables are shared. Out of process compilations only merge functions within the module.
+    bool shareFunctions = false;
+
+        /// If set, code generated for functions by earlier compilations with the same compiler is reused for functions
+        /// that haven't changed (along with everything they call), such that after an edit code is only generated for
+        /// the functions affected. Code is only reused from artifacts that haven't been released, so the artifact from
+        /// before an edit should be released once the new one has been compiled. Implies shareFunctions, and additionally
+        /// applies to exported functions, other than those identical to another exported function. Exported functions
+        /// aren't merged with each other. Functions that use mutable global variables are always compiled again. Has no
+        /// effect out of process.
+    bool incremental = false;
+
+        /// If set, the source is only parsed and checked, as with clang's -fsyntax-only, and no code is generated.
+        /// The artifact only holds the diagnostics, and fails if the source is invalid. Always performed in process.
+    bool syntaxOnly = false;
+
+        /// If set, a bitcode snapshot of the optimized module is kept, such that ILLVMJITSharedLibrary::getRepresentation
+        /// can produce its IR and assembly. Unlike keepBitcode, doesn't change how the module is optimized.
+    bool keepRepresentations = false;
+
+        /// If set, the code can be seen by sampling profilers such as Linux perf. Line table debug info is generated, which
+        /// maps the code back to the #line locations of the source. On Linux the functions are written to
+        /// /tmp/perf-<pid>.map, and if LLVM was built with LLVM_USE_PERF, jitdump files (that include the line tables)
+        /// are written for 'perf inject --jit'. Doesn't apply to code shared with shareFunctions or incremental.
+    bool profilerSupport = false;
+
+        /// If set, optimization remarks from the passes whose names match this regular expression (such as
+        /// "inline|loop-vectorize", or ".*" for every pass) are reported as Info diagnostics at the #line locations of
+        /// the code they are about. Passed, missed and analysis remarks are reported. The remarks are also available as
+        /// YAML from ILLVMJITSharedLibrary::getRepresentation. The string is copied.
+    const char* remarksFilter = nullptr;
+
+        /// If set, the artifact has an associated artifact whose representation is an ILLVMCompileStats, with the size of
+        /// the IR and machine code of each function, and the LLVM Statistic counters of the compilation. The machine code
+        /// is then generated by the JIT as the compilation completes, rather than when a symbol is first looked up.
+    bool compileStats = false;
+
+    enum class PipelineProfile : uint8_t
+    {
+        Default,            ///< The pipeline clang uses for the optimization level
+        LowLatency,         ///< Inlining and cheap scalar simplification only, for the fastest JIT turnaround
+        Throughput,         ///< The -O3 pipeline with loop unrolling (including runtime unrolling) and vectorization always enabled. As Default with OptimizationLevel::None.
+        Custom,             ///< The passes in passPipeline
+    };
+
+        /// The optimization passes run on the module. Profiles other than Default replace the pipeline of the optimization
+        /// level.
+    PipelineProfile pipelineProfile = PipelineProfile::Default;
+        /// The passes run with PipelineProfile::Custom, in the new pass manager syntax used by 'opt -passes', such as
+        /// "default<O2>" or "function(sroa,instcombine,simplifycfg)", which may include passes of the target. The compilation
+        /// fails with an error diagnostic if it can't be parsed. The string is copied.
+    const char* passPipeline = nullptr;
+
+        /// If set, and useTuningConfig isn't, the configuration found by ILLVMAutotuneDownstreamCompiler::autotune is used if
+        /// the compiler has autotuned the same source with the same options. Precise floating point is never replaced.
+    bool useAutotunedConfig = false;
+};
+
+class ILLVMDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0x7f9521f1, 0x8799, 0x48a5, { 0x9f, 0xdf, 0x7c, 0xab, 0x4f, 0x2e, 0x1d, 0x24 })
+
+        /// Compile with LLVM specific options. With default llvmOptions is equivalent to IDownstreamCompiler::compile
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileWithOptions(const Slang::DownstreamCompileOptions& options, const LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifact) = 0;
+
+        /// Recompile artifact (which must have been produced by slang-llvm) using the profile in profileData.
+        /// The recompilation uses the same source and options that produced artifact.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL recompileWithProfile(Slang::IArtifact* artifact, ISlangBlob* profileData, Slang::IArtifact** outArtifact) = 0;
+
+        /// Create a token that can be used to cancel compilations
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL createCancellationToken(ILLVMCancellationToken** outToken) = 0;
+};
+
+/* Determines the order in which asynchronous compilations are performed. Compilations with a higher priority are
+started before any with lower priority. Compilations of the same priority are started in the order they were submitted. */
+enum class LLVMCompilePriority : uint8_t
+{
+    Background,         ///< For example precompiling work that may be needed later
+    Normal,
+    High,               ///< For compilations that something is waiting on
+};
+
+class ILLVMCompileTask;
+
+    /// Called when an asynchronous compilation completes
+typedef void (*LLVMCompileTaskCallback)(ILLVMCompileTask* task, void* userData);
+
+/* A compilation taking place asynchronously */
+class ILLVMCompileTask : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0xc3e611ee, 0xd368, 0x45f5, { 0x98, 0x7a, 0xcd, 0x0a, 0x3e, 0x22, 0x9f, 0xea })
+
+        /// Returns true when the compilation has completed, successfully or not
+    virtual SLANG_NO_THROW bool SLANG_MCALL isComplete() = 0;
+        /// Blocks until the compilation has completed
+    virtual SLANG_NO_THROW void SLANG_MCALL wait() = 0;
+        /// Get the result of the compilation. The result and artifact are the same as compile would produce.
+        /// Returns SLANG_E_NOT_AVAILABLE if the compilation has not completed.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getResult(Slang::IArtifact** outArtifact) = 0;
+        /// Set a callback that is called when the compilation completes. The callback is typically made on a worker thread,
+        /// but if the compilation has already completed it is made immediately on the calling thread.
+    virtual SLANG_NO_THROW void SLANG_MCALL setCompletionCallback(LLVMCompileTaskCallback callback, void* userData) = 0;
+        /// Cancel the compilation. If it hasn't started it will complete immediately with a failure when it is taken from the
+        /// queue. If it is in progress it stops at the next check. Only cancels this task, unlike a cancellation token.
+    virtual SLANG_NO_THROW void SLANG_MCALL cancel() = 0;
+};
+
+class ILLVMAsyncDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0x345cd32b, 0xff0d, 0x4bea, { 0x9a, 0x6d, 0x22, 0x1f, 0x59, 0xc2, 0x8f, 0xee })
+
+        /// Starts a compilation on one of the compilers worker threads.
+        ///
+        /// The task keeps the compiler alive until the compilation has completed, so the compiler can be released first.
+        /// Everything needed from options and llvmOptions is copied, so they do not need to remain valid after the call.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileAsync(const Slang::DownstreamCompileOptions& options, const LLVMCompileOptions& llvmOptions, LLVMCompilePriority priority, ILLVMCompileTask** outTask) = 0;
+};
+
+class ILLVMBatchDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0x82d97ec3, 0x1878, 0x46f2, { 0x8c, 0x32, 0xc8, 0x83, 0x07, 0x3e, 0xb6, 0x2d })
+
+        /// Compile count independent programs. outArtifacts[i] receives the artifact for options[i], which is the same as
+        /// compile would produce including its own diagnostics. An item failing doesn't stop the others being compiled.
+        ///
+        /// The compilations are performed in parallel on the compilers worker threads, and their code is added to a single
+        /// JIT. The code for all of the items is freed when the artifacts of all of the items have been released.
+        /// llvmOptions is used for every item. Blocks until all of the compilations complete, so must not be called from
+        /// an ILLVMCompileTask completion callback.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileBatch(const Slang::DownstreamCompileOptions* options, Slang::Count count, const LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifacts) = 0;
+};
+
+/* Name of the runtime function JIT'd code can call to wait for all other threads of its compute workgroup. It only
+waits when the group is run by ILLVMJITSharedLibrary::dispatchGroups, otherwise it returns immediately. */
+#define SLANG_LLVM_GROUP_BARRIER_NAME "slang_llvm_groupBarrier"
+
+/* Matches ComputeThreadVaryingInput in the Slang C++ prelude */
+struct LLVMComputeThreadVaryingInput
+{
+    uint32_t groupID[3];
+    uint32_t groupThreadID[3];
+};
+
+    /// The signature of the thread function Slang produces for a compute entry point (<entryPoint>_Thread)
+typedef void (*LLVMComputeThreadFunc)(LLVMComputeThreadVaryingInput* varyingInput, void* entryPointParams, void* globalParams);
+
+/* Matches ComputeVaryingInput in the Slang C++ prelude. The range of groups is exclusive of endGroupID. */
+struct LLVMComputeVaryingInput
+{
+    uint32_t startGroupID[3];
+    uint32_t endGroupID[3];
+};
+
+    /// The signature of the function Slang produces for a compute entry point, which runs a range of groups
+typedef void (*LLVMComputeFunc)(LLVMComputeVaryingInput* varyingInput, void* entryPointParams, void* globalParams);
+
+struct LLVMDispatchDesc
+{
+    const char* entryPointName = nullptr;           ///< Name of an LLVMComputeFunc
+    uint32_t groupCount[3] = { 1, 1, 1 };
+
+    void* entryPointParams = nullptr;
+    void* globalParams = nullptr;
+
+        /// The maximum amount of threads to run groups on, including the calling thread. 0 uses a thread per CPU core.
+    uint32_t threadCount = 0;
+        /// The amount of groups run by a single call of the entry point. Threads that run out of groups take half of the
+        /// remaining calls of another thread. 0 chooses a size that gives each thread several calls to balance the load.
+    uint32_t grainSize = 0;
+};
+
+struct LLVMLinkDesc
+{
+        /// Artifacts compiled with LLVMCompileOptions::keepBitcode
+    Slang::IArtifact* const* artifacts = nullptr;
+    Slang::Count artifactCount = 0;
+
+        /// The names of the functions that must remain available from the linked code. Everything else can be inlined
+        /// into them or removed. If there are none, every function that was available from the artifacts remains so.
+    const char* const* exportNames = nullptr;
+    Slang::Count exportNameCount = 0;
+};
+
+/* Links separately compiled artifacts with full LTO, such that calls between them can be inlined and code that isn't
+used removed */
+class ILLVMLinkDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0xe5f63e0b, 0x562c, 0x4ae4, { 0xa6, 0xf8, 0xf6, 0x39, 0x2f, 0x3e, 0x3a, 0xaf })
+
+        /// Link the bitcode of the artifacts into one module, optimize it as a whole with the full LTO pipeline, and
+        /// produce an artifact with the code.
+        /// The linked artifact can't be specialized or recompiled with a profile.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL link(const LLVMLinkDesc& desc, Slang::IArtifact** outArtifact) = 0;
+};
+
+/* A value to be bound as a constant when specializing a function. The value is that read at offset bytes from the
+pointer passed as the parameter with parameterIndex. For a Slang entry point, parameter 1 points to the entry point
+uniforms and parameter 2 points to the global uniforms. */
+struct LLVMSpecializationValue
+{
+    uint32_t parameterIndex;
+    uint32_t offset;            ///< Offset in bytes
+    uint32_t size;              ///< Size of data in bytes
+    const void* data;
+};
+
+class ILLVMSymbolDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0xe8438d82, 0x4e99, 0x4e51, { 0x9a, 0x4f, 0xb8, 0x16, 0x3b, 0x52, 0xf0, 0x6d })
+
+        /// Make a native function (or variable) at address available to JIT'd code as name, which is a C (unmangled)
+        /// name. Replaces any symbol previously registered with the same name, including the built in runtime functions.
+        /// Only affects compilations started after the call.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL registerSymbol(const char* name, void* address) = 0;
+
+        /// Add LLVM bitcode that is linked into compilations started after the call, such that its functions can be
+        /// inlined. Only the functions a compilation uses are linked. If a function is also registered with registerSymbol,
+        /// the bitcode is only used for inlining, otherwise each compilation has its own copy.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL registerBitcode(ISlangBlob* bitcode) = 0;
+};
+
+/* Shared helpers (such as the inline functions of a prelude) can be compiled once as a library, such that compilations
+use the library's code for them rather than optimizing and generating code for their own copies. */
+class ILLVMLibraryDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0xd9f8581d, 0xa2c4, 0x4e33, { 0xb3, 0x1a, 0xdb, 0x06, 0x99, 0x13, 0x00, 0x5c })
+
+        /// Compile the source as a library for registerLibrary. Every function it defines is kept, including inline
+        /// functions that are unused, so any templates that compilations use should be explicitly instantiated.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL compileLibrary(const Slang::DownstreamCompileOptions& options, Slang::IArtifact** outArtifact) = 0;
+
+        /// Make the functions of an artifact produced by compileLibrary available to compilations started after the call.
+        /// A compilation's copies of inline functions with the same names are replaced by the library's code if the
+        /// compilation has the same defines and floating point mode as the library, so the library must have been compiled
+        /// from the same source. The definitions are then linked into the compilation (as with
+        /// ILLVMSymbolDownstreamCompiler::registerBitcode), so they can be inlined. Other compilations use their own copies.
+        /// Functions that use mutable global variables aren't made available. The artifact is kept alive by the compiler.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL registerLibrary(Slang::IArtifact* artifact) = 0;
+};
+
+    /// Measures the performance of func, which is the entry point from a variant being autotuned. Returns the time taken
+    /// in any unit (lower is better), or a negative value to reject the variant, for example if it produced wrong results.
+typedef double (*LLVMBenchmarkCallback)(void* func, void* userData);
+
+struct LLVMAutotuneDesc
+{
+    const char* entryPointName = nullptr;       ///< The name of the function passed to benchmark
+
+    LLVMBenchmarkCallback benchmark = nullptr;
+    void* benchmarkUserData = nullptr;
+
+        /// The configurations to try. If configCount is 0 a default set is tried, which includes fast floating point
+        /// variants unless the options ask for precise floating point.
+    const LLVMTuningConfig* configs = nullptr;
+    Slang::Count configCount = 0;
+};
+
+class ILLVMAutotuneDownstreamCompiler : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0xb09a1ca0, 0xa851, 0x42fd, { 0x8b, 0x06, 0x2e, 0xa5, 0x9f, 0xcc, 0xdf, 0x61 })
+
+        /// Compiles a variant of the source for each configuration, and calls the benchmark callback with the entry point
+        /// of each one in turn. outArtifact receives the artifact of the fastest variant, and outConfig (if set) its
+        /// configuration.
+        ///
+        /// The winning configuration is recorded, and is used by later compilations by this compiler that set
+        /// LLVMCompileOptions::useAutotunedConfig, if they have the same source, target, defines, include paths, optimization
+        /// level and floating point mode, and the LLVMCompileOptions that change the code generated have their defaults.
+        /// If no variant compiles, outArtifact receives the failed artifact of the first. Fails if every variant that
+        /// compiled was rejected by the benchmark.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL autotune(const Slang::DownstreamCompileOptions& options, const LLVMAutotuneDesc& desc, Slang::IArtifact** outArtifact, LLVMTuningConfig* outConfig) = 0;
+};
+
+enum class LLVMRepresentation
+{
+    IR,                 ///< LLVM IR as text
+    Bitcode,            ///< LLVM bitcode
+    Assembly,           ///< Assembly for the host, as generated by the JIT
+    Remarks,            ///< Optimization remarks as YAML, if compiled with LLVMCompileOptions::remarksFilter
+};
+
+/* Counts for a function compiled with LLVMCompileOptions::instrumentFunctions */
+struct LLVMFunctionStats
+{
+    const char* name;           ///< Remains valid for as long as the library
+    uint64_t callCount;
+    uint64_t cycleCount;        ///< As measured by the CPU's cycle counter, so is only comparable on the same machine
+};
+
+class ILLVMJITSharedLibrary : public ISlangSharedLibrary
+{
+    SLANG_COM_INTERFACE(0x9284a23f, 0xdedc, 0x4e9f, { 0x87, 0xbc, 0x78, 0x56, 0x5d, 0x5d, 0xa2, 0xec })
+
+        /// Writes the counts collected by code compiled with ProfileMode::Instrument.
+        ///
+        /// The profile is text, and the same counts always produce the same bytes, so it can be used as part of
+        /// a cache key. Returns SLANG_E_NOT_AVAILABLE if the code was not instrumented.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL writeProfile(ISlangBlob** outProfile) = 0;
+
+        /// Get a variant of the function name, recompiled with the values read through its parameters replaced by constants,
+        /// such that branches on them can be folded and loops on them unrolled. The caller must ensure the memory the values
+        /// are read from holds the same values whenever the variant is called.
+        ///
+        /// The variant is compiled with the optimization settings of the library, and uses the global variables of the library
+        /// rather than its own copies. If outDiagnostics is set it receives the diagnostics of compiling the variant (or
+        /// nullptr if it was already compiled).
+        ///
+        /// Variants are cached, so asking for the same specialization again returns the same function immediately.
+        /// The variant remains valid for as long as this library.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL specialize(const char* name, const LLVMSpecializationValue* values, Slang::Count valueCount, void** outFunc, Slang::IArtifactDiagnostics** outDiagnostics) = 0;
+
+        /// Get the amount of functions with stats. 0 if the code was not compiled with LLVMCompileOptions::instrumentFunctions.
+    virtual SLANG_NO_THROW Slang::Count SLANG_MCALL getFunctionStatsCount() = 0;
+        /// Get the stats of a function. The counts are updated as the code runs (on any thread), so may be out of date
+        /// by the time they are read.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getFunctionStatsAt(Slang::Index index, LLVMFunctionStats* outStats) = 0;
+        /// Set the counts of all functions back to 0
+    virtual SLANG_NO_THROW void SLANG_MCALL resetFunctionStats() = 0;
+
+        /// Run the compute thread function threadFuncName (an LLVMComputeThreadFunc) for every thread of groupCount groups of
+        /// groupSize threads. The threads of a group are run as fibers on the calling thread, switching between them when
+        /// they call the SLANG_LLVM_GROUP_BARRIER_NAME function, so kernels that use group memory barriers run correctly.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL dispatchGroups(const char* threadFuncName, const uint32_t groupCount[3], const uint32_t groupSize[3], void* entryPointParams, void* globalParams) = 0;
+
+        /// Run a compute entry point over a grid of groups on multiple threads, returning when all groups have run.
+        /// The entry point is called directly for each range of groups (of desc.grainSize), so there is no per group overhead.
+        ///
+        /// The threads are shared by every library produced by the same compiler. If they are in use by a dispatch on
+        /// another thread, waits for it to complete. A dispatch made by code run by a dispatch runs all of its groups on
+        /// the calling thread.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL dispatch(const LLVMDispatchDesc& desc) = 0;
+
+        /// Get a representation of the optimized module the code was generated from. Representations are produced from
+        /// the snapshot kept by LLVMCompileOptions::keepRepresentations (or keepBitcode) when first asked for, and then
+        /// cached. Returns SLANG_E_NOT_AVAILABLE if no snapshot was kept. Remarks don't need a snapshot.
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getRepresentation(LLVMRepresentation representation, ISlangBlob** outBlob) = 0;
+};
+
+/* Statistics of a function, collected by compiling with LLVMCompileOptions::compileStats */
+struct LLVMFunctionCompileStats
+{
+    const char* name;               ///< Remains valid for as long as the ILLVMCompileStats
+    uint32_t instructionCount;      ///< IR instructions after optimization
+    uint32_t basicBlockCount;       ///< IR basic blocks after optimization
+    uint32_t loopCount;             ///< Loops, including the loops in other loops
+    uint32_t codeSize;              ///< Bytes of machine code
+    uint32_t spillCount;            ///< Spills and reloads inserted by the register allocator
+};
+
+/* An LLVM Statistic counter, such as "inline.NumInlined", and how much it was incremented by a compilation */
+struct LLVMStatistic
+{
+    const char* name;               ///< The pass (its DEBUG_TYPE) and counter name. Remains valid for as long as the ILLVMCompileStats.
+    uint64_t value;
+};
+
+class ILLVMCompileStats : public Slang::ICastable
+{
+    SLANG_COM_INTERFACE(0x5493c7e5, 0x7b69, 0x4915, { 0x95, 0x45, 0x86, 0xbd, 0x3d, 0x4b, 0xda, 0x89 })
+
+        /// Get the amount of functions with code, in the order they are in the module
+    virtual SLANG_NO_THROW Slang::Count SLANG_MCALL getFunctionCount() = 0;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getFunctionAt(Slang::Index index, LLVMFunctionCompileStats* outStats) = 0;
+
+        /// Get the amount of statistics the compilation incremented, sorted by name. Statistics are only available if LLVM was
+        /// built with them (as builds with assertions are). The counters are shared by the process, so in process compilations
+        /// that run at the same time are included in each other's statistics.
+    virtual SLANG_NO_THROW Slang::Count SLANG_MCALL getStatisticCount() = 0;
+    virtual SLANG_NO_THROW SlangResult SLANG_MCALL getStatisticAt(Slang::Index index, LLVMStatistic* outStatistic) = 0;
+};
+
+/* Used by the slang-llvm-worker executable to communicate with the process that started it */
+struct LLVMCompileWorkerIO
+{
+        /// Read exactly size bytes. Fails if the data can't be read, for example because the host closed the connection.
+    SlangResult (*read)(void* data, size_t size, void* userData);
+        /// Write all of the data
+    SlangResult (*write)(const void* data, size_t size, void* userData);
+    void* userData;
+};
+
+    /// Performs compilations requested by the host until the connection is closed.
+    /// Exported from the slang-llvm shared library as SLANG_LLVM_RUN_COMPILE_WORKER_NAME
+typedef SlangResult (*LLVMRunCompileWorkerFunc)(const LLVMCompileWorkerIO* io);
+
+#define SLANG_LLVM_RUN_COMPILE_WORKER_NAME "slang_llvm_runCompileWorker"
+
+} // namespace slang_llvm
+
+#endif // SLANG_LLVM_H
@@ -0,0 +1,263 @@
+// slang-llvm-test
+//
+// Runs the slang-llvm tests against a slang-llvm shared library. The worker used for out of process compilation is
+// expected to be next to the library, as it is when slang-llvm is used by Slang.
+//
+// Usage: slang-llvm-test <slang-llvm library path> [test name prefix...]
+
+#include "slang-llvm-test.h"
+
+#include <core/slang-blob.h>
+
+#include <compiler-core/slang-artifact-associated.h>
+#include <compiler-core/slang-artifact-util.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#if SLANG_WINDOWS_FAMILY
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <dlfcn.h>
+#endif
+
+namespace slang_llvm_test {
+
+using namespace Slang;
+using namespace slang_llvm;
+
+/* !!!!!!!!!!!!!!!!!!!!! TestRegistration !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+TestRegistration* TestRegistration::s_first = nullptr;
+
+TestRegistration::TestRegistration(const char* inName, TestFunc inFunc):
+    name(inName),
+    func(inFunc),
+    next(s_first)
+{
+    s_first = this;
+}
+
+/* !!!!!!!!!!!!!!!!!!!!! TestContext !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! */
+
+const char kSumSource[] = R"(
+extern "C" int sum(const int* values, int count)
+{
+    int total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        total += values[i];
+    }
+    return total;
+}
+)";
+
+static void _appendDiagnostic(const ArtifactDiagnostic& diagnostic, void* userData)
+{
+    std::string& text = *(std::string*)userData;
+    text.append(diagnostic.text.begin(), diagnostic.text.end());
+    text += '\n';
+}
+
+DownstreamCompileOptions TestContext::getCompileOptions(IArtifact* const* source)
+{
+    DownstreamCompileOptions options;
+    options.sourceLanguage = SLANG_SOURCE_LANGUAGE_CPP;
+    options.targetType = SLANG_HOST_CALLABLE;
+    options.sourceArtifacts = Slice<IArtifact*>(source, 1);
+    return options;
+}
+
+ComPtr<IArtifact> TestContext::createSource(const char* source)
+{
+    auto artifact = ArtifactUtil::createArtifact(ArtifactDesc::make(ArtifactKind::Source, ArtifactPayload::Cpp));
+    artifact->addRepresentationUnknown(RawBlob::create(source, ::strlen(source)));
+    return artifact;
+}
+
+SlangResult TestContext::compile(const char* source, const LLVMCompileOptions& llvmOptions, IArtifact** outArtifact, std::string* outDiagnostics)
+{
+    ComPtr<IArtifact> sourceArtifact = createSource(source);
+    IArtifact* sourceArtifacts[] = { sourceArtifact };
+
+    LLVMCompileOptions options = llvmOptions;
+    if (outDiagnostics && !options.diagnosticCallback)
+    {
+        options.diagnosticCallback = &_appendDiagnostic;
+        options.diagnosticCallbackUserData = outDiagnostics;
+    }
+
+    return getCompiler<ILLVMDownstreamCompiler>()->compileWithOptions(getCompileOptions(sourceArtifacts), options, outArtifact);
+}
+
+SlangResult TestContext::compile(const char* source, IArtifact** outArtifact)
+{
+    return compile(source, LLVMCompileOptions(), outArtifact);
+}
+
+SlangResult TestContext::compileSum(const LLVMCompileOptions& llvmOptions, IArtifact** outArtifact)
+{
+    return compile(kSumSource, llvmOptions, outArtifact);
+}
+
+SlangResult TestContext::compileSum(DownstreamCompileOptions::OptimizationLevel optimizationLevel, const LLVMCompileOptions& llvmOptions, IArtifact** outArtifact)
+{
+    ComPtr<IArtifact> sourceArtifact = createSource(kSumSource);
+    IArtifact* sourceArtifacts[] = { sourceArtifact };
+
+    DownstreamCompileOptions options = getCompileOptions(sourceArtifacts);
+    options.optimizationLevel = optimizationLevel;
+
+    return getCompiler<ILLVMDownstreamCompiler>()->compileWithOptions(options, llvmOptions, outArtifact);
+}
+
+bool TestContext::checkSum(IArtifact* artifact, const char* name, int scale)
+{
+    int values[100];
+    for (int i = 0; i < 100; ++i)
+    {
+        values[i] = i;
+    }
+    auto func = (SumFunc)findSymbol(artifact, name);
+    return func && func(values, 100) == scale * 4950;
+}
+
+ILLVMJITSharedLibrary* TestContext::getJITSharedLibrary(IArtifact* artifact)
+{
+    ComPtr<ISlangSharedLibrary> sharedLibrary;
+    if (!artifact || SLANG_FAILED(artifact->loadSharedLibrary(ArtifactKeep::Yes, sharedLibrary.writeRef())))
+    {
+        return nullptr;
+    }
+    // The artifact keeps the library, so it remains in scope
+    return (ILLVMJITSharedLibrary*)sharedLibrary->castAs(ILLVMJITSharedLibrary::getTypeGuid());
+}
+
+std::string TestContext::getRepresentationText(IArtifact* artifact, LLVMRepresentation representation)
+{
+    auto sharedLibrary = getJITSharedLibrary(artifact);
+    ComPtr<ISlangBlob> blob;
+    if (!sharedLibrary || SLANG_FAILED(sharedLibrary->getRepresentation(representation, blob.writeRef())) || !blob)
+    {
+        return std::string();
+    }
+    return std::string((const char*)blob->getBufferPointer(), blob->getBufferSize());
+}
+
+std::string TestContext::getDiagnosticText(IArtifact* artifact)
+{
+    std::string text;
+    auto diagnostics = artifact ? (IArtifactDiagnostics*)artifact->findAssociated(IArtifactDiagnostics::getTypeGuid()) : nullptr;
+    if (diagnostics)
+    {
+        for (Index i = 0; i < diagnostics->getCount(); ++i)
+        {
+            _appendDiagnostic(*diagnostics->getAt(i), &text);
+        }
+    }
+    return text;
+}
+
+void* TestContext::findSymbol(IArtifact* artifact, const char* name)
+{
+    ILLVMJITSharedLibrary* sharedLibrary = getJITSharedLibrary(artifact);
+    return sharedLibrary ? sharedLibrary->findSymbolAddressByName(name) : nullptr;
+}
+
+void TestContext::addFailure(const char* file, int line, const char* expression)
+{
+    fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+    m_failureCount++;
+}
+
+} // namespace slang_llvm_test
+
+namespace { // anonymous
+
+typedef SlangResult (*CreateCompilerFunc)(const SlangUUID& intfGuid, Slang::IDownstreamCompiler** out);
+
+CreateCompilerFunc _loadCreateCompiler(const char* libraryPath)
+{
+    const char* const name = "createLLVMDownstreamCompiler_V4";
+#if SLANG_WINDOWS_FAMILY
+    HMODULE module = LoadLibraryA(libraryPath);
+    return module ? (CreateCompilerFunc)GetProcAddress(module, name) : nullptr;
+#else
+    void* module = dlopen(libraryPath, RTLD_NOW | RTLD_LOCAL);
+    return module ? (CreateCompilerFunc)dlsym(module, name) : nullptr;
+#endif
+}
+
+bool _isSelected(const char* name, int argc, const char** argv)
+{
+    if (argc <= 2)
+    {
+        return true;
+    }
+    for (int i = 2; i < argc; ++i)
+    {
+        if (::strncmp(name, argv[i], ::strlen(argv[i])) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // anonymous
+
+int main(int argc, const char** argv)
+{
+    using namespace slang_llvm_test;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: slang-llvm-test <slang-llvm library path> [test name prefix...]\n");
+        return 1;
+    }
+
+    const auto createCompiler = _loadCreateCompiler(argv[1]);
+    if (!createCompiler)
+    {
+        fprintf(stderr, "slang-llvm-test: unable to load '%s'\n", argv[1]);
+        return 1;
+    }
+
+    // Run the tests in name order, so the output doesn't depend on link order
+    std::vector<TestRegistration*> tests;
+    for (TestRegistration* test = TestRegistration::s_first; test; test = test->next)
+    {
+        if (_isSelected(test->name, argc, argv))
+        {
+            tests.push_back(test);
+        }
+    }
+    std::sort(tests.begin(), tests.end(), [](const TestRegistration* a, const TestRegistration* b) { return ::strcmp(a->name, b->name) < 0; });
+
+    int failedCount = 0;
+    for (TestRegistration* test : tests)
+    {
+        // Each test gets its own compiler, so state such as registered symbols doesn't leak between tests
+        Slang::ComPtr<Slang::IDownstreamCompiler> compiler;
+        if (SLANG_FAILED(createCompiler(Slang::IDownstreamCompiler::getTypeGuid(), compiler.writeRef())))
+        {
+            fprintf(stderr, "slang-llvm-test: unable to create compiler\n");
+            return 1;
+        }
+
+        TestContext context(compiler);
+        test->func(&context);
+
+        const bool passed = context.getFailureCount() == 0;
+        printf("%s: %s\n", passed ? "passed" : "FAILED", test->name);
+        failedCount += passed ? 0 : 1;
+    }
+
+    printf("%d of %d tests passed\n", int(tests.size()) - failedCount, int(tests.size()));
+    return failedCount ? 1 : 0;
+}
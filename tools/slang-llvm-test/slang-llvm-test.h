@@ -0,0 +1,107 @@
+#ifndef SLANG_LLVM_TEST_H
+#define SLANG_LLVM_TEST_H
+
+// A minimal test harness for slang-llvm. Tests are registered with SLANG_LLVM_TEST, and compile source through the
+// slang-llvm shared library in the same way as Slang does.
+
+#include <slang.h>
+#include <slang-com-helper.h>
+#include <slang-com-ptr.h>
+
+#include <compiler-core/slang-downstream-compiler.h>
+
+#include "slang-llvm.h"
+
+#include <string>
+
+namespace slang_llvm_test {
+
+// Source defining sum, which adds up its values with a loop that can be vectorized
+extern const char kSumSource[];
+
+typedef int (*SumFunc)(const int* values, int count);
+
+/* The state shared by the tests. A failed check is recorded, and the test keeps running. */
+class TestContext
+{
+public:
+        /// Compile source with llvmOptions. If outDiagnostics is set it receives the text of the diagnostics, one per line.
+        /// If llvmOptions has a diagnostic callback outDiagnostics isn't changed.
+    SlangResult compile(const char* source, const slang_llvm::LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifact, std::string* outDiagnostics = nullptr);
+        /// Compile source with the default options
+    SlangResult compile(const char* source, Slang::IArtifact** outArtifact);
+
+        /// Compile kSumSource with llvmOptions
+    SlangResult compileSum(const slang_llvm::LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifact);
+        /// Compile kSumSource with llvmOptions at the optimization level
+    SlangResult compileSum(Slang::DownstreamCompileOptions::OptimizationLevel optimizationLevel, const slang_llvm::LLVMCompileOptions& llvmOptions, Slang::IArtifact** outArtifact);
+        /// Returns true if the function called name in artifact, which is declared as SumFunc, returns scale times the sum
+        /// of the values 0 to 99
+    static bool checkSum(Slang::IArtifact* artifact, const char* name = "sum", int scale = 1);
+
+        /// Compile options for source, which must be kept in scope while the options are used
+    static Slang::DownstreamCompileOptions getCompileOptions(Slang::IArtifact* const* source);
+
+        /// Create an artifact holding the C++ source
+    static Slang::ComPtr<Slang::IArtifact> createSource(const char* source);
+
+        /// Get the address of the symbol called name in the shared library of artifact. nullptr if there isn't one.
+    static void* findSymbol(Slang::IArtifact* artifact, const char* name);
+        /// Get the text of the diagnostics associated with artifact, one per line
+    static std::string getDiagnosticText(Slang::IArtifact* artifact);
+        /// Get the JIT shared library of artifact, or nullptr if it didn't compile
+    static slang_llvm::ILLVMJITSharedLibrary* getJITSharedLibrary(Slang::IArtifact* artifact);
+        /// Get the representation of artifact as a string, which is empty if it isn't available
+    static std::string getRepresentationText(Slang::IArtifact* artifact, slang_llvm::LLVMRepresentation representation);
+
+        /// Get an interface of the compiler. The reference isn't added to.
+    template <typename T>
+    T* getCompiler() { return (T*)m_compiler->castAs(T::getTypeGuid()); }
+
+    Slang::IDownstreamCompiler* getDownstreamCompiler() const { return m_compiler; }
+        /// Release the contexts reference to the compiler. The compiler can't be used by the context afterwards.
+    void releaseCompiler() { m_compiler.setNull(); }
+
+        /// Record that the check of expression at file and line failed
+    void addFailure(const char* file, int line, const char* expression);
+
+    int getFailureCount() const { return m_failureCount; }
+
+    TestContext(Slang::IDownstreamCompiler* compiler):
+        m_compiler(compiler)
+    {
+    }
+
+protected:
+    Slang::ComPtr<Slang::IDownstreamCompiler> m_compiler;
+    int m_failureCount = 0;
+};
+
+typedef void (*TestFunc)(TestContext* context);
+
+/* Registers a test when constructed. Only used via SLANG_LLVM_TEST. */
+struct TestRegistration
+{
+    TestRegistration(const char* name, TestFunc func);
+
+    const char* name;
+    TestFunc func;
+    TestRegistration* next;
+
+        /// The first of the linked list of registered tests
+    static TestRegistration* s_first;
+};
+
+} // namespace slang_llvm_test
+
+// Defines a test called name. The body can use 'context' and SLANG_LLVM_CHECK.
+#define SLANG_LLVM_TEST(name) \
+    static void name(slang_llvm_test::TestContext* context); \
+    static slang_llvm_test::TestRegistration name##Registration(#name, &name); \
+    static void name(slang_llvm_test::TestContext* context)
+
+// Records a failure if x is false
+#define SLANG_LLVM_CHECK(x) \
+    do { if (!(x)) { context->addFailure(__FILE__, __LINE__, #x); } } while (0)
+
+#endif
@@ -0,0 +1,94 @@
+// Tests of compiling on the compilers worker threads with ILLVMAsyncDownstreamCompiler.
+
+#include "slang-llvm-test.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kMulSource[] = R"(
+extern "C" int mul(int a, int b) { return a * b; }
+)";
+
+typedef int (*MulFunc)(int a, int b);
+
+static void _countCompletion(ILLVMCompileTask* task, void* userData)
+{
+    SLANG_UNUSED(task);
+    ++*(std::atomic<int>*)userData;
+}
+
+SLANG_LLVM_TEST(asyncCompile)
+{
+    auto compiler = context->getCompiler<ILLVMAsyncDownstreamCompiler>();
+
+    ComPtr<IArtifact> source = TestContext::createSource(kMulSource);
+    IArtifact* sourceArtifacts[] = { source };
+
+    // More tasks than there are likely to be threads, so some are queued
+    const int taskCount = 32;
+    ComPtr<ILLVMCompileTask> tasks[taskCount];
+    std::atomic<int> completedCount{ 0 };
+    for (int i = 0; i < taskCount; ++i)
+    {
+        const auto priority = (i & 1) ? LLVMCompilePriority::Background : LLVMCompilePriority::Normal;
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(compiler->compileAsync(TestContext::getCompileOptions(sourceArtifacts), LLVMCompileOptions(), priority, tasks[i].writeRef())));
+        if (tasks[i])
+        {
+            tasks[i]->setCompletionCallback(&_countCompletion, &completedCount);
+        }
+    }
+
+    for (auto& task : tasks)
+    {
+        if (!task)
+        {
+            continue;
+        }
+        task->wait();
+        SLANG_LLVM_CHECK(task->isComplete());
+
+        ComPtr<IArtifact> artifact;
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(task->getResult(artifact.writeRef())));
+        auto mul = (MulFunc)TestContext::findSymbol(artifact, "mul");
+        SLANG_LLVM_CHECK(mul && mul(6, 7) == 42);
+    }
+    SLANG_LLVM_CHECK(completedCount == taskCount);
+}
+
+SLANG_LLVM_TEST(asyncCompileOutlivesCompiler)
+{
+    ComPtr<ILLVMAsyncDownstreamCompiler> compiler(context->getCompiler<ILLVMAsyncDownstreamCompiler>());
+
+    ComPtr<IArtifact> source = TestContext::createSource(kMulSource);
+    IArtifact* sourceArtifacts[] = { source };
+
+    std::atomic<int> completedCount{ 0 };
+    {
+        ComPtr<ILLVMCompileTask> task;
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(compiler->compileAsync(TestContext::getCompileOptions(sourceArtifacts), LLVMCompileOptions(), LLVMCompilePriority::Normal, task.writeRef())));
+        if (!task)
+        {
+            return;
+        }
+        task->setCompletionCallback(&_countCompletion, &completedCount);
+    }
+
+    // Only the queued task references the compiler now, so it's destroyed by the worker thread that runs the task
+    compiler.setNull();
+    context->releaseCompiler();
+
+    const auto start = std::chrono::steady_clock::now();
+    while (completedCount == 0 && std::chrono::steady_clock::now() - start < std::chrono::seconds(60))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    SLANG_LLVM_CHECK(completedCount == 1);
+
+    // Give the worker thread time to destroy the compiler. It would abort if it tried to join itself.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
@@ -0,0 +1,108 @@
+// Tests of ILLVMAutotuneDownstreamCompiler, and of reusing the configuration it finds.
+
+#include "slang-llvm-test.h"
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// With fast floating point the additions are reassociated away, so cancel(1) is 1. Otherwise it's 0.
+static const char kCancelSource[] = R"(
+extern "C" float cancel(float value) { return (value + 1e20f) - 1e20f; }
+)";
+
+typedef float (*CancelFunc)(float value);
+
+// Scores each variant by the order it's benchmarked in, such that the last is the fastest
+static double _benchmarkLastIsFastest(void* func, void* userData)
+{
+    int& callCount = *(int*)userData;
+    callCount++;
+    return func ? 1.0 / callCount : -1.0;
+}
+
+static float _callCancel(IArtifact* artifact)
+{
+    auto cancel = (CancelFunc)TestContext::findSymbol(artifact, "cancel");
+    return cancel ? cancel(1.0f) : -1.0f;
+}
+
+// Autotunes kCancelSource with options, trying a precise and then a fast configuration, so the fast one wins
+static SlangResult _autotuneCancel(TestContext* context, const DownstreamCompileOptions& options, LLVMTuningConfig& outConfig)
+{
+    LLVMTuningConfig configs[2];
+    configs[0].optimizationLevel = LLVMTuningConfig::OptimizationLevel::Default;
+    configs[0].floatingPointMode = LLVMTuningConfig::FloatingPointMode::Precise;
+    configs[1].optimizationLevel = LLVMTuningConfig::OptimizationLevel::Default;
+    configs[1].floatingPointMode = LLVMTuningConfig::FloatingPointMode::Fast;
+
+    int callCount = 0;
+
+    LLVMAutotuneDesc desc;
+    desc.entryPointName = "cancel";
+    desc.benchmark = &_benchmarkLastIsFastest;
+    desc.benchmarkUserData = &callCount;
+    desc.configs = configs;
+    desc.configCount = 2;
+
+    ComPtr<IArtifact> artifact;
+    return context->getCompiler<ILLVMAutotuneDownstreamCompiler>()->autotune(options, desc, artifact.writeRef(), &outConfig);
+}
+
+SLANG_LLVM_TEST(autotunePicksFastest)
+{
+    ComPtr<IArtifact> source = TestContext::createSource(kCancelSource);
+    IArtifact* sourceArtifacts[] = { source };
+
+    LLVMTuningConfig config;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_autotuneCancel(context, TestContext::getCompileOptions(sourceArtifacts), config)));
+    SLANG_LLVM_CHECK(config.floatingPointMode == LLVMTuningConfig::FloatingPointMode::Fast);
+}
+
+SLANG_LLVM_TEST(autotuneReuseIsOptIn)
+{
+    ComPtr<IArtifact> source = TestContext::createSource(kCancelSource);
+    IArtifact* sourceArtifacts[] = { source };
+
+    LLVMTuningConfig config;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_autotuneCancel(context, TestContext::getCompileOptions(sourceArtifacts), config)));
+
+    // Without asking for it, the configuration found isn't used
+    ComPtr<IArtifact> plain;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCancelSource, plain.writeRef())));
+    SLANG_LLVM_CHECK(_callCancel(plain) == 0.0f);
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.useAutotunedConfig = true;
+
+    ComPtr<IArtifact> tuned;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCancelSource, llvmOptions, tuned.writeRef())));
+    SLANG_LLVM_CHECK(_callCancel(tuned) == 1.0f);
+
+    // Different options produce different code, so don't use it
+    llvmOptions.instrumentFunctions = true;
+
+    ComPtr<IArtifact> instrumented;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCancelSource, llvmOptions, instrumented.writeRef())));
+    SLANG_LLVM_CHECK(_callCancel(instrumented) == 0.0f);
+}
+
+SLANG_LLVM_TEST(autotuneKeepsPrecise)
+{
+    ComPtr<IArtifact> source = TestContext::createSource(kCancelSource);
+    IArtifact* sourceArtifacts[] = { source };
+
+    DownstreamCompileOptions options = TestContext::getCompileOptions(sourceArtifacts);
+    options.floatingPointMode = DownstreamCompileOptions::FloatingPointMode::Precise;
+
+    LLVMTuningConfig config;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_autotuneCancel(context, options, config)));
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.useAutotunedConfig = true;
+
+    // Precise was asked for, so is used even though the fast configuration won
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMDownstreamCompiler>()->compileWithOptions(options, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(_callCancel(artifact) == 0.0f);
+}
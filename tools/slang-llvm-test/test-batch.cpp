@@ -0,0 +1,66 @@
+// Tests of compiling a batch of programs with ILLVMBatchDownstreamCompiler.
+
+#include "slang-llvm-test.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+typedef int (*ValueFunc)();
+
+SLANG_LLVM_TEST(batchCompile)
+{
+    // Each program defines the same name, so each must be in its own JITDylib
+    const int count = 8;
+    std::vector<ComPtr<IArtifact>> sources;
+    for (int i = 0; i < count; ++i)
+    {
+        char source[100];
+        snprintf(source, sizeof(source), "extern \"C\" int value() { return %d; }", i * 10);
+        sources.push_back(TestContext::createSource(source));
+    }
+    // One that fails, which shouldn't stop the others
+    sources.push_back(TestContext::createSource("extern \"C\" int value() { return undefinedValue; }"));
+
+    std::vector<IArtifact*> sourceArtifacts;
+    std::vector<DownstreamCompileOptions> options;
+    for (auto& source : sources)
+    {
+        sourceArtifacts.push_back(source);
+    }
+    for (auto& sourceArtifact : sourceArtifacts)
+    {
+        options.push_back(TestContext::getCompileOptions(&sourceArtifact));
+    }
+
+    std::vector<IArtifact*> artifacts(options.size(), nullptr);
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMBatchDownstreamCompiler>()->compileBatch(options.data(), Count(options.size()), LLVMCompileOptions(), artifacts.data())));
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto value = (ValueFunc)TestContext::findSymbol(artifacts[i], "value");
+        SLANG_LLVM_CHECK(value && value() == i * 10);
+    }
+
+    IArtifact* failed = artifacts[count];
+    SLANG_LLVM_CHECK(failed && !TestContext::getJITSharedLibrary(failed));
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(failed).find("undefinedValue") != std::string::npos);
+
+    for (auto artifact : artifacts)
+    {
+        if (artifact)
+        {
+            artifact->release();
+        }
+    }
+}
+
+SLANG_LLVM_TEST(batchCompileEmpty)
+{
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMBatchDownstreamCompiler>()->compileBatch(nullptr, 0, LLVMCompileOptions(), nullptr)));
+}
@@ -0,0 +1,74 @@
+// Tests of cancellation and time budgets.
+
+#include "slang-llvm-test.h"
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kSubSource[] = R"(
+extern "C" int sub(int a, int b) { return a - b; }
+)";
+
+typedef int (*SubFunc)(int a, int b);
+
+SLANG_LLVM_TEST(budgetCancelled)
+{
+    ComPtr<ILLVMCancellationToken> token;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMDownstreamCompiler>()->createCancellationToken(token.writeRef())));
+    if (!token)
+    {
+        return;
+    }
+    token->cancel();
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.cancellationToken = token;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSubSource, llvmOptions, artifact.writeRef())));
+    const std::string diagnostics = TestContext::getDiagnosticText(artifact);
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+    SLANG_LLVM_CHECK(diagnostics.find("cancelled") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(budgetExceededFails)
+{
+    // Far less than any compilation takes
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.timeBudgetInMs = 1;
+    llvmOptions.budgetExceededAction = LLVMCompileOptions::BudgetExceededAction::Fail;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSubSource, llvmOptions, artifact.writeRef())));
+    const std::string diagnostics = TestContext::getDiagnosticText(artifact);
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+    SLANG_LLVM_CHECK(diagnostics.find("time budget") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(budgetExceededReducesOptimization)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.timeBudgetInMs = 1;
+    llvmOptions.budgetExceededAction = LLVMCompileOptions::BudgetExceededAction::ReduceOptimization;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSubSource, llvmOptions, artifact.writeRef())));
+    const std::string diagnostics = TestContext::getDiagnosticText(artifact);
+
+    auto sub = (SubFunc)TestContext::findSymbol(artifact, "sub");
+    SLANG_LLVM_CHECK(sub && sub(5, 7) == -2);
+    SLANG_LLVM_CHECK(diagnostics.find("optimization was reduced") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(budgetNotExceeded)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.timeBudgetInMs = 60 * 1000;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSubSource, llvmOptions, artifact.writeRef())));
+
+    auto sub = (SubFunc)TestContext::findSymbol(artifact, "sub");
+    SLANG_LLVM_CHECK(sub && sub(7, 5) == 2);
+}
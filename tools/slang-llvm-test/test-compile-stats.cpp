@@ -0,0 +1,101 @@
+// Tests of LLVMCompileOptions::compileStats, which reports the size of each function's IR and machine code.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// Gets the stats of the function called name in artifact. Returns false if there are none.
+static bool _findFunctionStats(IArtifact* artifact, const char* name, LLVMFunctionCompileStats& outStats)
+{
+    // The stats are the representation of the only associated artifact
+    auto statsArtifact = artifact ? (IArtifact*)artifact->findAssociated(IArtifact::getTypeGuid()) : nullptr;
+    auto stats = statsArtifact ? (ILLVMCompileStats*)statsArtifact->findRepresentation(ILLVMCompileStats::getTypeGuid()) : nullptr;
+    if (!stats)
+    {
+        return false;
+    }
+
+    for (Index i = 0; i < stats->getFunctionCount(); ++i)
+    {
+        if (SLANG_SUCCEEDED(stats->getFunctionAt(i, &outStats)) && std::string(outStats.name) == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Checks artifact has the stats of sum, including those only known once its code is generated
+static void _checkSumStats(TestContext* context, IArtifact* artifact)
+{
+    LLVMFunctionCompileStats stats;
+    SLANG_LLVM_CHECK(_findFunctionStats(artifact, "sum", stats));
+    SLANG_LLVM_CHECK(stats.instructionCount > 0 && stats.basicBlockCount > 0);
+    SLANG_LLVM_CHECK(stats.loopCount >= 1);
+    SLANG_LLVM_CHECK(stats.codeSize > 0);
+}
+
+SLANG_LLVM_TEST(compileStatsInProcess)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileStats = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    _checkSumStats(context, artifact);
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+}
+
+SLANG_LLVM_TEST(compileStatsOutOfProcess)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileStats = true;
+    llvmOptions.compileOutOfProcess = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    _checkSumStats(context, artifact);
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+}
+
+SLANG_LLVM_TEST(compileStatsReducedOptimization)
+{
+    // The stats are of the code the JIT generates with reduced optimization
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileStats = true;
+    llvmOptions.timeBudgetInMs = 1;
+    llvmOptions.budgetExceededAction = LLVMCompileOptions::BudgetExceededAction::ReduceOptimization;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("optimization was reduced") != std::string::npos);
+    _checkSumStats(context, artifact);
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+}
+
+SLANG_LLVM_TEST(compileStatsMultiversion)
+{
+    // The variants must still be selected when the stats are gathered
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileStats = true;
+    llvmOptions.multiversionLevels =
+        LLVMCompileOptions::MultiversionLevel::X86_64_V2 |
+        LLVMCompileOptions::MultiversionLevel::X86_64_V3 |
+        LLVMCompileOptions::MultiversionLevel::X86_64_V4;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+    LLVMFunctionCompileStats stats;
+    SLANG_LLVM_CHECK(_findFunctionStats(artifact, "sum", stats));
+
+#if SLANG_PROCESSOR_X86_64
+    // Each variant is a function of its own
+    SLANG_LLVM_CHECK(_findFunctionStats(artifact, "sum.x86-64-v3", stats) && stats.codeSize > 0);
+#endif
+}
@@ -0,0 +1,172 @@
+// Tests of compiling with IDownstreamCompiler and ILLVMDownstreamCompiler, and of profile guided optimization.
+
+#include "slang-llvm-test.h"
+
+#include <core/slang-blob.h>
+
+#include <string.h>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kAddSource[] = R"(
+extern "C" int add(int a, int b) { return a + b; }
+)";
+
+// Has a branch, so instrumentation adds counters. Counting the clamped values keeps it a branch when optimized, rather
+// than a min.
+static const char kClampSource[] = R"(
+extern "C" { int clampedCount = 0; }
+extern "C" int clampToTen(int value)
+{
+    if (value > 10)
+    {
+        ++clampedCount;
+        return 10;
+    }
+    return value;
+}
+)";
+
+typedef int (*AddFunc)(int a, int b);
+typedef int (*ClampFunc)(int value);
+
+SLANG_LLVM_TEST(compilePlain)
+{
+    auto compiler = context->getDownstreamCompiler();
+
+    ComPtr<IArtifact> source = TestContext::createSource(kAddSource);
+    IArtifact* sourceArtifacts[] = { source };
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(compiler->compile(TestContext::getCompileOptions(sourceArtifacts), artifact.writeRef())));
+
+    auto add = (AddFunc)TestContext::findSymbol(artifact, "add");
+    SLANG_LLVM_CHECK(add && add(2, 3) == 5);
+}
+
+SLANG_LLVM_TEST(compileWithDefaultOptions)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kAddSource, artifact.writeRef())));
+
+    auto add = (AddFunc)TestContext::findSymbol(artifact, "add");
+    SLANG_LLVM_CHECK(add && add(-2, 3) == 1);
+}
+
+SLANG_LLVM_TEST(compileReportsErrors)
+{
+    ComPtr<IArtifact> artifact;
+    std::string diagnostics;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile("extern \"C\" int broken( { return 0; }", LLVMCompileOptions(), artifact.writeRef(), &diagnostics)));
+
+    // The failure is reported by the artifact, which has no code
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+    SLANG_LLVM_CHECK(!diagnostics.empty());
+}
+
+SLANG_LLVM_TEST(compileOptionsNewerVersion)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.version = LLVMCompileOptions::kVersion + 1;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(context->compile(kAddSource, llvmOptions, artifact.writeRef()) == SLANG_E_NOT_IMPLEMENTED);
+    SLANG_LLVM_CHECK(!artifact);
+}
+
+SLANG_LLVM_TEST(profileRoundTrip)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.profileMode = LLVMCompileOptions::ProfileMode::Instrument;
+    llvmOptions.keepRepresentations = true;
+
+    ComPtr<IArtifact> instrumented;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kClampSource, llvmOptions, instrumented.writeRef())));
+
+    auto clamp = (ClampFunc)TestContext::findSymbol(instrumented, "clampToTen");
+    SLANG_LLVM_CHECK(clamp);
+    if (!clamp)
+    {
+        return;
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        SLANG_LLVM_CHECK(clamp(i) == (i > 10 ? 10 : i));
+    }
+
+    ComPtr<ISlangBlob> profile;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(TestContext::getJITSharedLibrary(instrumented)->writeProfile(profile.writeRef())));
+    SLANG_LLVM_CHECK(profile && profile->getBufferSize() > 0);
+    if (!profile)
+    {
+        return;
+    }
+    const char* profileText = (const char*)profile->getBufferPointer();
+    SLANG_LLVM_CHECK(::strncmp(profileText, "slang-llvm-profile", ::strlen("slang-llvm-profile")) == 0);
+    // Every call was counted
+    SLANG_LLVM_CHECK(std::string(profileText, profile->getBufferSize()).find("function clampToTen 100 ") != std::string::npos);
+
+    ComPtr<IArtifact> optimized;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMDownstreamCompiler>()->recompileWithProfile(instrumented, profile, optimized.writeRef())));
+
+    auto optimizedClamp = (ClampFunc)TestContext::findSymbol(optimized, "clampToTen");
+    SLANG_LLVM_CHECK(optimizedClamp && optimizedClamp(5) == 5 && optimizedClamp(50) == 10);
+
+    // The profile was applied. 89 of the values were clamped, and 11 weren't (the order depends on how the optimized
+    // branch tests the value).
+    const std::string ir = TestContext::getRepresentationText(optimized, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("!\"function_entry_count\", i64 100}") != std::string::npos);
+    SLANG_LLVM_CHECK(ir.find("!\"branch_weights\", i32 89, i32 11}") != std::string::npos || ir.find("!\"branch_weights\", i32 11, i32 89}") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(profileRecompileKeepsOptions)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.profileMode = LLVMCompileOptions::ProfileMode::Instrument;
+    llvmOptions.multiversionLevels =
+        LLVMCompileOptions::MultiversionLevel::X86_64_V2 |
+        LLVMCompileOptions::MultiversionLevel::X86_64_V3;
+    llvmOptions.keepRepresentations = true;
+
+    ComPtr<IArtifact> instrumented;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, instrumented.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(instrumented));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(instrumented);
+    ComPtr<ISlangBlob> profile;
+    SLANG_LLVM_CHECK(sharedLibrary && SLANG_SUCCEEDED(sharedLibrary->writeProfile(profile.writeRef())));
+    if (!profile)
+    {
+        return;
+    }
+
+    ComPtr<IArtifact> optimized;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMDownstreamCompiler>()->recompileWithProfile(instrumented, profile, optimized.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(optimized));
+
+    // Only the profile mode differs, so the representations are still kept, and the code is still multiversioned
+    const std::string ir = TestContext::getRepresentationText(optimized, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("define") != std::string::npos);
+#if SLANG_PROCESSOR_X86_64
+    SLANG_LLVM_CHECK(ir.find("@__slang_llvm_multiversion_init()") != std::string::npos);
+    SLANG_LLVM_CHECK(ir.find("\"target-cpu\"=\"x86-64-v3\"") != std::string::npos);
+#endif
+}
+
+SLANG_LLVM_TEST(profileInvalidData)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.profileMode = LLVMCompileOptions::ProfileMode::Instrument;
+
+    ComPtr<IArtifact> instrumented;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kClampSource, llvmOptions, instrumented.writeRef())));
+
+    const char invalidProfile[] = "not a profile";
+    ComPtr<ISlangBlob> profile = RawBlob::create(invalidProfile, sizeof(invalidProfile) - 1);
+
+    ComPtr<IArtifact> optimized;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMDownstreamCompiler>()->recompileWithProfile(instrumented, profile, optimized.writeRef())));
+    SLANG_LLVM_CHECK(optimized && !TestContext::getJITSharedLibrary(optimized));
+}
@@ -0,0 +1,106 @@
+// Tests of streaming diagnostics to a callback, and of the error limit.
+
+#include "slang-llvm-test.h"
+
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kWarningSource[] = R"(
+#warning "first warning"
+#warning "second warning"
+extern "C" int one() { return 1; }
+)";
+
+static const char kManyErrorsSource[] = R"(
+extern "C" int a() { return undefinedA; }
+extern "C" int b() { return undefinedB; }
+extern "C" int c() { return undefinedC; }
+extern "C" int d() { return undefinedD; }
+extern "C" int e() { return undefinedE; }
+)";
+
+struct RecordedDiagnostic
+{
+    ArtifactDiagnostic::Severity severity;
+    std::string text;
+};
+
+static void _recordDiagnostic(const ArtifactDiagnostic& diagnostic, void* userData)
+{
+    RecordedDiagnostic recorded;
+    recorded.severity = diagnostic.severity;
+    recorded.text.assign(diagnostic.text.begin(), diagnostic.text.end());
+    ((std::vector<RecordedDiagnostic>*)userData)->push_back(recorded);
+}
+
+static Count _countSeverity(const std::vector<RecordedDiagnostic>& diagnostics, ArtifactDiagnostic::Severity severity)
+{
+    Count count = 0;
+    for (const auto& diagnostic : diagnostics)
+    {
+        count += (diagnostic.severity == severity) ? 1 : 0;
+    }
+    return count;
+}
+
+SLANG_LLVM_TEST(diagnosticsStreamed)
+{
+    std::vector<RecordedDiagnostic> recorded;
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.diagnosticCallback = &_recordDiagnostic;
+    llvmOptions.diagnosticCallbackUserData = &recorded;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kWarningSource, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::findSymbol(artifact, "one"));
+
+    SLANG_LLVM_CHECK(_countSeverity(recorded, ArtifactDiagnostic::Severity::Warning) == 2);
+    SLANG_LLVM_CHECK(recorded.size() >= 2 && recorded[0].text.find("first warning") != std::string::npos);
+
+    // When streaming, warnings aren't kept by the artifact
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("warning") == std::string::npos);
+}
+
+SLANG_LLVM_TEST(diagnosticsKeptWithoutCallback)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kWarningSource, artifact.writeRef())));
+
+    const std::string text = TestContext::getDiagnosticText(artifact);
+    SLANG_LLVM_CHECK(text.find("first warning") != std::string::npos);
+    SLANG_LLVM_CHECK(text.find("second warning") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(diagnosticsErrorLimit)
+{
+    std::vector<RecordedDiagnostic> unlimited;
+    {
+        LLVMCompileOptions llvmOptions;
+        llvmOptions.diagnosticCallback = &_recordDiagnostic;
+        llvmOptions.diagnosticCallbackUserData = &unlimited;
+
+        ComPtr<IArtifact> artifact;
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kManyErrorsSource, llvmOptions, artifact.writeRef())));
+        SLANG_LLVM_CHECK(!TestContext::getJITSharedLibrary(artifact));
+    }
+    SLANG_LLVM_CHECK(_countSeverity(unlimited, ArtifactDiagnostic::Severity::Error) == 5);
+
+    std::vector<RecordedDiagnostic> limited;
+    {
+        LLVMCompileOptions llvmOptions;
+        llvmOptions.diagnosticCallback = &_recordDiagnostic;
+        llvmOptions.diagnosticCallbackUserData = &limited;
+        llvmOptions.errorLimit = 2;
+
+        ComPtr<IArtifact> artifact;
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kManyErrorsSource, llvmOptions, artifact.writeRef())));
+        SLANG_LLVM_CHECK(!TestContext::getJITSharedLibrary(artifact));
+    }
+    // The front end stops after the limit (and reports that it has)
+    const Count limitedErrorCount = _countSeverity(limited, ArtifactDiagnostic::Severity::Error);
+    SLANG_LLVM_CHECK(limitedErrorCount >= 2 && limitedErrorCount < 5);
+}
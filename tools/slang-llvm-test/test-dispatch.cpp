@@ -0,0 +1,191 @@
+// Tests of ILLVMJITSharedLibrary::dispatch, including dispatches made concurrently and from within a dispatch.
+
+#include "slang-llvm-test.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// Counts each group it's called for, and calls the callback (if any) for each
+static const char kCountSource[] = R"(
+struct VaryingInput
+{
+    unsigned startGroupID[3];
+    unsigned endGroupID[3];
+};
+
+struct Params
+{
+    int* counts;
+    unsigned width;
+    void (*callback)(void* userData);
+    void* callbackUserData;
+};
+
+extern "C" void count(VaryingInput* input, void* entryPointParams, void* globalParams)
+{
+    const Params* params = (const Params*)globalParams;
+    for (unsigned y = input->startGroupID[1]; y < input->endGroupID[1]; ++y)
+    {
+        for (unsigned x = input->startGroupID[0]; x < input->endGroupID[0]; ++x)
+        {
+            __atomic_fetch_add(&params->counts[y * params->width + x], 1, __ATOMIC_RELAXED);
+            if (params->callback)
+            {
+                params->callback(params->callbackUserData);
+            }
+        }
+    }
+}
+)";
+
+struct CountParams
+{
+    int* counts;
+    uint32_t width;
+    void (*callback)(void* userData);
+    void* callbackUserData;
+};
+
+// Dispatches count over a width by height grid with its own counts, returning true if every group was run once
+static bool _dispatchCount(ILLVMJITSharedLibrary* sharedLibrary, uint32_t width, uint32_t height)
+{
+    std::vector<int> counts(width * height, 0);
+
+    CountParams params = {};
+    params.counts = counts.data();
+    params.width = width;
+
+    LLVMDispatchDesc desc;
+    desc.entryPointName = "count";
+    desc.groupCount[0] = width;
+    desc.groupCount[1] = height;
+    desc.globalParams = &params;
+    desc.threadCount = 4;
+
+    if (SLANG_FAILED(sharedLibrary->dispatch(desc)))
+    {
+        return false;
+    }
+    for (int count : counts)
+    {
+        if (count != 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct NestedContext
+{
+    ILLVMJITSharedLibrary* sharedLibrary;
+    std::atomic<int> failureCount{ 0 };
+};
+
+static void _dispatchNested(void* userData)
+{
+    NestedContext* context = (NestedContext*)userData;
+    if (!_dispatchCount(context->sharedLibrary, 4, 2))
+    {
+        context->failureCount++;
+    }
+}
+
+static ILLVMJITSharedLibrary* _compileCount(TestContext* context, ComPtr<IArtifact>& outArtifact)
+{
+    if (SLANG_FAILED(context->compile(kCountSource, outArtifact.writeRef())))
+    {
+        return nullptr;
+    }
+    return TestContext::getJITSharedLibrary(outArtifact);
+}
+
+SLANG_LLVM_TEST(dispatchRunsEveryGroup)
+{
+    ComPtr<IArtifact> artifact;
+    auto sharedLibrary = _compileCount(context, artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    SLANG_LLVM_CHECK(_dispatchCount(sharedLibrary, 37, 11));
+    SLANG_LLVM_CHECK(_dispatchCount(sharedLibrary, 1, 1));
+}
+
+SLANG_LLVM_TEST(dispatchNested)
+{
+    ComPtr<IArtifact> artifact;
+    auto sharedLibrary = _compileCount(context, artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    NestedContext nested;
+    nested.sharedLibrary = sharedLibrary;
+
+    const uint32_t width = 16, height = 4;
+    std::vector<int> counts(width * height, 0);
+
+    // Every group of the outer dispatch makes a dispatch, which must complete without waiting for the threads
+    CountParams params = {};
+    params.counts = counts.data();
+    params.width = width;
+    params.callback = &_dispatchNested;
+    params.callbackUserData = &nested;
+
+    LLVMDispatchDesc desc;
+    desc.entryPointName = "count";
+    desc.groupCount[0] = width;
+    desc.groupCount[1] = height;
+    desc.globalParams = &params;
+    desc.threadCount = 4;
+
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(sharedLibrary->dispatch(desc)));
+    SLANG_LLVM_CHECK(nested.failureCount == 0);
+    for (int count : counts)
+    {
+        SLANG_LLVM_CHECK(count == 1);
+    }
+}
+
+SLANG_LLVM_TEST(dispatchConcurrent)
+{
+    ComPtr<IArtifact> artifact;
+    auto sharedLibrary = _compileCount(context, artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    // Dispatches from other threads wait for the pool, and must each run all of their groups
+    std::atomic<int> failureCount{ 0 };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int j = 0; j < 10; ++j)
+            {
+                if (!_dispatchCount(sharedLibrary, 64, 8))
+                {
+                    failureCount++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    SLANG_LLVM_CHECK(failureCount == 0);
+}
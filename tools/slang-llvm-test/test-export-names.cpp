@@ -0,0 +1,49 @@
+// Tests of LLVMCompileOptions::exportNames, which internalizes and removes everything that isn't exported.
+
+#include "slang-llvm-test.h"
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// Both functions would be available without export names. unused isn't called by anything.
+static const char kExportSource[] = R"(
+int counter = 0;
+extern "C" int helper(int value) { return value * 3; }
+extern "C" int unused(int value) { return value - 1; }
+extern "C" int api(int value) { counter += value; return helper(value) + counter; }
+)";
+
+typedef int (*IntFunc)(int value);
+
+SLANG_LLVM_TEST(exportNamesRemovesTheRest)
+{
+    const char* exportNames[] = { "api" };
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.exportNames = exportNames;
+    llvmOptions.exportNameCount = 1;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kExportSource, llvmOptions, artifact.writeRef())));
+
+    auto api = (IntFunc)TestContext::findSymbol(artifact, "api");
+    SLANG_LLVM_CHECK(api && api(2) == 8);
+    SLANG_LLVM_CHECK(api && api(2) == 10);
+
+    // Neither is exported, so both are internal, and no longer used once helper is inlined into api
+    SLANG_LLVM_CHECK(TestContext::findSymbol(artifact, "helper") == nullptr);
+    SLANG_LLVM_CHECK(TestContext::findSymbol(artifact, "unused") == nullptr);
+    SLANG_LLVM_CHECK(TestContext::findSymbol(artifact, "counter") == nullptr);
+}
+
+SLANG_LLVM_TEST(exportNamesNone)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kExportSource, artifact.writeRef())));
+
+    auto helper = (IntFunc)TestContext::findSymbol(artifact, "helper");
+    SLANG_LLVM_CHECK(helper && helper(2) == 6);
+    auto unused = (IntFunc)TestContext::findSymbol(artifact, "unused");
+    SLANG_LLVM_CHECK(unused && unused(2) == 1);
+}
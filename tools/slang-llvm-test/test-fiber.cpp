@@ -0,0 +1,136 @@
+// Tests of ILLVMJITSharedLibrary::dispatchGroups, which runs the threads of each group as fibers.
+
+#include "slang-llvm-test.h"
+
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// Each thread writes its index, then after the barrier reads the index written by the thread at the other end of the
+// group, so it's only correct if every thread has reached the barrier.
+static const char kReverseSource[] = R"(
+struct VaryingInput
+{
+    unsigned groupID[3];
+    unsigned groupThreadID[3];
+};
+
+struct Params
+{
+    int* data;
+    int* out;
+    unsigned groupSize;
+};
+
+extern "C" void slang_llvm_groupBarrier();
+
+extern "C" void reverse_Thread(VaryingInput* input, void* entryPointParams, void* globalParams)
+{
+    const Params* params = (const Params*)globalParams;
+    const unsigned base = input->groupID[0] * params->groupSize;
+    const unsigned index = input->groupThreadID[0];
+
+    params->data[base + index] = int(index);
+    slang_llvm_groupBarrier();
+    params->out[base + index] = params->data[base + params->groupSize - 1 - index];
+}
+)";
+
+// Recurses, such that each thread uses a few KiB of its fiber's stack
+static const char kRecurseSource[] = R"(
+struct VaryingInput
+{
+    unsigned groupID[3];
+    unsigned groupThreadID[3];
+};
+
+extern "C" void slang_llvm_groupBarrier();
+
+static int recurse(volatile int* values, int depth)
+{
+    volatile int local[64];
+    local[0] = depth;
+    slang_llvm_groupBarrier();
+    return depth ? recurse(values, depth - 1) + local[0] : 0;
+}
+
+extern "C" void recurse_Thread(VaryingInput* input, void* entryPointParams, void* globalParams)
+{
+    int* out = (int*)globalParams;
+    out[input->groupThreadID[0]] = recurse(out, 16);
+}
+)";
+
+struct ReverseParams
+{
+    int* data;
+    int* out;
+    uint32_t groupSize;
+};
+
+SLANG_LLVM_TEST(fiberGroupBarrier)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kReverseSource, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    // Several groups, so the fibers are reused
+    const uint32_t groupCount[3] = { 5, 1, 1 };
+    const uint32_t groupSize[3] = { 64, 1, 1 };
+
+    std::vector<int> data(groupCount[0] * groupSize[0], -1);
+    std::vector<int> out(data.size(), -1);
+
+    ReverseParams params;
+    params.data = data.data();
+    params.out = out.data();
+    params.groupSize = groupSize[0];
+
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(sharedLibrary->dispatchGroups("reverse_Thread", groupCount, groupSize, nullptr, &params)));
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        SLANG_LLVM_CHECK(out[i] == int(groupSize[0] - 1 - i % groupSize[0]));
+    }
+}
+
+SLANG_LLVM_TEST(fiberGroupStack)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kRecurseSource, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    const uint32_t groupCount[3] = { 2, 2, 1 };
+    const uint32_t groupSize[3] = { 32, 1, 1 };
+
+    // Switching between fibers many times must preserve every frame
+    std::vector<int> out(groupSize[0], 0);
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(sharedLibrary->dispatchGroups("recurse_Thread", groupCount, groupSize, nullptr, out.data())));
+    for (int value : out)
+    {
+        SLANG_LLVM_CHECK(value == 16 * 17 / 2);
+    }
+}
+
+SLANG_LLVM_TEST(fiberGroupNotFound)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kReverseSource, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    const uint32_t counts[3] = { 1, 1, 1 };
+    SLANG_LLVM_CHECK(sharedLibrary && sharedLibrary->dispatchGroups("missing_Thread", counts, counts, nullptr, nullptr) == SLANG_E_NOT_FOUND);
+}
@@ -0,0 +1,90 @@
+// Tests of LLVMCompileOptions::instrumentFunctions, and reading the stats through ILLVMJITSharedLibrary.
+
+#include "slang-llvm-test.h"
+
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kAddSource[] = R"(
+extern "C" int add(int a, int b) { return a + b; }
+)";
+
+typedef int (*AddFunc)(int a, int b);
+
+// Get the stats of the function called name, returns false if there are none
+static bool _findStats(ILLVMJITSharedLibrary* sharedLibrary, const char* name, LLVMFunctionStats& outStats)
+{
+    for (Index i = 0; i < sharedLibrary->getFunctionStatsCount(); ++i)
+    {
+        if (SLANG_SUCCEEDED(sharedLibrary->getFunctionStatsAt(i, &outStats)) && ::strcmp(outStats.name, name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+SLANG_LLVM_TEST(functionStatsCountCalls)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.instrumentFunctions = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kAddSource, llvmOptions, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    auto add = (AddFunc)TestContext::findSymbol(artifact, "add");
+    SLANG_LLVM_CHECK(sharedLibrary && add);
+    if (!sharedLibrary || !add)
+    {
+        return;
+    }
+
+    // Called from several threads, so every increment must be seen
+    const int threadCount = 4;
+    const int callsPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int j = 0; j < callsPerThread; ++j)
+            {
+                add(j, 1);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    LLVMFunctionStats stats;
+    SLANG_LLVM_CHECK(_findStats(sharedLibrary, "add", stats));
+    SLANG_LLVM_CHECK(stats.callCount == uint64_t(threadCount * callsPerThread));
+
+    sharedLibrary->resetFunctionStats();
+    SLANG_LLVM_CHECK(_findStats(sharedLibrary, "add", stats));
+    SLANG_LLVM_CHECK(stats.callCount == 0 && stats.cycleCount == 0);
+
+    SLANG_LLVM_CHECK(add(1, 2) == 3);
+    SLANG_LLVM_CHECK(_findStats(sharedLibrary, "add", stats) && stats.callCount == 1);
+}
+
+SLANG_LLVM_TEST(functionStatsNotInstrumented)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kAddSource, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary && sharedLibrary->getFunctionStatsCount() == 0);
+
+    LLVMFunctionStats stats;
+    SLANG_LLVM_CHECK(sharedLibrary && sharedLibrary->getFunctionStatsAt(0, &stats) == SLANG_E_INVALID_ARG);
+}
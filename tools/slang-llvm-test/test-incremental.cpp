@@ -0,0 +1,73 @@
+// Tests of LLVMCompileOptions::incremental, where code of unchanged functions is reused from earlier compilations.
+
+#include "slang-llvm-test.h"
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// Compiled before and after an edit of scale. offset doesn't change between them.
+static const char kBeforeEditSource[] = R"(
+extern "C" int offset(int value) { return value + 7; }
+extern "C" int scale(int value) { return offset(value) * 2; }
+)";
+
+static const char kAfterEditSource[] = R"(
+extern "C" int offset(int value) { return value + 7; }
+extern "C" int scale(int value) { return offset(value) * 3; }
+)";
+
+// first and second are identical, but as they're exported must remain different functions
+static const char kIdenticalSource[] = R"(
+extern "C" int first(int value) { return value ^ 0x5a5a; }
+extern "C" int second(int value) { return value ^ 0x5a5a; }
+)";
+
+typedef int (*IntFunc)(int value);
+
+static SlangResult _compileIncremental(TestContext* context, const char* source, ComPtr<IArtifact>& outArtifact)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.incremental = true;
+    return context->compile(source, llvmOptions, outArtifact.writeRef());
+}
+
+static int _call(IArtifact* artifact, const char* name, int value)
+{
+    auto func = (IntFunc)TestContext::findSymbol(artifact, name);
+    return func ? func(value) : -1;
+}
+
+SLANG_LLVM_TEST(incrementalEdit)
+{
+    ComPtr<IArtifact> before;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileIncremental(context, kBeforeEditSource, before)));
+    SLANG_LLVM_CHECK(_call(before, "scale", 1) == 16);
+
+    ComPtr<IArtifact> after;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileIncremental(context, kAfterEditSource, after)));
+    SLANG_LLVM_CHECK(_call(after, "scale", 1) == 24);
+    SLANG_LLVM_CHECK(_call(after, "offset", 1) == 8);
+
+    // offset is reused from before, so its code must stay while after uses it. The code only before used is freed.
+    SLANG_LLVM_CHECK(TestContext::findSymbol(before, "offset") == TestContext::findSymbol(after, "offset"));
+    before.setNull();
+    SLANG_LLVM_CHECK(_call(after, "scale", 2) == 27);
+    SLANG_LLVM_CHECK(_call(after, "offset", 2) == 9);
+
+    // Compiling the original again (after its code has been freed) must still work
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileIncremental(context, kBeforeEditSource, before)));
+    SLANG_LLVM_CHECK(_call(before, "scale", 1) == 16);
+}
+
+SLANG_LLVM_TEST(incrementalExportedNotMerged)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileIncremental(context, kIdenticalSource, artifact)));
+
+    void* first = TestContext::findSymbol(artifact, "first");
+    void* second = TestContext::findSymbol(artifact, "second");
+    SLANG_LLVM_CHECK(first && second && first != second);
+    SLANG_LLVM_CHECK(_call(artifact, "first", 1) == (1 ^ 0x5a5a));
+    SLANG_LLVM_CHECK(_call(artifact, "second", 1) == (1 ^ 0x5a5a));
+}
@@ -0,0 +1,111 @@
+// Tests of ILLVMLibraryDownstreamCompiler, where inline functions are compiled once and used by other compilations.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// The prelude the library and the compilations share. helperAddress returns the address of whichever copy is called.
+static const char kLibrarySource[] = R"(
+extern "C" inline void* helperAddress() { return (void*)&helperAddress; }
+#ifdef SCALE_BY_THREE
+extern "C" inline int scaled(int value) { return value * 3; }
+#else
+extern "C" inline int scaled(int value) { return value * 2; }
+#endif
+)";
+
+static const char kUserFunctions[] = R"(
+extern "C" void* getHelperAddress() { return helperAddress(); }
+extern "C" int getScaled(int value) { return scaled(value); }
+)";
+
+typedef void* (*GetAddressFunc)();
+typedef int (*IntFunc)(int value);
+
+// Compiles source, defining SCALE_BY_THREE if scaleByThree is set. If isLibrary is set source is compiled as a
+// library, otherwise it follows the prelude.
+static SlangResult _compile(TestContext* context, const char* source, bool scaleByThree, DownstreamCompileOptions::FloatingPointMode floatingPointMode, bool isLibrary, ComPtr<IArtifact>& outArtifact)
+{
+    // Compilations use the prelude followed by their own functions
+    const std::string text = isLibrary ? std::string(source) : std::string(kLibrarySource) + source;
+    ComPtr<IArtifact> sourceArtifact = TestContext::createSource(text.c_str());
+    IArtifact* sourceArtifacts[] = { sourceArtifact };
+
+    DownstreamCompileOptions::Define define;
+    define.nameWithSig = TerminatedCharSlice("SCALE_BY_THREE");
+
+    DownstreamCompileOptions options = TestContext::getCompileOptions(sourceArtifacts);
+    options.floatingPointMode = floatingPointMode;
+    if (scaleByThree)
+    {
+        options.defines = Slice<DownstreamCompileOptions::Define>(&define, 1);
+    }
+
+    if (isLibrary)
+    {
+        return context->getCompiler<ILLVMLibraryDownstreamCompiler>()->compileLibrary(options, outArtifact.writeRef());
+    }
+    return context->getCompiler<ILLVMDownstreamCompiler>()->compileWithOptions(options, LLVMCompileOptions(), outArtifact.writeRef());
+}
+
+// Compiles and registers the library, returning the address of its helper
+static void* _registerLibrary(TestContext* context, ComPtr<IArtifact>& outLibrary)
+{
+    const auto floatingPointMode = DownstreamCompileOptions::FloatingPointMode::Default;
+    if (SLANG_FAILED(_compile(context, kLibrarySource, true, floatingPointMode, true, outLibrary)) ||
+        SLANG_FAILED(context->getCompiler<ILLVMLibraryDownstreamCompiler>()->registerLibrary(outLibrary)))
+    {
+        return nullptr;
+    }
+    return TestContext::findSymbol(outLibrary, "helperAddress");
+}
+
+SLANG_LLVM_TEST(libraryUsedWhenOptionsMatch)
+{
+    ComPtr<IArtifact> library;
+    void* libraryHelper = _registerLibrary(context, library);
+    SLANG_LLVM_CHECK(libraryHelper);
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compile(context, kUserFunctions, true, DownstreamCompileOptions::FloatingPointMode::Default, false, artifact)));
+
+    auto getHelperAddress = (GetAddressFunc)TestContext::findSymbol(artifact, "getHelperAddress");
+    SLANG_LLVM_CHECK(getHelperAddress && getHelperAddress() == libraryHelper);
+    auto getScaled = (IntFunc)TestContext::findSymbol(artifact, "getScaled");
+    SLANG_LLVM_CHECK(getScaled && getScaled(5) == 15);
+}
+
+SLANG_LLVM_TEST(libraryNotUsedWithOtherDefines)
+{
+    ComPtr<IArtifact> library;
+    void* libraryHelper = _registerLibrary(context, library);
+    SLANG_LLVM_CHECK(libraryHelper);
+
+    // Without the define the inline functions differ from the library's, so the compilation's own copies must be used
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compile(context, kUserFunctions, false, DownstreamCompileOptions::FloatingPointMode::Default, false, artifact)));
+
+    auto getHelperAddress = (GetAddressFunc)TestContext::findSymbol(artifact, "getHelperAddress");
+    SLANG_LLVM_CHECK(getHelperAddress && getHelperAddress() != libraryHelper);
+    auto getScaled = (IntFunc)TestContext::findSymbol(artifact, "getScaled");
+    SLANG_LLVM_CHECK(getScaled && getScaled(5) == 10);
+}
+
+SLANG_LLVM_TEST(libraryNotUsedWithOtherFloatingPointMode)
+{
+    ComPtr<IArtifact> library;
+    void* libraryHelper = _registerLibrary(context, library);
+    SLANG_LLVM_CHECK(libraryHelper);
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compile(context, kUserFunctions, true, DownstreamCompileOptions::FloatingPointMode::Fast, false, artifact)));
+
+    auto getHelperAddress = (GetAddressFunc)TestContext::findSymbol(artifact, "getHelperAddress");
+    SLANG_LLVM_CHECK(getHelperAddress && getHelperAddress() != libraryHelper);
+    auto getScaled = (IntFunc)TestContext::findSymbol(artifact, "getScaled");
+    SLANG_LLVM_CHECK(getScaled && getScaled(5) == 15);
+}
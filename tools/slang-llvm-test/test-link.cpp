@@ -0,0 +1,83 @@
+// Tests of ILLVMLinkDownstreamCompiler::link, the full LTO of artifacts compiled with LLVMCompileOptions::keepBitcode.
+
+#include "slang-llvm-test.h"
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kSquareSource[] = R"(
+extern "C" int square(int value) { return value * value; }
+)";
+
+// Calls square, which is only defined by the other artifact
+static const char kSumSquaresSource[] = R"(
+extern "C" int square(int value);
+extern "C" int sumSquares(int a, int b) { return square(a) + square(b); }
+)";
+
+typedef int (*SumSquaresFunc)(int a, int b);
+typedef int (*SquareFunc)(int value);
+
+// Compiles both sources keeping their bitcode, and links them exporting exportNames
+static SlangResult _linkSquares(TestContext* context, const char* const* exportNames, Count exportNameCount, ComPtr<IArtifact>& outLinked)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.keepBitcode = true;
+
+    ComPtr<IArtifact> squareArtifact;
+    SLANG_RETURN_ON_FAIL(context->compile(kSquareSource, llvmOptions, squareArtifact.writeRef()));
+    ComPtr<IArtifact> sumSquaresArtifact;
+    SLANG_RETURN_ON_FAIL(context->compile(kSumSquaresSource, llvmOptions, sumSquaresArtifact.writeRef()));
+
+    IArtifact* artifacts[] = { squareArtifact, sumSquaresArtifact };
+
+    LLVMLinkDesc desc;
+    desc.artifacts = artifacts;
+    desc.artifactCount = 2;
+    desc.exportNames = exportNames;
+    desc.exportNameCount = exportNameCount;
+
+    return context->getCompiler<ILLVMLinkDownstreamCompiler>()->link(desc, outLinked.writeRef());
+}
+
+SLANG_LLVM_TEST(linkAcrossArtifacts)
+{
+    const char* exportNames[] = { "sumSquares" };
+
+    ComPtr<IArtifact> linked;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_linkSquares(context, exportNames, 1, linked)));
+
+    auto sumSquares = (SumSquaresFunc)TestContext::findSymbol(linked, "sumSquares");
+    SLANG_LLVM_CHECK(sumSquares && sumSquares(3, 4) == 25);
+
+    // The modules are merged and optimized as one, so square is inlined into sumSquares and, not being exported, removed
+    SLANG_LLVM_CHECK(TestContext::findSymbol(linked, "square") == nullptr);
+}
+
+SLANG_LLVM_TEST(linkWithoutExportNames)
+{
+    // Every function that was available from the artifacts remains so
+    ComPtr<IArtifact> linked;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_linkSquares(context, nullptr, 0, linked)));
+
+    auto sumSquares = (SumSquaresFunc)TestContext::findSymbol(linked, "sumSquares");
+    SLANG_LLVM_CHECK(sumSquares && sumSquares(1, 2) == 5);
+    auto square = (SquareFunc)TestContext::findSymbol(linked, "square");
+    SLANG_LLVM_CHECK(square && square(7) == 49);
+}
+
+SLANG_LLVM_TEST(linkRequiresBitcode)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSquareSource, artifact.writeRef())));
+
+    IArtifact* artifacts[] = { artifact };
+
+    LLVMLinkDesc desc;
+    desc.artifacts = artifacts;
+    desc.artifactCount = 1;
+
+    ComPtr<IArtifact> linked;
+    SLANG_LLVM_CHECK(context->getCompiler<ILLVMLinkDownstreamCompiler>()->link(desc, linked.writeRef()) == SLANG_E_INVALID_ARG);
+}
@@ -0,0 +1,183 @@
+// Tests of LLVMCompileOptions::multiversionLevels, however the code is compiled and added to the JIT.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+
+#if SLANG_LINUX_FAMILY && SLANG_PROCESSOR_X86_64
+#   include <fstream>
+#   include <sstream>
+
+#   include <unistd.h>
+#endif
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kTwiceSource[] = R"(
+extern "C" int twiceSum(const int* values, int count)
+{
+    int total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        total += 2 * values[i];
+    }
+    return total;
+}
+)";
+
+static const uint32_t kAllLevels =
+    LLVMCompileOptions::MultiversionLevel::X86_64_V2 |
+    LLVMCompileOptions::MultiversionLevel::X86_64_V3 |
+    LLVMCompileOptions::MultiversionLevel::X86_64_V4;
+
+#if SLANG_LINUX_FAMILY && SLANG_PROCESSOR_X86_64
+// Each variant of probedSum calls probe, which records where it was called from
+static const char kProbedSource[] = R"(
+extern "C" int probe();
+extern "C" int probedSum(const int* values, int count)
+{
+    int total = probe();
+    for (int i = 0; i < count; ++i)
+    {
+        total += values[i];
+    }
+    return total;
+}
+)";
+
+static int s_cpuLevelCallCount = 0;
+static void* s_probeReturnAddress = nullptr;
+
+// Replaces the runtime's slang_llvm_getCPULevel, such that the variant selected doesn't depend on the host
+static int32_t _getCPULevel()
+{
+    ++s_cpuLevelCallCount;
+    return 2;
+}
+
+static int _probe()
+{
+    s_probeReturnAddress = __builtin_return_address(0);
+    return 0;
+}
+
+// Gets the name of the function whose code holds address, from the map written for profilers
+static std::string _findPerfMapName(void* address)
+{
+    std::ifstream file("/tmp/perf-" + std::to_string(getpid()) + ".map");
+
+    std::string name;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // Each line is the address and size in hex, followed by the name
+        std::istringstream stream(line);
+        uintptr_t start = 0;
+        uintptr_t size = 0;
+        std::string entryName;
+        if ((stream >> std::hex >> start >> size >> entryName) && uintptr_t(address) >= start && uintptr_t(address) < start + size)
+        {
+            // Entries are never removed, so the last is of the code now at the address
+            name = entryName;
+        }
+    }
+    return name;
+}
+#endif
+
+SLANG_LLVM_TEST(multiversionInProcess)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.multiversionLevels = kAllLevels;
+    llvmOptions.keepRepresentations = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+#if SLANG_PROCESSOR_X86_64
+    // The variants are selected by an exported function, rather than a module constructor
+    const std::string ir = TestContext::getRepresentationText(artifact, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("@__slang_llvm_multiversion_init()") != std::string::npos);
+    SLANG_LLVM_CHECK(ir.find("llvm.global_ctors") == std::string::npos);
+#endif
+}
+
+SLANG_LLVM_TEST(multiversionOutOfProcess)
+{
+    // The code is added to the JIT as an object file, so constructors wouldn't be run
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.multiversionLevels = kAllLevels;
+    llvmOptions.compileOutOfProcess = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+#if SLANG_LINUX_FAMILY && SLANG_PROCESSOR_X86_64
+    // The init function is called once, and selects the variant for the level it's given. The variants are internal,
+    // so the one that ran is found from the address it called probe from.
+    auto symbols = context->getCompiler<ILLVMSymbolDownstreamCompiler>();
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(symbols->registerSymbol("slang_llvm_getCPULevel", (void*)&_getCPULevel)));
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(symbols->registerSymbol("probe", (void*)&_probe)));
+
+    llvmOptions.profilerSupport = true;
+
+    ComPtr<IArtifact> probedArtifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kProbedSource, llvmOptions, probedArtifact.writeRef())));
+    SLANG_LLVM_CHECK(s_cpuLevelCallCount == 1);
+
+    s_probeReturnAddress = nullptr;
+    const int values[] = { 1, 2, 3 };
+    auto probedSum = (SumFunc)TestContext::findSymbol(probedArtifact, "probedSum");
+    SLANG_LLVM_CHECK(probedSum && probedSum(values, 3) == 6);
+    SLANG_LLVM_CHECK(s_probeReturnAddress && _findPerfMapName(s_probeReturnAddress) == "probedSum.x86-64-v2");
+#endif
+}
+
+SLANG_LLVM_TEST(multiversionWithVectorizeGroups)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.multiversionLevels = LLVMCompileOptions::MultiversionLevel::X86_64_V3;
+    llvmOptions.vectorizeGroups = true;
+    llvmOptions.keepRepresentations = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+#if SLANG_PROCESSOR_X86_64
+    // The variants are for their levels, so the code doesn't depend on the host CPU
+    const std::string ir = TestContext::getRepresentationText(artifact, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("\"target-cpu\"=\"x86-64-v3\"") != std::string::npos);
+#endif
+}
+
+SLANG_LLVM_TEST(multiversionLink)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.multiversionLevels = kAllLevels;
+    llvmOptions.keepBitcode = true;
+
+    // Both are multiversioned, so each has an init function
+    ComPtr<IArtifact> sumArtifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(llvmOptions, sumArtifact.writeRef())));
+    ComPtr<IArtifact> twiceArtifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kTwiceSource, llvmOptions, twiceArtifact.writeRef())));
+
+    IArtifact* artifacts[] = { sumArtifact, twiceArtifact };
+    const char* exportNames[] = { "sum", "twiceSum" };
+
+    LLVMLinkDesc desc;
+    desc.artifacts = artifacts;
+    desc.artifactCount = 2;
+    desc.exportNames = exportNames;
+    desc.exportNameCount = 2;
+
+    ComPtr<IArtifact> linked;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMLinkDownstreamCompiler>()->link(desc, linked.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(linked));
+    SLANG_LLVM_CHECK(TestContext::checkSum(linked, "twiceSum", 2));
+}
@@ -0,0 +1,125 @@
+// Tests of compiling in a worker process (slang-llvm-worker). Everything that is sent to and from the worker is
+// checked against compiling in process.
+
+#include "slang-llvm-test.h"
+
+#include <string.h>
+
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kCountSource[] = R"(
+#warning "streamed warning"
+extern "C" int countBelow(int limit)
+{
+    int count = 0;
+    for (int i = 0; i < limit; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+)";
+
+typedef int (*CountFunc)(int limit);
+
+static void _recordSeverity(const ArtifactDiagnostic& diagnostic, void* userData)
+{
+    ((std::vector<ArtifactDiagnostic::Severity>*)userData)->push_back(diagnostic.severity);
+}
+
+SLANG_LLVM_TEST(outOfProcessRoundTrip)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileOutOfProcess = true;
+    llvmOptions.keepBitcode = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCountSource, llvmOptions, artifact.writeRef())));
+
+    auto count = (CountFunc)TestContext::findSymbol(artifact, "countBelow");
+    SLANG_LLVM_CHECK(count && count(10) == 4);
+
+    // The diagnostics and bitcode came back from the worker
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("streamed warning") != std::string::npos);
+
+    ComPtr<ISlangBlob> bitcode;
+    ILLVMJITSharedLibrary* sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary && SLANG_SUCCEEDED(sharedLibrary->getRepresentation(LLVMRepresentation::Bitcode, bitcode.writeRef())));
+    SLANG_LLVM_CHECK(bitcode && bitcode->getBufferSize() > 4 && ::memcmp(bitcode->getBufferPointer(), "BC", 2) == 0);
+}
+
+SLANG_LLVM_TEST(outOfProcessStreamsDiagnostics)
+{
+    std::vector<ArtifactDiagnostic::Severity> severities;
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileOutOfProcess = true;
+    llvmOptions.diagnosticCallback = &_recordSeverity;
+    llvmOptions.diagnosticCallbackUserData = &severities;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCountSource, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::findSymbol(artifact, "countBelow"));
+
+    // As in process, the warning goes to the callback, and isn't kept by the artifact
+    SLANG_LLVM_CHECK(severities.size() == 1 && severities[0] == ArtifactDiagnostic::Severity::Warning);
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("streamed warning") == std::string::npos);
+}
+
+SLANG_LLVM_TEST(outOfProcessReportsErrors)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileOutOfProcess = true;
+
+    ComPtr<IArtifact> artifact;
+    std::string diagnostics;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile("extern \"C\" int broken() { return undefinedValue; }", llvmOptions, artifact.writeRef(), &diagnostics)));
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+    SLANG_LLVM_CHECK(diagnostics.find("undefinedValue") != std::string::npos);
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("undefinedValue") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(outOfProcessProfile)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileOutOfProcess = true;
+    llvmOptions.profileMode = LLVMCompileOptions::ProfileMode::Instrument;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCountSource, llvmOptions, artifact.writeRef())));
+
+    auto count = (CountFunc)TestContext::findSymbol(artifact, "countBelow");
+    SLANG_LLVM_CHECK(count && count(7) == 3);
+
+    // The branch profile layout came back from the worker
+    ComPtr<ISlangBlob> profile;
+    ILLVMJITSharedLibrary* sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary && SLANG_SUCCEEDED(sharedLibrary->writeProfile(profile.writeRef())));
+    SLANG_LLVM_CHECK(profile && std::string((const char*)profile->getBufferPointer(), profile->getBufferSize()).find("function countBelow 1 ") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(outOfProcessCancelled)
+{
+    ComPtr<ILLVMCancellationToken> token;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->getCompiler<ILLVMDownstreamCompiler>()->createCancellationToken(token.writeRef())));
+    if (!token)
+    {
+        return;
+    }
+    token->cancel();
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.compileOutOfProcess = true;
+    llvmOptions.cancellationToken = token;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCountSource, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+}
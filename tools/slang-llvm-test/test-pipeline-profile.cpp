@@ -0,0 +1,81 @@
+// Tests of LLVMCompileOptions::pipelineProfile, which replaces the optimization pipeline of the optimization level.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+typedef DownstreamCompileOptions::OptimizationLevel OptimizationLevel;
+typedef LLVMCompileOptions::PipelineProfile PipelineProfile;
+
+// Options that use the profile, and keep the representations
+static LLVMCompileOptions _getOptions(PipelineProfile profile, const char* passPipeline = nullptr)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.pipelineProfile = profile;
+    llvmOptions.passPipeline = passPipeline;
+    llvmOptions.keepRepresentations = true;
+    return llvmOptions;
+}
+
+SLANG_LLVM_TEST(pipelineProfileLowLatency)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(OptimizationLevel::Default, _getOptions(PipelineProfile::LowLatency), artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+    // No loop passes are run, so the loop isn't vectorized
+    SLANG_LLVM_CHECK(TestContext::getRepresentationText(artifact, LLVMRepresentation::IR).find(" x i32>") == std::string::npos);
+}
+
+SLANG_LLVM_TEST(pipelineProfileThroughput)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(OptimizationLevel::Default, _getOptions(PipelineProfile::Throughput), artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+    // The default pipeline at the same level doesn't vectorize loops (as with clang at -O1), so the vectorized loop
+    // can only have come from the profile
+    ComPtr<IArtifact> defaultArtifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(OptimizationLevel::Default, _getOptions(PipelineProfile::Default), defaultArtifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(defaultArtifact));
+
+    const std::string ir = TestContext::getRepresentationText(artifact, LLVMRepresentation::IR);
+    const std::string defaultIR = TestContext::getRepresentationText(defaultArtifact, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(defaultIR.find(" x i32>") == std::string::npos);
+    SLANG_LLVM_CHECK(ir.find(" x i32>") != std::string::npos);
+    SLANG_LLVM_CHECK(ir != defaultIR);
+}
+
+SLANG_LLVM_TEST(pipelineProfileThroughputUnoptimized)
+{
+    // Without optimization the code is as the front end produced it
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(OptimizationLevel::None, _getOptions(PipelineProfile::Throughput), artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+    const std::string ir = TestContext::getRepresentationText(artifact, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("alloca") != std::string::npos);
+    SLANG_LLVM_CHECK(ir.find(" x i32>") == std::string::npos);
+}
+
+SLANG_LLVM_TEST(pipelineProfileCustom)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(OptimizationLevel::Default, _getOptions(PipelineProfile::Custom, "function(sroa,instcombine,simplifycfg)"), artifact.writeRef())));
+    SLANG_LLVM_CHECK(TestContext::checkSum(artifact));
+
+    // sroa removes the stack variables
+    SLANG_LLVM_CHECK(TestContext::getRepresentationText(artifact, LLVMRepresentation::IR).find("alloca") == std::string::npos);
+}
+
+SLANG_LLVM_TEST(pipelineProfileCustomInvalid)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compileSum(OptimizationLevel::Default, _getOptions(PipelineProfile::Custom, "function(not-a-pass)"), artifact.writeRef())));
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("Invalid pass pipeline") != std::string::npos);
+}
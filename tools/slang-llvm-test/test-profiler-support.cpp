@@ -0,0 +1,71 @@
+// Tests of LLVMCompileOptions::profilerSupport, which makes JIT'd code visible to sampling profilers.
+
+#include "slang-llvm-test.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if SLANG_LINUX_FAMILY
+#   include <unistd.h>
+#endif
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// The #line directive is as Slang produces, mapping the code back to the Slang source
+static const char kProfiledSource[] = R"(
+#line 20 "profiled-shader.slang"
+extern "C" int profiledFunction(int value)
+{
+    return value * 5 + 1;
+}
+)";
+
+typedef int (*IntFunc)(int value);
+
+SLANG_LLVM_TEST(profilerSupportLineTables)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.profilerSupport = true;
+    llvmOptions.keepRepresentations = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kProfiledSource, llvmOptions, artifact.writeRef())));
+
+    auto func = (IntFunc)TestContext::findSymbol(artifact, "profiledFunction");
+    SLANG_LLVM_CHECK(func && func(2) == 11);
+
+    // The line tables locate the code in the file named by #line
+    const std::string ir = TestContext::getRepresentationText(artifact, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("profiled-shader.slang") != std::string::npos);
+    SLANG_LLVM_CHECK(ir.find("!DILocation(line: 22") != std::string::npos);
+}
+
+#if SLANG_LINUX_FAMILY
+SLANG_LLVM_TEST(profilerSupportPerfMap)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.profilerSupport = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kProfiledSource, llvmOptions, artifact.writeRef())));
+
+    // Looking the function up loads its code, which adds it to the map
+    void* func = TestContext::findSymbol(artifact, "profiledFunction");
+    SLANG_LLVM_CHECK(func);
+
+    std::ifstream file("/tmp/perf-" + std::to_string(getpid()) + ".map");
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    // Each line is the address and size in hex, followed by the name
+    std::stringstream expected;
+    expected << "\n" << std::hex << uintptr_t(func) << " ";
+    const std::string text = "\n" + contents.str();
+    const size_t start = text.find(expected.str());
+    SLANG_LLVM_CHECK(start != std::string::npos);
+    SLANG_LLVM_CHECK(start != std::string::npos && text.find("profiledFunction", start) < text.find('\n', start + 1));
+}
+#endif
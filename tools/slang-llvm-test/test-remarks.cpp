@@ -0,0 +1,111 @@
+// Tests of LLVMCompileOptions::remarksFilter, which reports optimization remarks as diagnostics and as YAML.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// addOne is inlined into the call at line 30 of the file named by #line
+static const char kInlineSource[] = R"(
+#line 20 "remarks-shader.slang"
+static int addOne(int value)
+{
+    return value + 1;
+}
+
+extern "C" int callAddOne(int value)
+{
+    int result = value * 2;
+    for (int i = 0; i < 2; ++i)
+    {
+        result = addOne(result);
+    }
+    return result;
+}
+)";
+
+struct RecordedRemark
+{
+    std::string text;
+    std::string filePath;
+    Int line;
+};
+
+static void _recordRemark(const ArtifactDiagnostic& diagnostic, void* userData)
+{
+    if (diagnostic.severity != ArtifactDiagnostic::Severity::Info)
+    {
+        return;
+    }
+
+    RecordedRemark remark;
+    remark.text.assign(diagnostic.text.begin(), diagnostic.text.end());
+    remark.filePath.assign(diagnostic.filePath.begin(), diagnostic.filePath.end());
+    remark.line = diagnostic.location.line;
+    ((std::vector<RecordedRemark>*)userData)->push_back(remark);
+}
+
+SLANG_LLVM_TEST(remarksAsDiagnostics)
+{
+    std::vector<RecordedRemark> remarks;
+
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.remarksFilter = "inline";
+    llvmOptions.diagnosticCallback = &_recordRemark;
+    llvmOptions.diagnosticCallbackUserData = &remarks;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kInlineSource, llvmOptions, artifact.writeRef())));
+
+    auto callAddOne = (int (*)(int))TestContext::findSymbol(artifact, "callAddOne");
+    SLANG_LLVM_CHECK(callAddOne && callAddOne(3) == 8);
+
+    // The inlining is reported at the call, and only remarks of passes matching the filter are reported
+    bool foundInlined = false;
+    for (const auto& remark : remarks)
+    {
+        const size_t passName = remark.text.rfind('[');
+        SLANG_LLVM_CHECK(passName != std::string::npos && remark.text.find("inline", passName) != std::string::npos);
+        if (remark.text.find("passed:") == 0 && remark.text.find("addOne") != std::string::npos)
+        {
+            foundInlined = true;
+            SLANG_LLVM_CHECK(remark.filePath.find("remarks-shader.slang") != std::string::npos);
+            SLANG_LLVM_CHECK(remark.line == 30);
+        }
+    }
+    SLANG_LLVM_CHECK(foundInlined);
+
+    // The same remarks are available as YAML
+    const std::string yaml = TestContext::getRepresentationText(artifact, LLVMRepresentation::Remarks);
+    SLANG_LLVM_CHECK(yaml.find("--- !Passed") != std::string::npos);
+    SLANG_LLVM_CHECK(yaml.find("Pass:            inline") != std::string::npos || yaml.find("Pass: inline") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(remarksOutOfProcess)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.remarksFilter = "inline";
+    llvmOptions.compileOutOfProcess = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kInlineSource, llvmOptions, artifact.writeRef())));
+
+    // Without a callback the remarks are kept by the artifact
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("[inline]") != std::string::npos);
+
+    SLANG_LLVM_CHECK(!TestContext::getRepresentationText(artifact, LLVMRepresentation::Remarks).empty());
+}
+
+SLANG_LLVM_TEST(remarksNotRequested)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kInlineSource, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    ComPtr<ISlangBlob> yaml;
+    SLANG_LLVM_CHECK(sharedLibrary && sharedLibrary->getRepresentation(LLVMRepresentation::Remarks, yaml.writeRef()) == SLANG_E_NOT_AVAILABLE);
+}
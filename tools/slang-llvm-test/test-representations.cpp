@@ -0,0 +1,69 @@
+// Tests of ILLVMJITSharedLibrary::getRepresentation, with LLVMCompileOptions::keepRepresentations.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kAddSource[] = R"(
+extern "C" int addNumbers(int a, int b) { return a + b; }
+)";
+
+static void _checkRepresentations(TestContext* context, IArtifact* artifact)
+{
+    const std::string ir = TestContext::getRepresentationText(artifact, LLVMRepresentation::IR);
+    SLANG_LLVM_CHECK(ir.find("define") != std::string::npos);
+    SLANG_LLVM_CHECK(ir.find("@addNumbers") != std::string::npos);
+
+    // Bitcode starts with the magic 'BC'
+    const std::string bitcode = TestContext::getRepresentationText(artifact, LLVMRepresentation::Bitcode);
+    SLANG_LLVM_CHECK(bitcode.size() > 2 && bitcode[0] == 'B' && bitcode[1] == 'C');
+
+    const std::string assembly = TestContext::getRepresentationText(artifact, LLVMRepresentation::Assembly);
+    SLANG_LLVM_CHECK(assembly.find("addNumbers") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(representationsKept)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.keepRepresentations = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kAddSource, llvmOptions, artifact.writeRef())));
+    _checkRepresentations(context, artifact);
+
+    // Produced once, and then cached
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    ComPtr<ISlangBlob> first, second;
+    SLANG_LLVM_CHECK(sharedLibrary && SLANG_SUCCEEDED(sharedLibrary->getRepresentation(LLVMRepresentation::Assembly, first.writeRef())));
+    SLANG_LLVM_CHECK(sharedLibrary && SLANG_SUCCEEDED(sharedLibrary->getRepresentation(LLVMRepresentation::Assembly, second.writeRef())));
+    SLANG_LLVM_CHECK(first && first == second);
+
+    // Keeping them doesn't change the code
+    auto addNumbers = (int (*)(int, int))TestContext::findSymbol(artifact, "addNumbers");
+    SLANG_LLVM_CHECK(addNumbers && addNumbers(2, 3) == 5);
+}
+
+SLANG_LLVM_TEST(representationsOutOfProcess)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.keepRepresentations = true;
+    llvmOptions.compileOutOfProcess = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kAddSource, llvmOptions, artifact.writeRef())));
+    _checkRepresentations(context, artifact);
+}
+
+SLANG_LLVM_TEST(representationsNotKept)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kAddSource, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    ComPtr<ISlangBlob> blob;
+    SLANG_LLVM_CHECK(sharedLibrary && sharedLibrary->getRepresentation(LLVMRepresentation::IR, blob.writeRef()) == SLANG_E_NOT_AVAILABLE);
+}
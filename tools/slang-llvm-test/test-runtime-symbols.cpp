@@ -0,0 +1,89 @@
+// Tests of ILLVMSymbolDownstreamCompiler, registering native functions for JIT'd code to call.
+
+#include "slang-llvm-test.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kCallHostSource[] = R"(
+extern "C" int hostScale(int value);
+extern "C" int callHost(int value) { return hostScale(value) + 1; }
+)";
+
+typedef int (*CallHostFunc)(int value);
+
+static int _double(int value) { return value * 2; }
+static int _triple(int value) { return value * 3; }
+
+static int _callHost(IArtifact* artifact, int value)
+{
+    auto func = (CallHostFunc)TestContext::findSymbol(artifact, "callHost");
+    return func ? func(value) : -1;
+}
+
+SLANG_LLVM_TEST(runtimeSymbolsRegister)
+{
+    auto symbols = context->getCompiler<ILLVMSymbolDownstreamCompiler>();
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(symbols->registerSymbol("hostScale", (void*)&_double)));
+
+    ComPtr<IArtifact> doubled;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCallHostSource, doubled.writeRef())));
+    SLANG_LLVM_CHECK(_callHost(doubled, 5) == 11);
+
+    // Replacing the symbol only affects later compilations
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(symbols->registerSymbol("hostScale", (void*)&_triple)));
+
+    ComPtr<IArtifact> tripled;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kCallHostSource, tripled.writeRef())));
+    SLANG_LLVM_CHECK(_callHost(tripled, 5) == 16);
+    SLANG_LLVM_CHECK(_callHost(doubled, 5) == 11);
+}
+
+SLANG_LLVM_TEST(runtimeSymbolsInvalid)
+{
+    auto symbols = context->getCompiler<ILLVMSymbolDownstreamCompiler>();
+    SLANG_LLVM_CHECK(symbols->registerSymbol(nullptr, (void*)&_double) == SLANG_E_INVALID_ARG);
+    SLANG_LLVM_CHECK(symbols->registerSymbol("", (void*)&_double) == SLANG_E_INVALID_ARG);
+    SLANG_LLVM_CHECK(symbols->registerSymbol("hostScale", nullptr) == SLANG_E_INVALID_ARG);
+    SLANG_LLVM_CHECK(symbols->registerBitcode(nullptr) == SLANG_E_INVALID_ARG);
+}
+
+SLANG_LLVM_TEST(runtimeSymbolsRegisterWhileCompiling)
+{
+    auto symbols = context->getCompiler<ILLVMSymbolDownstreamCompiler>();
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(symbols->registerSymbol("hostScale", (void*)&_double)));
+
+    // Compilations each use the table current when they start, so are unaffected by registrations made meanwhile
+    std::atomic<int> failureCount{ 0 };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                ComPtr<IArtifact> artifact;
+                if (SLANG_FAILED(context->compile(kCallHostSource, artifact.writeRef())) || _callHost(artifact, 5) != 11)
+                {
+                    failureCount++;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        const std::string name = "unusedHostSymbol" + std::to_string(i);
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(symbols->registerSymbol(name.c_str(), (void*)&_triple)));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    SLANG_LLVM_CHECK(failureCount == 0);
+}
@@ -0,0 +1,73 @@
+// Tests of LLVMCompileOptions::shareFunctions, where the code of identical functions is held once in a store.
+
+#include "slang-llvm-test.h"
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// square is shared, then cube (which calls it) once square has been replaced. factorial can only be shared if the
+// optimizer removes its recursion. noinline keeps them as functions, so they can be shared. getCube gives the address
+// of cube, which is the shared code once it has been shared.
+static const char kHelperSource[] = R"(
+__attribute__((noinline)) static int square(int value) { return value * value; }
+__attribute__((noinline)) static int cube(int value) { return square(value) * value; }
+__attribute__((noinline)) static int factorial(int value) { return value > 1 ? value * factorial(value - 1) : 1; }
+
+extern "C" int useHelpers(int value) { return cube(value) + square(value) + factorial(value); }
+extern "C" void* getCube() { return (void*)&cube; }
+)";
+
+typedef int (*IntFunc)(int value);
+typedef void* (*GetFunc)();
+
+static SlangResult _compileShared(TestContext* context, ComPtr<IArtifact>& outArtifact)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.shareFunctions = true;
+    return context->compile(kHelperSource, llvmOptions, outArtifact.writeRef());
+}
+
+static bool _checkHelpers(IArtifact* artifact)
+{
+    auto func = (IntFunc)TestContext::findSymbol(artifact, "useHelpers");
+    return func && func(3) == 27 + 9 + 6;
+}
+
+// Gets the address of cube as used by artifact
+static void* _getCube(IArtifact* artifact)
+{
+    auto func = (GetFunc)TestContext::findSymbol(artifact, "getCube");
+    return func ? func() : nullptr;
+}
+
+SLANG_LLVM_TEST(shareFunctionsAcrossArtifacts)
+{
+    ComPtr<IArtifact> first;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileShared(context, first)));
+    ComPtr<IArtifact> second;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileShared(context, second)));
+
+    SLANG_LLVM_CHECK(_checkHelpers(first));
+    SLANG_LLVM_CHECK(_checkHelpers(second));
+
+    // Both use the one copy of cube held in the store
+    void* cube = _getCube(first);
+    SLANG_LLVM_CHECK(cube && cube == _getCube(second));
+    SLANG_LLVM_CHECK(((IntFunc)cube)(3) == 27);
+
+    // The shared code is used by second, so must remain when first is released
+    first.setNull();
+    SLANG_LLVM_CHECK(_checkHelpers(second));
+}
+
+SLANG_LLVM_TEST(shareFunctionsAfterRelease)
+{
+    // Once every artifact using them is released the functions are removed from the store, so must be added again
+    for (int i = 0; i < 3; ++i)
+    {
+        ComPtr<IArtifact> artifact;
+        SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_compileShared(context, artifact)));
+        SLANG_LLVM_CHECK(_checkHelpers(artifact));
+    }
+}
@@ -0,0 +1,116 @@
+// Tests of specializing functions with ILLVMJITSharedLibrary::specialize.
+
+#include "slang-llvm-test.h"
+
+#include <compiler-core/slang-artifact-associated.h>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kSpecializeSource[] = R"(
+int total = 0;
+
+extern "C" int sumBelow(const int* limit)
+{
+    int sum = 0;
+    for (int i = 0; i < *limit; ++i)
+    {
+        sum += i;
+    }
+    return sum;
+}
+
+extern "C" void addToTotal(const int* amount)
+{
+    total += *amount;
+}
+
+extern "C" int getTotal()
+{
+    return total;
+}
+)";
+
+typedef int (*SumFunc)(const int* limit);
+typedef void (*AddFunc)(const int* amount);
+typedef int (*GetFunc)();
+
+static LLVMSpecializationValue _makeValue(const int* value)
+{
+    LLVMSpecializationValue specializationValue;
+    specializationValue.parameterIndex = 0;
+    specializationValue.offset = 0;
+    specializationValue.size = sizeof(*value);
+    specializationValue.data = value;
+    return specializationValue;
+}
+
+SLANG_LLVM_TEST(specializeReplacesLoads)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSpecializeSource, artifact.writeRef())));
+    ILLVMJITSharedLibrary* sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    const int limit = 10;
+    const LLVMSpecializationValue value = _makeValue(&limit);
+
+    void* func = nullptr;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(sharedLibrary->specialize("sumBelow", &value, 1, &func, nullptr)));
+    SLANG_LLVM_CHECK(func && ((SumFunc)func)(&limit) == 45);
+
+    // Cached
+    void* cachedFunc = nullptr;
+    ComPtr<IArtifactDiagnostics> diagnostics;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(sharedLibrary->specialize("sumBelow", &value, 1, &cachedFunc, diagnostics.writeRef())));
+    SLANG_LLVM_CHECK(cachedFunc == func && !diagnostics);
+}
+
+SLANG_LLVM_TEST(specializeSharesGlobals)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSpecializeSource, artifact.writeRef())));
+    ILLVMJITSharedLibrary* sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    auto getTotal = (GetFunc)TestContext::findSymbol(artifact, "getTotal");
+    SLANG_LLVM_CHECK(sharedLibrary && getTotal);
+    if (!sharedLibrary || !getTotal)
+    {
+        return;
+    }
+
+    const int amount = 5;
+    const LLVMSpecializationValue value = _makeValue(&amount);
+
+    void* func = nullptr;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(sharedLibrary->specialize("addToTotal", &value, 1, &func, nullptr)));
+    if (!func)
+    {
+        return;
+    }
+
+    // The specialization changes the library's variable, rather than a copy of its own
+    ((AddFunc)func)(&amount);
+    ((AddFunc)func)(&amount);
+    SLANG_LLVM_CHECK(getTotal() == 10);
+}
+
+SLANG_LLVM_TEST(specializeReportsDiagnostics)
+{
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kSpecializeSource, artifact.writeRef())));
+    ILLVMJITSharedLibrary* sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    void* func = nullptr;
+    ComPtr<IArtifactDiagnostics> diagnostics;
+    SLANG_LLVM_CHECK(SLANG_FAILED(sharedLibrary->specialize("notDefined", nullptr, 0, &func, diagnostics.writeRef())));
+    SLANG_LLVM_CHECK(diagnostics && diagnostics->getCount() > 0);
+}
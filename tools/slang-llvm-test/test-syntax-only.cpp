@@ -0,0 +1,62 @@
+// Tests of LLVMCompileOptions::syntaxOnly, which checks the source without generating any code.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+static const char kValidSource[] = R"(
+#warning "checked"
+extern "C" int one() { return 1; }
+)";
+
+static const char kInvalidSource[] = R"(
+extern "C" int broken() { return undefinedValue; }
+)";
+
+// Returns the result recorded in the diagnostics of artifact, or SLANG_E_NOT_FOUND if it has none
+static SlangResult _getDiagnosticsResult(IArtifact* artifact)
+{
+    auto diagnostics = artifact ? (IArtifactDiagnostics*)artifact->findAssociated(IArtifactDiagnostics::getTypeGuid()) : nullptr;
+    return diagnostics ? diagnostics->getResult() : SLANG_E_NOT_FOUND;
+}
+
+SLANG_LLVM_TEST(syntaxOnlyValid)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.syntaxOnly = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kValidSource, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(_getDiagnosticsResult(artifact)));
+
+    // The source was checked, but no code was generated
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("checked") != std::string::npos);
+    SLANG_LLVM_CHECK(artifact && !TestContext::getJITSharedLibrary(artifact));
+}
+
+SLANG_LLVM_TEST(syntaxOnlyInvalid)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.syntaxOnly = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kInvalidSource, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(SLANG_FAILED(_getDiagnosticsResult(artifact)));
+    SLANG_LLVM_CHECK(TestContext::getDiagnosticText(artifact).find("undefinedValue") != std::string::npos);
+}
+
+SLANG_LLVM_TEST(syntaxOnlyIgnoresOutOfProcess)
+{
+    // Only the front end runs, so validation is always performed in process
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.syntaxOnly = true;
+    llvmOptions.compileOutOfProcess = true;
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kInvalidSource, llvmOptions, artifact.writeRef())));
+    SLANG_LLVM_CHECK(SLANG_FAILED(_getDiagnosticsResult(artifact)));
+}
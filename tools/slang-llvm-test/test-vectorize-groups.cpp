@@ -0,0 +1,121 @@
+// Tests of LLVMCompileOptions::vectorizeGroups, using optimization remarks to see what was vectorized.
+
+#include "slang-llvm-test.h"
+
+#include <string>
+#include <vector>
+
+using namespace Slang;
+using namespace slang_llvm;
+using namespace slang_llvm_test;
+
+// Has the same structure as the code Slang produces for a compute entry point, where _Thread and the loop in _Group
+// both call the (not exported) entry point _scale
+static const char kScaleSource[] = R"(
+struct ComputeThreadVaryingInput
+{
+    unsigned groupID[3];
+    unsigned groupThreadID[3];
+};
+
+struct ComputeVaryingInput
+{
+    unsigned startGroupID[3];
+    unsigned endGroupID[3];
+};
+
+struct Params
+{
+    float* data;
+};
+
+static void _scale(ComputeThreadVaryingInput* varyingInput, void* entryPointParams, void* globalParams)
+{
+    float* data = ((Params*)globalParams)->data;
+    const unsigned index = varyingInput->groupID[0] * 64 + varyingInput->groupThreadID[0];
+    if (data[index] > 0.0f)
+    {
+        data[index] = data[index] * 2.0f;
+    }
+    else
+    {
+        data[index] = -data[index];
+    }
+}
+
+extern "C" void scale_Thread(ComputeThreadVaryingInput* varyingInput, void* entryPointParams, void* globalParams)
+{
+    _scale(varyingInput, entryPointParams, globalParams);
+}
+
+extern "C" void scale_Group(ComputeVaryingInput* varyingInput, void* entryPointParams, void* globalParams)
+{
+    ComputeThreadVaryingInput threadInput = {};
+    threadInput.groupID[0] = varyingInput->startGroupID[0];
+    threadInput.groupID[1] = varyingInput->startGroupID[1];
+    threadInput.groupID[2] = varyingInput->startGroupID[2];
+    for (unsigned x = 0; x < 64; ++x)
+    {
+        threadInput.groupThreadID[0] = x;
+        _scale(&threadInput, entryPointParams, globalParams);
+    }
+}
+)";
+
+typedef void (*GroupFunc)(LLVMComputeVaryingInput* varyingInput, void* entryPointParams, void* globalParams);
+
+struct ScaleParams
+{
+    float* data;
+};
+
+SLANG_LLVM_TEST(vectorizeGroupsRemarks)
+{
+    LLVMCompileOptions llvmOptions;
+    llvmOptions.vectorizeGroups = true;
+    llvmOptions.remarksFilter = "loop-vectorize";
+
+    ComPtr<IArtifact> artifact;
+    SLANG_LLVM_CHECK(SLANG_SUCCEEDED(context->compile(kScaleSource, llvmOptions, artifact.writeRef())));
+
+    auto sharedLibrary = TestContext::getJITSharedLibrary(artifact);
+    SLANG_LLVM_CHECK(sharedLibrary);
+    if (!sharedLibrary)
+    {
+        return;
+    }
+
+    // The loop over the threads of the group is the only loop, once the entry point is inlined into it
+    const std::string remarks = TestContext::getRepresentationText(artifact, LLVMRepresentation::Remarks);
+    const size_t passed = remarks.find("--- !Passed");
+    SLANG_LLVM_CHECK(passed != std::string::npos);
+    SLANG_LLVM_CHECK(remarks.find("scale_Group", passed) != std::string::npos);
+    SLANG_LLVM_CHECK(remarks.find("vectorized loop", passed) != std::string::npos);
+
+    // Vectorized, each thread must still get its own result
+    auto group = (GroupFunc)sharedLibrary->findSymbolAddressByName("scale_Group");
+    SLANG_LLVM_CHECK(group);
+    if (!group)
+    {
+        return;
+    }
+
+    std::vector<float> data(64 * 2);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (i & 1) ? float(i) : -float(i);
+    }
+
+    ScaleParams params;
+    params.data = data.data();
+
+    LLVMComputeVaryingInput varyingInput = { { 1, 0, 0 }, { 2, 1, 1 } };
+    group(&varyingInput, nullptr, &params);
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        // Only the second group is run
+        const float expected = i < 64 ? ((i & 1) ? float(i) : -float(i)) : ((i & 1) ? float(i) * 2.0f : float(i));
+        SLANG_LLVM_CHECK(data[i] == expected);
+    }
+}